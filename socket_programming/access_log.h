@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>           // std::min
+#include <atomic>              // std::atomic，环形缓冲区的读写位置
+#include <chrono>              // 刷写间隔
+#include <condition_variable>  // 停止时唤醒刷写线程
+#include <cstdint>             // int64_t, uint64_t
+#include <cstdio>              // snprintf
+#include <cstring>             // memcpy
+#include <ctime>               // gmtime_r
+#include <memory>              // std::unique_ptr
+#include <mutex>               // 注册生产者、停止刷写线程
+#include <string>              // std::string
+#include <string_view>         // std::string_view
+#include <thread>              // 刷写线程
+#include <vector>              // std::vector
+#include <errno.h>             // errno
+#include <fcntl.h>             // open
+#include <limits.h>            // IOV_MAX
+#include <unistd.h>            // close
+#include <sys/uio.h>           // writev
+
+/**
+ * @brief 一条访问日志。定长的 POD，生产者只做一次拷贝，格式化留给刷写线程。
+ */
+struct AccessRecord {
+    static constexpr size_t MAX_METHOD = 8;
+    static constexpr size_t MAX_PATH = 216;   // 更长的路径被截断，使整条记录正好 256 字节
+
+    int64_t time_us = 0;       // 响应发送完成的时间（Unix 时间，微秒）
+    int64_t start_us = 0;      // 请求解析完成的时间（单调时钟，微秒），生产者用来计算 latency_us
+    uint64_t bytes = 0;        // 响应的总字节数（响应头 + 正文）
+    uint32_t latency_us = 0;   // 从请求解析完成到响应最后一个字节交给内核
+    uint16_t status = 0;
+    uint8_t method_len = 0;
+    uint8_t path_len = 0;
+    char method[MAX_METHOD];
+    char path[MAX_PATH];
+
+    void set_method(std::string_view m) {
+        method_len = (uint8_t)std::min(m.size(), MAX_METHOD);
+        memcpy(method, m.data(), method_len);
+    }
+    void set_path(std::string_view p) {
+        path_len = (uint8_t)std::min(p.size(), MAX_PATH);
+        memcpy(path, p.data(), path_len);
+    }
+};
+
+/**
+ * @brief 异步访问日志：每个工作线程一个无锁的单生产者/单消费者环形缓冲区，后台线程定期把它们
+ * 格式化成文本，一次 writev 写进日志文件。
+ *
+ * 请求处理线程只做一次定长拷贝和一次 release store，不加锁、不分配内存、不做系统调用；
+ * 缓冲区满时直接丢弃这条记录并计数，绝不阻塞事件循环。丢弃的条数会作为一行注释写进日志。
+ *
+ * 日志格式（每个请求一行）：
+ *   2026-10-17T08:49:37.123456Z GET /index.html 200 1234 57
+ * 依次为完成时间（UTC）、方法、路径、状态码、响应字节数、延迟（微秒）。
+ */
+class AccessLog {
+public:
+    static constexpr size_t DEFAULT_RING = 4096;    // 每个生产者的环形缓冲区容量（条数，2 的幂）
+    static constexpr int FLUSH_INTERVAL_MS = 100;   // 刷写线程的工作间隔
+
+    /**
+     * @brief 单生产者/单消费者环形缓冲区。head 只由生产者写，tail 只由刷写线程写，各占一个缓存行。
+     */
+    class Ring {
+    public:
+        explicit Ring(size_t capacity) : slots_(new AccessRecord[capacity]), mask_(capacity - 1) {}
+
+        /**
+         * @brief 生产者调用：放入一条记录，缓冲区满时丢弃并返回 false
+         */
+        bool push(const AccessRecord& rec) {
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) > mask_) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+            slots_[head & mask_] = rec;
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class AccessLog;
+
+        std::unique_ptr<AccessRecord[]> slots_;
+        const uint64_t mask_;
+        alignas(64) std::atomic<uint64_t> head_{0};
+        alignas(64) std::atomic<uint64_t> tail_{0};
+        alignas(64) std::atomic<uint64_t> dropped_{0};
+    };
+
+    /**
+     * @brief 以追加方式打开日志文件并启动刷写线程
+     * @param ring_capacity 每个生产者的缓冲区容量，会向上取整到 2 的幂
+     * 打开失败时 ok() 返回 false，由调用者决定如何报错。
+     */
+    explicit AccessLog(const std::string& path, size_t ring_capacity = DEFAULT_RING) {
+        ring_capacity_ = 1;
+        while (ring_capacity_ < ring_capacity) {
+            ring_capacity_ <<= 1;
+        }
+        fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ != -1) {
+            flusher_ = std::thread(&AccessLog::flush_loop, this);
+        }
+    }
+
+    /**
+     * @brief 停止刷写线程，写出缓冲区里剩余的记录
+     */
+    ~AccessLog() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+        if (fd_ != -1) {
+            close(fd_);
+        }
+    }
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    bool ok() const { return fd_ != -1; }
+
+    /**
+     * @brief 为调用线程创建一个环形缓冲区。每个工作线程启动时调用一次，之后只由它 push。
+     */
+    Ring* register_producer() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        rings_.emplace_back(new Ring(ring_capacity_));
+        return rings_.back().get();
+    }
+
+    /**
+     * @brief 所有生产者累计丢弃的记录数
+     */
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        uint64_t total = 0;
+        for (const auto& ring : rings_) {
+            total += ring->dropped();
+        }
+        return total;
+    }
+
+private:
+    void flush_loop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            bool stopping = cv_.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] { return stop_; });
+            // 生产者列表只会增长，拷贝一份指针后在锁外格式化
+            std::vector<Ring*> rings;
+            for (const auto& ring : rings_) {
+                rings.push_back(ring.get());
+            }
+            lock.unlock();
+            flush(rings);
+            lock.lock();
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief 取出每个缓冲区里已提交的记录，各自格式化成一块文本，合起来一次 writev
+     */
+    void flush(const std::vector<Ring*>& rings) {
+        if (batches_.size() < rings.size() + 1) {
+            batches_.resize(rings.size() + 1);
+        }
+        std::vector<struct iovec> iov;
+        uint64_t dropped = 0;
+        for (size_t i = 0; i < rings.size(); i++) {
+            Ring& ring = *rings[i];
+            std::string& out = batches_[i];
+            out.clear();
+            uint64_t tail = ring.tail_.load(std::memory_order_relaxed);
+            uint64_t head = ring.head_.load(std::memory_order_acquire);
+            for (; tail != head; tail++) {
+                format(ring.slots_[tail & ring.mask_], out);
+            }
+            ring.tail_.store(tail, std::memory_order_release); // 记录已经拷进 out，槽位可以复用了
+            dropped += ring.dropped();
+            if (!out.empty()) {
+                iov.push_back({(void*)out.data(), out.size()});
+            }
+        }
+        if (dropped != reported_dropped_) {
+            std::string& note = batches_[rings.size()];
+            note = "# access log dropped " + std::to_string(dropped - reported_dropped_) + " records (ring full)\n";
+            iov.push_back({(void*)note.data(), note.size()});
+            reported_dropped_ = dropped;
+        }
+        write_all(iov);
+    }
+
+    void format(const AccessRecord& rec, std::string& out) {
+        time_t sec = rec.time_us / 1000000;
+        if (sec != cached_sec_) {
+            // 同一秒内的记录共用一次 gmtime_r
+            struct tm tm;
+            gmtime_r(&sec, &tm);
+            strftime(cached_date_, sizeof(cached_date_), "%Y-%m-%dT%H:%M:%S", &tm);
+            cached_sec_ = sec;
+        }
+        char head[64];
+        int n = snprintf(head, sizeof(head), "%s.%06ldZ ", cached_date_, (long)(rec.time_us % 1000000));
+        out.append(head, n);
+        append_token(out, rec.method, rec.method_len);
+        out.push_back(' ');
+        append_token(out, rec.path, rec.path_len);
+        char tail[64];
+        n = snprintf(tail, sizeof(tail), " %u %llu %u\n", (unsigned)rec.status, (unsigned long long)rec.bytes,
+                     (unsigned)rec.latency_us);
+        out.append(tail, n);
+    }
+
+    // 控制字符和空格替换成 '?'，保证一行一条记录、字段之间以空格分隔
+    static void append_token(std::string& out, const char* s, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = s[i];
+            out.push_back(c <= ' ' || c == 0x7f ? '?' : (char)c);
+        }
+    }
+
+    void write_all(std::vector<struct iovec>& iov) {
+        size_t first = 0;
+        while (first < iov.size()) {
+            int count = (int)std::min(iov.size() - first, (size_t)IOV_MAX);
+            ssize_t n = writev(fd_, &iov[first], count);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return; // 写日志失败（比如磁盘满）不能影响服务，丢弃这一批
+            }
+            // 跳过已经完整写出的 iovec，调整写了一半的那个
+            while (first < iov.size() && (size_t)n >= iov[first].iov_len) {
+                n -= iov[first].iov_len;
+                first++;
+            }
+            if (first < iov.size()) {
+                iov[first].iov_base = (char*)iov[first].iov_base + n;
+                iov[first].iov_len -= n;
+            }
+        }
+    }
+
+    int fd_ = -1;
+    size_t ring_capacity_;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::thread flusher_;
+
+    // 以下只由刷写线程使用
+    std::vector<std::string> batches_;   // 每个缓冲区一块格式化好的文本，最后一块留给丢弃计数
+    uint64_t reported_dropped_ = 0;
+    time_t cached_sec_ = -1;
+    char cached_date_[32] = {};
+};
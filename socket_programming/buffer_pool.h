@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <memory>   // std::unique_ptr
+#include <vector>   // std::vector
+
+/**
+ * @brief 固定大小 I/O 缓冲区的池分配器（slab 方式）。
+ *
+ * 一次向系统申请一整块 slab（chunks_per_slab 个 chunk 连续存放），再切成固定大小的 chunk
+ * 挂到空闲链表上。acquire()/release() 只是从空闲链表取出/放回一个指针，没有 malloc/free。
+ *
+ * 用法约定：连接只在"手上有数据要处理"时才持有 chunk，处理完立刻归还。
+ * 这样空闲连接不占用任何缓冲区，池的总内存只取决于同一时刻活跃的连接数，
+ * 而不是总连接数（10 万个空闲连接也不会多占 10 万个缓冲区）。
+ *
+ * 非线程安全：设计上每个 reactor 线程各自持有一个池，不需要加锁。
+ */
+class BufferPool {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 16 * 1024; // 默认 16 KB 一个 chunk
+    static const size_t DEFAULT_CHUNKS_PER_SLAB = 64;   // 每个 slab 64 个 chunk（1 MB）
+
+    explicit BufferPool(size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                        size_t chunks_per_slab = DEFAULT_CHUNKS_PER_SLAB)
+        : chunk_size_(chunk_size), chunks_per_slab_(chunks_per_slab) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief 取出一个 chunk；空闲链表为空时再申请一个新的 slab。
+     * @return char* 长度为 chunk_size() 的缓冲区。
+     */
+    char* acquire() {
+        if (free_.empty()) {
+            grow();
+        }
+        char* chunk = free_.back();
+        free_.pop_back();
+        return chunk;
+    }
+
+    /**
+     * @brief 归还一个由 acquire() 取得的 chunk。
+     */
+    void release(char* chunk) {
+        free_.push_back(chunk);
+    }
+
+    size_t chunk_size() const { return chunk_size_; }
+    size_t capacity() const { return slabs_.size() * chunks_per_slab_; } // 已申请的 chunk 总数
+    size_t in_use() const { return capacity() - free_.size(); }          // 正被连接持有的 chunk 数
+
+private:
+    void grow() {
+        slabs_.emplace_back(new char[chunk_size_ * chunks_per_slab_]);
+        char* base = slabs_.back().get();
+        free_.reserve(capacity());
+        for (size_t i = 0; i < chunks_per_slab_; i++) {
+            free_.push_back(base + i * chunk_size_);
+        }
+    }
+
+    size_t chunk_size_;
+    size_t chunks_per_slab_;
+    std::vector<std::unique_ptr<char[]>> slabs_; // 所有 slab，池销毁时统一释放
+    std::vector<char*> free_;                    // 空闲 chunk 链表（用 vector 当栈，后进先出对缓存更友好）
+};
@@ -9,20 +9,66 @@
 #include <netinet/in.h> // 包含互联网协议地址结构，如 sockaddr_in
 #include <unistd.h>     // Unix 标准函数定义，如 read, write, close
 #include <arpa/inet.h>  // IP地址转换函数，如 inet_ntop, htons, htonl
+#include <errno.h>      // 错误码定义 (errno)
+#include <sys/epoll.h>  // epoll，写线程用它等待慢客户端重新可写
+#include <sys/eventfd.h> // eventfd，通知写线程回收已退出的订阅者
 #include <thread>       // C++11 多线程库
 #include <mutex>        // C++11 互斥锁
+#include <atomic>       // 原子变量，统计丢弃的消息数
+#include <memory>       // std::shared_ptr，订阅者列表和消息都通过引用计数共享
+#include <vector>       // std::vector，订阅者列表
+#include <deque>        // std::deque，每个订阅者的发送队列
 
 // ===================================================================================
 // 全局变量定义
 // ===================================================================================
 
-const int BUF_SIZE = 1024; // 消息缓冲区的大小，用于存储从客户端读取的数据
-const int MAX_CLNT = 100;  // 服务器允许的最大并发客户端数量（硬编码限制）
+const int BUF_SIZE = 1024;     // 消息缓冲区的大小，用于存储从客户端读取的数据
+const int MAX_EVENTS = 256;    // 写线程 epoll 单次调用最多可返回的事件数量
+// 注意：不再有 MAX_CLNT 上限，订阅者列表是动态数组
 
-// 以下是所有线程共享的全局数据，因此必须通过互斥锁来保护，防止竞态条件
-int clnt_count = 0;         // 当前已连接的客户端数量
-int clnt_socks[MAX_CLNT];   // 用于存储所有已连接客户端的套接字文件描述符的数组
-std::mutex mtx;             // 互斥锁，用于保护对 clnt_count 和 clnt_socks 的访问
+// 慢消费者策略：某个客户端的发送队列满了以后怎么办
+enum SlowPolicy {
+    POLICY_DROP,       // 丢弃发给它的新消息，连接保留
+    POLICY_DISCONNECT  // 直接断开这个客户端
+};
+
+SlowPolicy slow_policy = POLICY_DROP;
+size_t max_queue = 256;            // 每个订阅者最多积压多少条消息（--queue N）
+std::atomic<long> dropped_msgs(0); // 因队列满而丢弃的消息总数
+
+typedef std::shared_ptr<const std::string> Message; // 一次广播只分配一份消息，所有订阅者共享
+
+/**
+ * @brief 一个聊天订阅者（已连接的客户端）。
+ * 每个订阅者有自己的有界发送队列和自己的锁：广播时只在入队那一下短暂持有这把锁，
+ * 真正的 send 使用 MSG_DONTWAIT，不会因为对端不读而阻塞。
+ * 套接字在析构时才关闭，保证任何还持有它的线程都不会写到一个被复用的 fd 上。
+ */
+struct Subscriber {
+    int fd;
+    std::mutex mtx;              // 保护下面的发送队列
+    std::deque<Message> queue;   // 待发送的消息
+    size_t head_off = 0;         // 队首消息已发送的字节数
+    bool dead = false;           // 已断开或被踢出，不再接收消息
+    long dropped = 0;            // 这个订阅者被丢弃的消息数
+
+    explicit Subscriber(int sock) : fd(sock) {}
+    ~Subscriber() { close(fd); }
+};
+
+typedef std::vector<std::shared_ptr<Subscriber>> SubscriberList;
+
+// 订阅者列表采用写时复制（copy-on-write）：
+// 广播线程用 std::atomic_load 拿到当前列表的快照后直接遍历，完全不加全局锁；
+// 加入/退出时在 list_mtx 下复制一份新列表并用 std::atomic_store 整体替换，旧快照由引用计数自动回收。
+std::shared_ptr<const SubscriberList> subscribers = std::make_shared<const SubscriberList>();
+std::mutex list_mtx; // 只串行化"修改列表"的线程，读（广播）不需要它
+
+int writer_epfd = -1;  // 写线程的 epoll，所有订阅者都以 EPOLLOUT | EPOLLET 注册
+int graveyard_efd = -1; // 有订阅者退出时通知写线程
+std::mutex graveyard_mtx;
+std::vector<std::shared_ptr<Subscriber>> graveyard; // 已退出但写线程可能还持有其指针的订阅者
 
 // ===================================================================================
 // 辅助函数定义
@@ -39,61 +85,172 @@ void error_handling(std::string message) {
     exit(1);
 }
 
+/**
+ * @brief 把订阅者标记为断开（调用者需持有 sub->mtx）。
+ * shutdown 会让该客户端的读线程从 read() 返回 0，由读线程完成从列表移除等清理工作。
+ */
+void kick_locked(Subscriber* sub) {
+    sub->dead = true;
+    sub->queue.clear();
+    shutdown(sub->fd, SHUT_RDWR);
+}
+
+/**
+ * @brief 以非阻塞方式尽量写出订阅者队列中的消息（调用者需持有 sub->mtx）。
+ * 写到内核发送缓冲区满（EAGAIN）就停下，剩下的由写线程在 EPOLLOUT 时继续。
+ */
+void flush_locked(Subscriber* sub) {
+    while (!sub->queue.empty()) {
+        const std::string& msg = *sub->queue.front();
+        ssize_t n = send(sub->fd, msg.data() + sub->head_off, msg.size() - sub->head_off,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            sub->head_off += n;
+            if (sub->head_off == msg.size()) {
+                sub->queue.pop_front();
+                sub->head_off = 0;
+            }
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            kick_locked(sub);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 把一条消息放进订阅者的发送队列。
+ * 队列原本为空时直接尝试发送（绝大多数情况下一次 send 就写完，无需写线程参与）；
+ * 队列已满时按慢消费者策略处理，不会等待这个客户端。
+ */
+void enqueue(Subscriber* sub, const Message& msg) {
+    std::lock_guard<std::mutex> lock(sub->mtx);
+    if (sub->dead) {
+        return;
+    }
+    if (sub->queue.size() >= max_queue) {
+        if (slow_policy == POLICY_DROP) {
+            sub->dropped++;
+            dropped_msgs++;
+        } else {
+            std::cout << "Slow consumer disconnected: Socket FD=" << sub->fd << std::endl;
+            kick_locked(sub);
+        }
+        return;
+    }
+    bool was_empty = sub->queue.empty();
+    sub->queue.push_back(msg);
+    if (was_empty) {
+        flush_locked(sub);
+    }
+}
+
 /**
  * @brief 将消息广播给所有已连接的客户端
  * @param msg 指向要发送的消息内容的指针
  * @param len 消息的长度
- * 这是一个线程安全的函数，它遍历客户端列表，并向每个客户端发送相同的消息。
+ * 遍历的是订阅者列表的一个快照，不持有任何全局锁；每个订阅者只做一次非阻塞入队，
+ * 因此广播耗时只和订阅者数量有关，与最慢的那个客户端无关。
  */
 void send_msg_to_all(char* msg, int len) {
-    // 在访问或修改共享数据 clnt_socks 和 clnt_count 之前，必须加锁
-    // 这是为了防止其他线程（例如，正在处理客户端断开连接的线程）同时修改这个列表
-    mtx.lock();
-    for (int i = 0; i < clnt_count; i++) {
-        // 将消息写入每个客户端的套接字
-        write(clnt_socks[i], msg, len);
-    }
-    // 操作完成后，必须立即解锁，以便其他线程可以访问共享数据
-    mtx.unlock();
+    std::shared_ptr<const SubscriberList> snapshot = std::atomic_load(&subscribers);
+    Message m = std::make_shared<const std::string>(msg, len);
+    for (const auto& sub : *snapshot) {
+        enqueue(sub.get(), m);
+    }
+}
+
+/**
+ * @brief 写线程：负责把积压在慢客户端队列里的消息写出去。
+ * 订阅者加入时以 EPOLLOUT | EPOLLET 注册一次，之后每当它的发送缓冲区重新有空间，
+ * 边缘触发就会通知这里继续 flush，不需要反复修改关注的事件。
+ */
+void writer_loop() {
+    struct epoll_event events[MAX_EVENTS];
+    while (true) {
+        int nfds = epoll_wait(writer_epfd, events, MAX_EVENTS, -1);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling("epoll_wait() error");
+        }
+        for (int i = 0; i < nfds; i++) {
+            Subscriber* sub = (Subscriber*)events[i].data.ptr;
+            if (sub == nullptr) {
+                uint64_t value;
+                read(graveyard_efd, &value, sizeof(value)); // 只用于唤醒，回收在下面统一进行
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(sub->mtx);
+            if (!sub->dead) {
+                flush_locked(sub);
+            }
+        }
+        // 本轮事件已处理完。墓地里的订阅者都在此前从 epoll 中删除，之后的 epoll_wait 不会再返回它们，
+        // 这时释放写线程这边的引用才是安全的（本轮事件里可能还带着它们的指针）。
+        std::vector<std::shared_ptr<Subscriber>> dead;
+        {
+            std::lock_guard<std::mutex> lock(graveyard_mtx);
+            dead.swap(graveyard);
+        }
+    }
 }
 
 /**
  * @brief 处理单个客户端通信的线程函数
- * @param clnt_sock 该线程负责的客户端的套接字文件描述符
+ * @param sub 该线程负责的订阅者
  * 每个客户端连接后，都会有一个独立的线程来执行这个函数。
  * 该函数负责接收该客户端的消息，并在客户端断开后进行清理工作。
  */
-void handle_client(int clnt_sock) {
+void handle_client(std::shared_ptr<Subscriber> sub) {
     char message[BUF_SIZE]; // 用于接收客户端消息的本地缓冲区
     int str_len;            // read函数返回的实际读取的字节数
 
     // 循环从客户端套接字读取数据
-    // read函数会阻塞，直到客户端发送数据或关闭连接
-    while ((str_len = read(clnt_sock, message, sizeof(message))) > 0) {
+    // read函数会阻塞，直到客户端发送数据或关闭连接（被慢消费者策略踢出时 shutdown 也会让它返回 0）
+    while ((str_len = read(sub->fd, message, sizeof(message))) > 0) {
         // 如果成功读取到数据（str_len > 0），则将该消息广播给所有客户端
-        send_msg_to_all(message, str_len);   
+        send_msg_to_all(message, str_len);
     }
 
     // 如果while循环结束，说明 read() 返回值 <= 0，表示客户端已断开连接
     std::cout << "Client handling thread: Client disconnected, cleaning up..." << std::endl;
 
     // --- 开始清理工作 ---
-    // 同样，修改共享数据 clnt_socks 和 clnt_count 需要加锁
-    mtx.lock();
-    // 在 clnt_socks 数组中找到当前要断开的客户端的套接字
-    for (int i = 0; i < clnt_count; i++) {
-        if (clnt_socks[i] == clnt_sock) {
-            // 为了高效地从数组中移除元素，用最后一个元素覆盖当前元素
-            // 这比将后面所有元素前移一位要快，但会打乱数组顺序（在此场景下无所谓）
-            clnt_socks[i] = clnt_socks[clnt_count - 1];
-            break; // 找到并处理后即可跳出循环
+    {
+        std::lock_guard<std::mutex> lock(sub->mtx);
+        sub->dead = true;
+        sub->queue.clear();
+        if (sub->dropped > 0) {
+            std::cout << "Socket FD=" << sub->fd << " missed " << sub->dropped
+                      << " message(s) while its queue was full" << std::endl;
         }
     }
-    clnt_count--; // 客户端总数减一
-    mtx.unlock();
-
-    // 关闭与该客户端通信的套接字，释放系统资源
-    close(clnt_sock);
+    // 写时复制：生成一份不含当前客户端的新列表，再原子地替换
+    {
+        std::lock_guard<std::mutex> lock(list_mtx);
+        std::shared_ptr<const SubscriberList> old_list = std::atomic_load(&subscribers);
+        auto new_list = std::make_shared<SubscriberList>();
+        new_list->reserve(old_list->size());
+        for (const auto& s : *old_list) {
+            if (s != sub) {
+                new_list->push_back(s);
+            }
+        }
+        std::atomic_store(&subscribers, std::shared_ptr<const SubscriberList>(std::move(new_list)));
+    }
+    epoll_ctl(writer_epfd, EPOLL_CTL_DEL, sub->fd, NULL);
+    // 写线程手上可能还有指向它的事件，把最后一个引用交给写线程，在它处理完本轮事件后再释放（并关闭套接字）
+    {
+        std::lock_guard<std::mutex> lock(graveyard_mtx);
+        graveyard.push_back(std::move(sub));
+    }
+    uint64_t one = 1;
+    write(graveyard_efd, &one, sizeof(one));
     // 注意：这个线程在函数执行完毕后会自动结束
 }
 
@@ -109,9 +266,31 @@ int main(int argc, char** argv) {
     struct sockaddr_in clnt_addr; // 客户端地址结构
     socklen_t clnt_addr_size;     // 客户端地址结构的大小
 
-    // 检查命令行参数，程序需要一个端口号作为参数
-    if (argc != 2) {
-        error_handling("Usage: <port>");
+    // 解析命令行参数：<port> [--slow-policy drop|disconnect] [--queue N]
+    int port = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--slow-policy" && i + 1 < argc) {
+            std::string val = argv[++i];
+            if (val == "drop") {
+                slow_policy = POLICY_DROP;
+            } else if (val == "disconnect") {
+                slow_policy = POLICY_DISCONNECT;
+            } else {
+                port = -1;
+                break;
+            }
+        } else if (arg == "--queue" && i + 1 < argc) {
+            max_queue = atoi(argv[++i]);
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || max_queue == 0) {
+        error_handling("Usage: <port> [--slow-policy drop|disconnect] [--queue N]");
     }
 
     // --- 1. 创建监听套接字 ---
@@ -129,7 +308,7 @@ int main(int argc, char** argv) {
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;                     // 地址族
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);      // IP地址，INADDR_ANY表示监听服务器上所有网络接口
-    serv_addr.sin_port = htons(atoi(argv[1]));          // 端口号，htons()将主机字节序转换为网络字节序
+    serv_addr.sin_port = htons(port);                   // 端口号，htons()将主机字节序转换为网络字节序
 
     // bind() 函数将套接字与指定的IP和端口绑定
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
@@ -142,47 +321,66 @@ int main(int argc, char** argv) {
     if(listen(serv_sock, 5) == -1) {
         error_handling("listen() error");
     }
-    
+
+    // --- 4. 启动写线程 ---
+    writer_epfd = epoll_create1(0);
+    graveyard_efd = eventfd(0, EFD_NONBLOCK);
+    if (writer_epfd == -1 || graveyard_efd == -1) {
+        error_handling("epoll_create1()/eventfd() error");
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // 空指针表示墓地通知
+    epoll_ctl(writer_epfd, EPOLL_CTL_ADD, graveyard_efd, &ev);
+    std::thread(writer_loop).detach();
+
     std::cout << "Server started. Waiting for client connections..." << std::endl;
-    
-    clnt_addr_size = sizeof(clnt_addr);
+
     int i = 0; // 用于给连接的客户端编号
 
-    // --- 4. 主循环：接受连接并创建线程 ---
+    // --- 5. 主循环：接受连接并创建线程 ---
     while(1) {
         // accept() 函数会阻塞，直到有新的客户端连接请求到来
         // 成功时，它会返回一个新的套接字（clnt_sock），专门用于与这个新客户端通信
         // 原始的 serv_sock 继续用于监听新的连接
+        clnt_addr_size = sizeof(clnt_addr);
         clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
         if(clnt_sock == -1) {
             error_handling("accept() error");
         }
         std::cout << "Connected client " << ++i << std::endl;
-        
-        // --- 5. 将新客户端信息注册到共享列表 ---
-        // 因为要修改全局的 clnt_socks 和 clnt_count，必须加锁
-        mtx.lock();
-        clnt_socks[clnt_count++] = clnt_sock;
-        mtx.unlock();
-
-        // --- 6. 创建工作线程 ---
-        // 创建一个新的 std::thread 对象，该线程将执行 handle_client 函数
-        // clnt_sock 作为参数传递给新线程
-        std::thread t(handle_client, clnt_sock);
+
+        // --- 6. 将新客户端注册为订阅者 ---
+        auto sub = std::make_shared<Subscriber>(clnt_sock);
+        struct epoll_event cev;
+        cev.events = EPOLLOUT | EPOLLET;
+        cev.data.ptr = sub.get();
+        epoll_ctl(writer_epfd, EPOLL_CTL_ADD, clnt_sock, &cev);
+        {
+            // 写时复制：复制当前列表、追加新订阅者，再原子地发布新列表
+            std::lock_guard<std::mutex> lock(list_mtx);
+            auto new_list = std::make_shared<SubscriberList>(*std::atomic_load(&subscribers));
+            new_list->push_back(sub);
+            std::atomic_store(&subscribers, std::shared_ptr<const SubscriberList>(std::move(new_list)));
+        }
+
+        // --- 7. 创建读线程 ---
+        // 读线程阻塞在 read() 上，只负责接收这个客户端的消息并广播；发送全部是非阻塞的
+        std::thread t(handle_client, sub);
         // t.detach() 将子线程与主线程分离。主线程不再等待子线程结束（join()）
         // 子线程在后台独立运行。这使得主循环可以立即返回 accept()，继续等待下一个客户端
         t.detach();
-        
-        // --- 7. 打印新客户端的详细信息 ---
+
+        // --- 8. 打印新客户端的详细信息 ---
         char clnt_ip[INET_ADDRSTRLEN]; // INET_ADDRSTRLEN 是IPv4地址字符串的最大长度
         // inet_ntop 将网络字节序的IP地址转换为可读的字符串形式
         inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
         // ntohs 将网络字节序的端口号转换为主机字节序
-        std::cout << "New client connected: IP=" << clnt_ip 
-                    << ", Port=" << ntohs(clnt_addr.sin_port) 
+        std::cout << "New client connected: IP=" << clnt_ip
+                    << ", Port=" << ntohs(clnt_addr.sin_port)
                     << ", Socket FD=" << clnt_sock << std::endl;
     }
-    
+
     // 这行代码实际上永远不会被执行，因为上面的 while(1) 是一个无限循环
     // 在真实的服务器程序中，需要有信号处理机制（如处理Ctrl+C）来优雅地关闭服务器
     close(serv_sock);
@@ -3,6 +3,7 @@
 #include <iostream>                    // 包含标准输入输出流，用于 cout
 #include <ostream>
 #include <string>                      // 包含 std::string
+#include <unordered_map>               // 包含 std::unordered_map，保存每个连接的待发送数据
 #include <sys/socket.h>                // 包含套接字相关的函数和结构体定义
 #include <netinet/in.h>                // 包含互联网地址族结构体（sockaddr_in）
 #include <unistd.h>                    // 包含 POSIX 操作系统 API，如 close, read, write, fork
@@ -10,11 +11,40 @@
 #include <errno.h>                     // 包含错误码定义 (errno)
 #include <sys/epoll.h>                 // 包含 Linux 特有的 I/O 多路复用机制 epoll 的相关函数和宏
 #include <fcntl.h>                     // 包含文件控制选项，如 fcntl 函数
-const int BUF_SIZE = 3;//1024; // 定义缓冲区大小，用于存储客户端发送的消息
+#include <chrono>                      // 包含 steady_clock，用于空闲超时
+#include "timer_wheel.h"               // 分层时间轮，给每个连接挂空闲超时
+const int BUF_SIZE = 1024; // 定义缓冲区大小，用于存储客户端发送的消息
 const int MAX_EVENTS = 1024; // 定义 epoll 单次调用最多可返回的事件数量
+// 单个连接允许积压的待发送字节数上限。超过后暂停读取该连接（不再读到 EAGAIN），
+// 直到对端把数据收走，这就是写方向的背压：慢客户端只会拖慢自己，不会让服务器内存无限增长。
+const size_t MAX_PENDING = 1024 * 1024;
 
 #define ISPRINT true // 宏定义，用于控制错误信息是否打印到控制台
 
+/**
+ * @brief 每个客户端连接的状态。
+ * 边缘触发模式下，一次 EPOLLOUT 通知之后内核不会重复提醒，
+ * 所以没写完的数据必须保存在这里，等下一次可写边沿到来时继续发送。
+ */
+struct Connection {
+    std::string pending;       // 尚未写入套接字的回显数据
+    bool want_write = false;   // 当前是否在 epoll 中注册了 EPOLLOUT
+    bool read_paused = false;  // 是否因 pending 超过 MAX_PENDING 而暂停了读取
+    TimerWheel::TimerId timer = TimerWheel::INVALID; // 空闲超时定时器，每次有事件就顺延
+};
+
+/**
+ * @brief 单调时钟的当前时间（毫秒）
+ */
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::unordered_map<int, Connection> conns; // fd -> 连接状态
+TimerWheel timers(now_ms());               // 所有连接的超时定时器
+int idle_timeout_sec = 60;                 // --idle-timeout: 连接多少秒没有任何事件就关闭，0 表示不超时
+
 /**
  * @brief 统一的错误处理函数。
  * 打印指定的错误信息并终止程序运行。
@@ -29,11 +59,122 @@ void error_handling(std::string message) {
 }
 
 /**
- * @brief 主函数，实现一个基于 epoll 的高并发 TCP Echo 服务器。
+ * @brief 关闭一个客户端连接：从 epoll 中移除、关闭套接字并丢弃其状态。
+ */
+void close_connection(int epoll_fd, int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    auto it = conns.find(fd);
+    if (it != conns.end()) {
+        timers.cancel(it->second.timer);
+        conns.erase(it);
+    }
+}
+
+/**
+ * @brief 根据连接是否还有待发送数据，切换 EPOLLOUT 的注册状态。
+ * 只在有积压数据时关注可写事件，数据写完立刻取消，避免无意义的唤醒。
+ */
+void update_interest(int epoll_fd, int fd, Connection& conn) {
+    bool want_write = !conn.pending.empty();
+    if (want_write == conn.want_write) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    if (want_write) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        error_handling("epoll_ctl() mod clnt_sock error");
+    }
+    conn.want_write = want_write;
+}
+
+/**
+ * @brief 尽可能多地把 pending 中的数据写入套接字，直到写完或遇到 EAGAIN。
+ *
+ * @return bool 连接仍然可用返回 true；写出错（如对端已重置）返回 false。
+ */
+bool flush_pending(int fd, Connection& conn) {
+    size_t sent = 0;
+    while (sent < conn.pending.size()) {
+        // MSG_NOSIGNAL: 对端已关闭时返回 EPIPE 而不是触发 SIGPIPE 杀死整个进程
+        ssize_t n = send(fd, conn.pending.data() + sent, conn.pending.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break; // 发送缓冲区满了，剩下的等 EPOLLOUT
+        } else {
+            std::cerr << "send() error: " << strerror(errno) << " on socket " << fd << std::endl;
+            return false;
+        }
+    }
+    conn.pending.erase(0, sent);
+    return true;
+}
+
+/**
+ * @brief 边缘触发下的读处理：一直读到 EAGAIN 为止，读到的数据追加到 pending 后尝试立即发送。
+ *
+ * @return bool 连接仍然可用返回 true；对端关闭或出错返回 false。
+ */
+bool handle_read(int fd, Connection& conn, char* message) {
+    conn.read_paused = false;
+    while(true) {
+        if (conn.pending.size() >= MAX_PENDING) {
+            // 对端不收数据，先别再读了；等 pending 排空后由 EPOLLOUT 处理恢复读取
+            conn.read_paused = true;
+            return true;
+        }
+
+        int str_len = read(fd, message, BUF_SIZE);
+
+        if(str_len == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 如果是 EAGAIN，则说明内核缓冲区已经读空，本次边沿的数据全部处理完毕。
+                return true;
+            }
+            // 发生了其他严重错误（例如，网络中断），应该关闭连接
+            std::cerr << "read() error: " << strerror(errno) << " (errno: " << errno << ") on socket " << fd << std::endl;
+            return false;
+        } else if(str_len == 0) {
+            // read() 返回 0 表示对端（客户端）已正常关闭连接（发送了 FIN）。
+            std::cout << "Client disconnected (socket " << fd << ")" << std::endl;
+            return false;
+        }
+
+        // 成功读取到数据
+        std::cout << "Message from client " << fd << ": " << std::string(message, str_len) << std::endl;
+
+        // 将收到的数据追加到待发送队列。只有在队列原本为空时才直接写，保证回显顺序不乱。
+        bool was_empty = conn.pending.empty();
+        conn.pending.append(message, str_len);
+        if (was_empty && !flush_pending(fd, conn)) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief 主函数，实现一个基于 epoll 边缘触发（ET）模式的 TCP Echo 服务器。
  * 该服务器能够同时处理多个客户端连接，并将任何收到的数据原样回送给客户端。
  *
+ * 与水平触发不同，ET 模式下每次状态变化只通知一次，因此：
+ *   1. 套接字必须是非阻塞的，读要一直读到 EAGAIN，否则剩余数据不会再触发通知；
+ *   2. 写不完的数据保存在连接的 pending 缓冲区中，只在有积压时注册 EPOLLOUT，写空后立即注销；
+ *   3. 单个连接的读写错误只关闭该连接，不会终止整个服务器；
+ *   4. 连接超过 --idle-timeout 秒没有任何事件就关闭。边缘触发下对端不收数据时也不会再有 EPOLLOUT，
+ *      所以这个超时同时覆盖了读、写两个方向，死连接和慢速攻击不会一直占着 fd 和 pending 内存。
+ *
  * @param argc 命令行参数的数量。
- * @param argv 命令行参数数组，argv[1] 应为服务器绑定的端口号。
+ * @param argv 命令行参数数组：<port> [--idle-timeout SEC]。
  * @return int 程序的退出状态码。
  */
 int main(int argc, char** argv) {
@@ -44,13 +185,25 @@ int main(int argc, char** argv) {
     struct sockaddr_in serv_addr; // 服务器地址信息结构体
     struct sockaddr_in clnt_addr; // 客户端地址信息结构体
     socklen_t clnt_addr_size;    // 客户端地址结构体的长度，用于 accept 函数
-    char message[BUF_SIZE];       // 用于接收和发送数据的缓冲区
-    
+    char message[BUF_SIZE];       // 用于接收数据的缓冲区
+
     // --- 1. 初始化和参数检查 ---
-    if (argc != 2) {
-        // 检查命令行参数，确保用户提供了端口号
-        std::cout << "Usage: " << argv[0] << " <port>" << std::endl;
-        error_handling("Incorrect number of arguments");
+    int port = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--idle-timeout" && i + 1 < argc) {
+            idle_timeout_sec = atoi(argv[++i]);
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || idle_timeout_sec < 0) {
+        // 检查命令行参数，确保用户提供了端口号，不认识的参数同样报错
+        std::cout << "Usage: " << argv[0] << " <port> [--idle-timeout SEC]" << std::endl;
+        error_handling("Incorrect arguments");
     }
 
     // --- 2. 创建服务器套接字 ---
@@ -62,7 +215,7 @@ int main(int argc, char** argv) {
 
     // 设置套接字选项 SO_REUSEADDR，防止服务器重启时因端口处于 TIME_WAIT 状态而绑定失败
     int optval = 1;
-    if(setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, 
+    if(setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR,
                   (void*)&optval, sizeof(optval)) == -1) {
         error_handling("setsockopt() error");
     }
@@ -76,9 +229,9 @@ int main(int argc, char** argv) {
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET; // 地址族为 IPv4
     // INADDR_ANY 表示服务器将监听（绑定）所有可用的网络接口（IP地址）
-    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY); 
+    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     // 将命令行传入的端口号字符串转为整数，并从主机字节序转换到网络字节序
-    serv_addr.sin_port = htons(atoi(argv[1]));
+    serv_addr.sin_port = htons(port);
 
     // 将套接字与指定的 IP 地址和端口号绑定
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
@@ -107,7 +260,8 @@ int main(int argc, char** argv) {
     struct epoll_event ev;
     // 设置要监控的事件类型：
     // EPOLLIN: 表示对应的文件描述符可读（包括对端正常关闭连接）。
-    ev.events = EPOLLIN; // 使用边缘触发模式（Edge Triggered）
+    // 监听套接字也使用边缘触发，因此每次通知都要 accept 到 EAGAIN 为止。
+    ev.events = EPOLLIN | EPOLLET; // 使用边缘触发模式（Edge Triggered）
     // ev.data 是一个联合体，我们使用其 fd 成员来存储与事件关联的文件描述符。
     // 当 epoll_wait 返回时，我们可以通过 events[i].data.fd 知道是哪个 fd 产生了事件。
     ev.data.fd = serv_sock;
@@ -122,15 +276,16 @@ int main(int argc, char** argv) {
     struct epoll_event *events = new epoll_event[MAX_EVENTS]; // 使用 new/delete 更符合C++风格
 
     // --- 6. 服务器主循环 ---
-    std::cout << "Server started on port " << argv[1] << ", waiting for connections..." << std::endl;
+    std::cout << "Server started on port " << port << ", waiting for connections..." << std::endl;
     while(true) {
         // 等待事件发生。
         // epoll_fd: epoll 实例的文件描述符。
         // events: 指向一个 epoll_event 数组，内核将就绪的事件复制到这个数组中。
         // MAX_EVENTS: 告诉内核本次最多可以返回多少个事件。
-        // -1: 表示永久阻塞，直到有事件发生。如果设置为 0，则非阻塞；如果为正数，则超时（毫秒）。
-        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
-        
+        // 超时：-1 表示永久阻塞，直到有事件发生。如果设置为 0，则非阻塞；如果为正数，则超时（毫秒）。
+        // 这里由时间轮给出：没有定时器时永久阻塞，否则最多等到最近的定时器到期。
+        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, timers.timeout_ms(now_ms(), -1));
+
         if(nfds == -1) {
             // 如果 epoll_wait 被信号中断，可以继续等待
             if (errno == EINTR) {
@@ -140,6 +295,7 @@ int main(int argc, char** argv) {
         }
 
         std::cout << "epoll_wait() returned "  << std::endl;
+        int64_t loop_now = now_ms(); // 同一轮的事件共用这个时间，避免反复读时钟
 
         // 遍历所有发生的事件
         for(int i = 0; i < nfds; i++) {
@@ -149,79 +305,88 @@ int main(int argc, char** argv) {
             if(current_fd == serv_sock) {
                 // --- 处理新连接 ---
                 // 如果是服务器监听套接字可读，表明有新的客户端连接请求到达。
-                
-                clnt_addr_size = sizeof(clnt_addr);
-                // accept() 会从监听队列中取出第一个连接请求，创建一个新的套接字用于与该客户端通信。
-                clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
-                
-                if(clnt_sock == -1) {
-                    error_handling("accept() error");
-                }
+                // 边缘触发下一次通知可能对应多个排队的连接，所以循环 accept 直到 EAGAIN。
+                while (true) {
+                    clnt_addr_size = sizeof(clnt_addr);
+                    // accept() 会从监听队列中取出第一个连接请求，创建一个新的套接字用于与该客户端通信。
+                    clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
 
-                // 获取客户端的IP和端口信息并打印
-                char clnt_ip[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
-                std::cout << "New client connected: IP=" << clnt_ip 
-                          << ", Port=" << ntohs(clnt_addr.sin_port) 
-                          << ", Socket=" << clnt_sock << std::endl;
-                
-                flags = fcntl(clnt_sock, F_GETFL, 0); // 获取客户端套接字的当前文件控制选项
-                fcntl(clnt_sock, F_SETFL, flags | O_NONBLOCK); // 设置客户端套接字为非阻塞模式
-                // 将新创建的客户端套接字也加入到 epoll 的监控中，以便接收其数据。
-                ev.events = EPOLLIN ;//| EPOLLET; // 使用边缘触发模式（Edge Triggered）
-                ev.data.fd = clnt_sock;
-                if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &ev) == -1) {
-                    error_handling("epoll_ctl() add clnt_sock error");
+                    if(clnt_sock == -1) {
+                        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                            break; // 排队的连接已全部取完
+                        }
+                        if (errno == EINTR || errno == ECONNABORTED) {
+                            continue;
+                        }
+                        // 如 EMFILE（fd 用尽）：只打印，不终止服务器，已建立的连接照常服务
+                        std::cerr << "accept() error: " << strerror(errno) << std::endl;
+                        break;
+                    }
+
+                    // 获取客户端的IP和端口信息并打印
+                    char clnt_ip[INET_ADDRSTRLEN];
+                    inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
+                    std::cout << "New client connected: IP=" << clnt_ip
+                              << ", Port=" << ntohs(clnt_addr.sin_port)
+                              << ", Socket=" << clnt_sock << std::endl;
+
+                    flags = fcntl(clnt_sock, F_GETFL, 0); // 获取客户端套接字的当前文件控制选项
+                    fcntl(clnt_sock, F_SETFL, flags | O_NONBLOCK); // 设置客户端套接字为非阻塞模式
+                    // 将新创建的客户端套接字也加入到 epoll 的监控中，以便接收其数据。
+                    // EPOLLRDHUP: 对端关闭写方向时也能收到通知。EPOLLOUT 只在有积压数据时才注册。
+                    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET; // 使用边缘触发模式（Edge Triggered）
+                    ev.data.fd = clnt_sock;
+                    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &ev) == -1) {
+                        error_handling("epoll_ctl() add clnt_sock error");
+                    }
+                    Connection& conn = conns[clnt_sock];
+                    conn = Connection();
+                    if (idle_timeout_sec > 0) {
+                        conn.timer = timers.add(loop_now + idle_timeout_sec * 1000LL, clnt_sock);
+                    }
                 }
 
             } else {
+                // --- 处理客户端事件 ---
+                auto it = conns.find(current_fd);
+                if (it == conns.end()) {
+                    continue; // 本轮中已被关闭的连接
+                }
+                Connection& conn = it->second;
+                uint32_t revents = events[i].events;
+                bool alive = true;
+                timers.reset(conn.timer, loop_now + idle_timeout_sec * 1000LL); // O(1) 顺延空闲超时
 
-                while(true) {
-                    // --- 处理客户端数据 ---
-                    // 否则是某个客户端套接字可读，表明有数据可读或连接已关闭。
-                    
-                    int str_len = read(current_fd, message, sizeof(message) - 1); // 预留一个位置给'\0'
-                    
-                    if(str_len == -1) {
-                        if(errno == EAGAIN || errno == EWOULDBLOCK) {
-                            // 如果是 EAGAIN，则说明没有数据可读，可以继续等待。
-                            break;
-                        } else {
-                            // 发生了其他严重错误（例如，网络中断），应该关闭连接
-                            std::cerr << "read() error: " << strerror(errno) << " (errno: " << errno << ") on socket " << current_fd << std::endl;
-                            
-                            // 从 epoll 中移除并关闭 socket
-                            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                            close(current_fd);
-                            
-                            break; // <<<--- 修复点1: 出错后也要跳出内部循环
-                        }
-                    } else if(str_len == 0) {
-                        // read() 返回 0 表示对端（客户端）已正常关闭连接（发送了 FIN）。
-                        std::cout << "Client disconnected (socket " << current_fd << ")" << std::endl;
-                        
-                        // 从 epoll 实例中移除对该文件描述符的监控。
-                        // EPOLL_CTL_DEL: 表示从监控列表中删除一个文件描述符。
-                        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                        // 关闭与该客户端通信的套接字，释放资源。
-                        close(current_fd);
-                        break;
+                if (revents & EPOLLERR) {
+                    alive = false;
+                }
 
-                    } else if(str_len > 0) {
-                        // 成功读取到数据
-                        message[str_len] = '\0'; // 添加字符串结束符，以便安全输出
-                        
-                        std::cout << "Message from client " << current_fd << ": " << message << std::endl;
-                        
-                        // 将收到的数据原样回写给客户端。
-                        // 注意：一个完整的回显服务可能需要处理 write 的部分写入情况。
-                        if(write(current_fd, message, str_len) == -1) {
-                            error_handling("write() error");
-                        }
+                // 可写：继续发送积压的数据；排空后若之前因背压暂停了读取，则恢复读取
+                if (alive && (revents & EPOLLOUT)) {
+                    alive = flush_pending(current_fd, conn);
+                    if (alive && conn.read_paused && conn.pending.size() < MAX_PENDING) {
+                        alive = handle_read(current_fd, conn, message);
                     }
                 }
+
+                // 可读（或对端半关闭）：一直读到 EAGAIN / EOF
+                if (alive && (revents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                    alive = handle_read(current_fd, conn, message);
+                }
+
+                if (!alive) {
+                    close_connection(epoll_fd, current_fd);
+                } else {
+                    update_interest(epoll_fd, current_fd, conn);
+                }
             }
         }
+
+        // --- 空闲超时：只处理到期的定时器，不扫描全部连接 ---
+        timers.advance(now_ms(), [&](uint64_t fd) {
+            std::cout << "Client timed out (socket " << fd << ")" << std::endl;
+            close_connection(epoll_fd, (int)fd);
+        });
     }
 
     // --- 7. 清理资源 ---
@@ -229,6 +394,6 @@ int main(int argc, char** argv) {
     close(serv_sock);         // 关闭服务器监听套接字
     close(epoll_fd);          // 关闭 epoll 实例
     delete[] events;          // 释放事件数组内存
-    
+
     return 0;
 }
@@ -0,0 +1,388 @@
+#include <cstring>                     // 包含内存操作函数，如 memset
+#include <iostream>                    // 包含标准输入输出流
+#include <iomanip>                     // 包含 std::setprecision，格式化输出结果
+#include <string>                      // 包含 std::string
+#include <vector>                      // 包含 std::vector
+#include <deque>                       // 包含 std::deque，记录每个连接在途消息的发送时间
+#include <thread>                      // 包含 std::thread，多线程发压
+#include <atomic>                      // 包含 std::atomic，停止标志
+#include <chrono>                      // 包含计时工具
+#include <random>                      // 包含随机数，用于随机大小的消息
+#include <sys/socket.h>                // 包含套接字相关的函数和结构体定义
+#include <sys/resource.h>              // 包含 setrlimit，提高可打开的 fd 上限
+#include <netinet/in.h>                // 包含互联网地址族结构体（sockaddr_in）
+#include <netinet/tcp.h>               // 包含 TCP_NODELAY
+#include <unistd.h>                    // 包含 POSIX 操作系统 API，如 close, read, write
+#include <arpa/inet.h>                 // 包含网络地址转换函数，如 inet_addr
+#include <errno.h>                     // 包含错误码定义 (errno)
+#include <fcntl.h>                     // 包含 fcntl，设置非阻塞
+#include <sys/epoll.h>                 // 包含 epoll，每个发压线程用一个 epoll 驱动所有连接
+#include "hdr_histogram.h"             // 延迟直方图
+
+const int MAX_EVENTS = 1024;      // epoll 单次调用最多可返回的事件数量
+const int RECV_BUF_SIZE = 64 * 1024; // 接收缓冲区大小（回显内容不需要保留，只统计字节数）
+
+void error_handling(std::string message) {
+    std::cout << message << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief 压测参数，全部来自命令行。
+ */
+struct Options {
+    std::string ip;
+    int port = 0;
+    int conns = 100;          // 总连接数
+    int threads = 1;          // 发压线程数，连接平均分到各线程
+    int size_min = 64;        // 消息大小（字节）；size_max > size_min 时每条消息在区间内随机
+    int size_max = 64;
+    bool pipeline = false;    // false: ping-pong（一问一答）；true: 流水线（每个连接最多 depth 条在途）
+    int depth = 16;           // 流水线深度
+    double duration = 10;     // 统计时长（秒）
+    double warmup = 1;        // 预热时长（秒），这段时间内的数据不计入结果
+};
+
+Options opt;
+std::atomic<bool> stop_flag(false);
+std::atomic<bool> measuring(false);
+
+using Clock = std::chrono::steady_clock;
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 一个压测连接的状态。
+ * 回显服务器按字节流原样返回数据，因此不需要解析内容：
+ * 每发出一条消息就记下它在"累计发送字节流"中的结束位置和发送时间，
+ * 当累计接收字节数越过这个位置时，这条消息的 RTT 就确定了。
+ */
+struct BenchConn {
+    int fd = -1;
+    bool connected = false;
+    bool want_write = false;       // 当前是否在 epoll 中注册了 EPOLLOUT
+    int64_t sent_total = 0;        // 已写出的累计字节数
+    int64_t recv_total = 0;        // 已收到的累计字节数
+    int64_t cur_end = 0;           // 正在写的消息的结束位置（== sent_total 表示没有写了一半的消息）
+    struct InFlight {
+        int64_t end;               // 消息在累计字节流中的结束位置
+        int64_t start_ns;          // 消息开始写出的时间
+    };
+    std::deque<InFlight> inflight; // 已开始发送、尚未完整收到回显的消息
+};
+
+/**
+ * @brief 每个发压线程的统计结果，线程结束后由主线程汇总。
+ */
+struct ThreadStats {
+    HdrHistogram rtt;              // RTT（纳秒）
+    int64_t messages = 0;          // 统计期内完成的消息数
+    int64_t bytes = 0;             // 统计期内收到的回显字节数
+    int64_t connect_errors = 0;
+    int64_t io_errors = 0;
+};
+
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+void update_interest(int epoll_fd, BenchConn& c, bool want_write) {
+    if (want_write == c.want_write) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (want_write ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.ptr = &c;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.want_write = want_write;
+}
+
+/**
+ * @brief 尽量多地发送消息：ping-pong 模式最多 1 条在途，流水线模式最多 depth 条在途。
+ *
+ * @return bool 连接仍然可用返回 true。
+ */
+bool pump_send(int epoll_fd, BenchConn& c, const char* payload, std::mt19937& rng) {
+    size_t limit = opt.pipeline ? (size_t)opt.depth : 1;
+    std::uniform_int_distribution<int> size_dist(opt.size_min, opt.size_max);
+    while (true) {
+        if (c.cur_end == c.sent_total) {
+            // 当前没有写了一半的消息，看看能否开始一条新的
+            if (c.inflight.size() >= limit || stop_flag.load(std::memory_order_relaxed)) {
+                update_interest(epoll_fd, c, false);
+                return true;
+            }
+            int size = size_dist(rng);
+            c.cur_end = c.sent_total + size;
+            c.inflight.push_back({c.cur_end, now_ns()});
+        }
+        // payload 至少有 size_max 字节，内容对回显测试无关紧要，剩余部分总是从头取
+        int64_t remaining = c.cur_end - c.sent_total;
+        ssize_t n = send(c.fd, payload, remaining, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.sent_total += n;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            update_interest(epoll_fd, c, true);
+            return true;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief 发压线程：用一个 epoll 驱动分配给自己的全部连接。
+ */
+void bench_thread(int conn_count, unsigned seed, ThreadStats* stats) {
+    std::mt19937 rng(seed);
+    std::vector<char> payload(opt.size_max);
+    for (auto& ch : payload) {
+        ch = 'a' + rng() % 26;
+    }
+    std::vector<char> recv_buf(RECV_BUF_SIZE);
+
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        error_handling("epoll_create1() error");
+    }
+
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_addr.s_addr = inet_addr(opt.ip.c_str());
+    serv_addr.sin_port = htons(opt.port);
+
+    // --- 1. 发起全部非阻塞 connect ---
+    std::vector<BenchConn> conns(conn_count);
+    for (auto& c : conns) {
+        c.fd = socket(PF_INET, SOCK_STREAM, 0);
+        if (c.fd == -1) {
+            error_handling("socket() error (raise ulimit -n?)");
+        }
+        set_nonblocking(c.fd);
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(c.fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1 && errno != EINPROGRESS) {
+            stats->connect_errors++;
+            close(c.fd);
+            c.fd = -1;
+            continue;
+        }
+        // 连接建立完成时套接字变为可写
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.ptr = &c;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c.fd, &ev);
+        c.want_write = true;
+    }
+
+    auto drop = [&](BenchConn& c) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, NULL);
+        close(c.fd);
+        c.fd = -1;
+    };
+
+    // --- 2. 事件循环 ---
+    std::vector<struct epoll_event> events(MAX_EVENTS);
+    while (!stop_flag.load(std::memory_order_relaxed)) {
+        int nfds = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, 100);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling("epoll_wait() error");
+        }
+        for (int i = 0; i < nfds; i++) {
+            BenchConn& c = *(BenchConn*)events[i].data.ptr;
+            if (c.fd == -1) {
+                continue;
+            }
+            uint32_t revents = events[i].events;
+
+            if (!c.connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0 || (revents & (EPOLLERR | EPOLLHUP))) {
+                    stats->connect_errors++;
+                    drop(c);
+                    continue;
+                }
+                c.connected = true;
+            }
+
+            if (revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                ssize_t n = read(c.fd, recv_buf.data(), recv_buf.size());
+                if (n <= 0) {
+                    if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+                        continue;
+                    }
+                    stats->io_errors++;
+                    drop(c);
+                    continue;
+                }
+                c.recv_total += n;
+                bool counting = measuring.load(std::memory_order_relaxed);
+                if (counting) {
+                    stats->bytes += n;
+                }
+                int64_t t = now_ns();
+                while (!c.inflight.empty() && c.inflight.front().end <= c.recv_total) {
+                    if (counting) {
+                        stats->rtt.record(t - c.inflight.front().start_ns);
+                        stats->messages++;
+                    }
+                    c.inflight.pop_front();
+                }
+            }
+
+            if (!pump_send(epoll_fd, c, payload.data(), rng)) {
+                stats->io_errors++;
+                drop(c);
+            }
+        }
+    }
+
+    for (auto& c : conns) {
+        if (c.fd != -1) {
+            close(c.fd);
+        }
+    }
+    close(epoll_fd);
+}
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " <IP> <port> [options]\n"
+              << "  --conns N        total connections (default 100)\n"
+              << "  --threads N      load generator threads (default 1)\n"
+              << "  --size N         message size in bytes (default 64)\n"
+              << "  --size-max N     random message size in [size, size-max]\n"
+              << "  --mode M         pingpong | pipeline (default pingpong)\n"
+              << "  --depth N        in-flight messages per connection in pipeline mode (default 16)\n"
+              << "  --duration S     measured seconds (default 10)\n"
+              << "  --warmup S       warm-up seconds not counted (default 1)" << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief 主函数：回显服务器压测工具。
+ * 从多个线程打开大量并发连接，按 ping-pong 或流水线方式发送固定/随机大小的消息，
+ * 输出每秒消息数、吞吐量（MB/s）以及 RTT 的 p50/p99/p999 等分位数，
+ * 用同一套负载对比 select、epoll、io_uring、多线程和多进程版本的回显服务器。
+ */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+    }
+    opt.ip = argv[1];
+    opt.port = atoi(argv[2]);
+    bool size_max_set = false;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+        }
+        std::string val = argv[++i];
+        if (arg == "--conns") {
+            opt.conns = std::stoi(val);
+        } else if (arg == "--threads") {
+            opt.threads = std::stoi(val);
+        } else if (arg == "--size") {
+            opt.size_min = std::stoi(val);
+        } else if (arg == "--size-max") {
+            opt.size_max = std::stoi(val);
+            size_max_set = true;
+        } else if (arg == "--mode") {
+            if (val != "pingpong" && val != "pipeline") {
+                print_usage(argv[0]);
+            }
+            opt.pipeline = val == "pipeline";
+        } else if (arg == "--depth") {
+            opt.depth = std::stoi(val);
+        } else if (arg == "--duration") {
+            opt.duration = std::stod(val);
+        } else if (arg == "--warmup") {
+            opt.warmup = std::stod(val);
+        } else {
+            print_usage(argv[0]);
+        }
+    }
+    if (!size_max_set || opt.size_max < opt.size_min) {
+        opt.size_max = opt.size_min;
+    }
+    if (opt.conns <= 0 || opt.threads <= 0 || opt.size_min <= 0 || opt.depth <= 0) {
+        print_usage(argv[0]);
+    }
+    if (opt.threads > opt.conns) {
+        opt.threads = opt.conns;
+    }
+
+    // 上千个连接很容易超过默认的 1024 个 fd 限制，尽量提高到硬上限
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    std::cout << "Benchmarking " << opt.ip << ":" << opt.port << " with " << opt.conns
+              << " connections on " << opt.threads << " thread(s), "
+              << (opt.pipeline ? "pipeline depth " + std::to_string(opt.depth) : std::string("ping-pong"))
+              << ", message size " << opt.size_min;
+    if (opt.size_max != opt.size_min) {
+        std::cout << "-" << opt.size_max;
+    }
+    std::cout << " bytes" << std::endl;
+
+    std::vector<ThreadStats> stats(opt.threads);
+    std::vector<std::thread> workers;
+    std::random_device rd;
+    for (int t = 0; t < opt.threads; t++) {
+        int count = opt.conns / opt.threads + (t < opt.conns % opt.threads ? 1 : 0);
+        workers.emplace_back(bench_thread, count, rd(), &stats[t]);
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.warmup));
+    measuring = true;
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.duration));
+    measuring = false;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    stop_flag = true;
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    // --- 汇总结果 ---
+    HdrHistogram rtt;
+    int64_t messages = 0, bytes = 0, connect_errors = 0, io_errors = 0;
+    for (auto& s : stats) {
+        rtt.merge(s.rtt);
+        messages += s.messages;
+        bytes += s.bytes;
+        connect_errors += s.connect_errors;
+        io_errors += s.io_errors;
+    }
+
+    auto us = [](int64_t ns) { return ns / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Duration:    " << elapsed << " s" << std::endl;
+    std::cout << "Messages:    " << messages << " (" << messages / elapsed << " msgs/s)" << std::endl;
+    std::cout << "Throughput:  " << std::setprecision(2) << bytes / elapsed / 1e6 << " MB/s" << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << "RTT (us):    min " << us(rtt.min())
+              << "  mean " << us((int64_t)rtt.mean())
+              << "  p50 " << us(rtt.value_at_percentile(50))
+              << "  p90 " << us(rtt.value_at_percentile(90))
+              << "  p99 " << us(rtt.value_at_percentile(99))
+              << "  p999 " << us(rtt.value_at_percentile(99.9))
+              << "  max " << us(rtt.max()) << std::endl;
+    if (connect_errors > 0 || io_errors > 0) {
+        std::cout << "Errors:      connect " << connect_errors << ", io " << io_errors << std::endl;
+    }
+    return 0;
+}
@@ -1,18 +1,29 @@
 #include <cstring>                     // 包含内存操作函数，如 memset
 #include <iostream>                    // 包含标准输入输出流，用于 cout
 #include <string>                      // 包含 std::string
+#include <vector>                      // 包含 std::vector，用于保存各个 reactor 线程
+#include <thread>                      // 包含 std::thread，多 reactor 模式下每个线程一个 epoll 循环
+#include <mutex>                       // 包含 std::mutex，用于多线程下串行化日志输出
+#include <unordered_map>               // 包含 std::unordered_map，保存每个连接的状态
+#include <chrono>                      // 包含 steady_clock，用于空闲超时
 #include <sys/socket.h>                // 包含套接字相关的函数和结构体定义
 #include <netinet/in.h>                // 包含互联网地址族结构体（sockaddr_in）
 #include <unistd.h>                    // 包含 POSIX 操作系统 API，如 close, read, write, fork
 #include <arpa/inet.h>                 // 包含网络地址转换函数，如 htonl, htons, inet_addr
 #include <errno.h>                     // 包含错误码定义 (errno)
+#include <fcntl.h>                     // 包含 open，预留一个空闲 fd 应对 EMFILE
 #include <sys/epoll.h>                 // 包含 Linux 特有的 I/O 多路复用机制 epoll 的相关函数和宏
+#include "buffer_pool.h"               // 固定大小 I/O 缓冲区池，替代原来 3 字节的栈上缓冲区
+#include "timer_wheel.h"               // 分层时间轮，给每个连接挂空闲超时
 
-const int BUF_SIZE = 3;//1024; // 定义缓冲区大小，用于存储客户端发送的消息
 const int MAX_EVENTS = 1024; // 定义 epoll 单次调用最多可返回的事件数量
 
 #define ISPRINT true // 宏定义，用于控制错误信息是否打印到控制台
 
+bool quiet = false;  // --quiet: 关闭逐连接/逐消息日志，压测时避免 cout 成为瓶颈
+int idle_timeout_sec = 60; // --idle-timeout: 连接多少秒没有任何读写进展就关闭，0 表示不超时
+std::mutex log_mtx;  // 多个 reactor 线程共享 cout，需要加锁避免输出交错
+
 /**
  * @brief 统一的错误处理函数。
  * 打印指定的错误信息并终止程序运行。
@@ -27,70 +38,149 @@ void error_handling(std::string message) {
 }
 
 /**
- * @brief 主函数，实现一个基于 epoll 的高并发 TCP Echo 服务器。
- * 该服务器能够同时处理多个客户端连接，并将任何收到的数据原样回送给客户端。
+ * @brief 线程安全的日志输出，--quiet 时直接忽略。
  *
- * @param argc 命令行参数的数量。
- * @param argv 命令行参数数组，argv[1] 应为服务器绑定的端口号。
- * @return int 程序的退出状态码。
+ * @param line 要输出的一行日志（不含换行）。
  */
-int main(int argc, char** argv) {
+void log_line(const std::string& line) {
+    if (quiet) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(log_mtx);
+    std::cout << line << std::endl;
+}
 
-    int serv_sock;               // 服务器监听套接字的文件描述符
-    int clnt_sock;               // 与特定客户端通信的套接字文件描述符
+/**
+ * @brief 单调时钟的当前时间（毫秒）
+ */
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
+/**
+ * @brief 创建、绑定并监听一个 TCP 服务器套接字。
+ *
+ * @param port 监听端口。
+ * @param reuse_port 是否设置 SO_REUSEPORT。多 reactor 模式下每个线程各自持有一个监听套接字，
+ *                   内核按四元组哈希把新连接分散到这些套接字上，线程之间无需共享 accept 队列。
+ * @return int 监听套接字的文件描述符。
+ */
+int create_listen_socket(int port, bool reuse_port) {
     struct sockaddr_in serv_addr; // 服务器地址信息结构体
-    struct sockaddr_in clnt_addr; // 客户端地址信息结构体
-    socklen_t clnt_addr_size;    // 客户端地址结构体的长度，用于 accept 函数
-    char message[BUF_SIZE];       // 用于接收和发送数据的缓冲区
-    
-    // --- 1. 初始化和参数检查 ---
-    if (argc != 2) {
-        // 检查命令行参数，确保用户提供了端口号
-        std::cout << "Usage: " << argv[0] << " <port>" << std::endl;
-        error_handling("Incorrect number of arguments");
-    }
 
-    // --- 2. 创建服务器套接字 ---
     // 使用 socket() 函数创建一个 TCP 套接字：
     // PF_INET: 指定使用 IPv4 协议族。
     // SOCK_STREAM: 指定使用流式套接字，即 TCP 协议。
     // 0: 表示由系统自动选择协议类型（TCP）。
-    serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    int serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    if(serv_sock == -1) {
+        error_handling("socket() error");
+    }
 
     // 设置套接字选项 SO_REUSEADDR，防止服务器重启时因端口处于 TIME_WAIT 状态而绑定失败
     int optval = 1;
-    if(setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, 
+    if(setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR,
                   (void*)&optval, sizeof(optval)) == -1) {
         error_handling("setsockopt() error");
     }
-
-    if(serv_sock == -1) {
-        error_handling("socket() error");
+    // SO_REUSEPORT 允许多个套接字绑定同一端口，必须在 bind() 之前设置
+    if(reuse_port && setsockopt(serv_sock, SOL_SOCKET, SO_REUSEPORT,
+                                (void*)&optval, sizeof(optval)) == -1) {
+        error_handling("setsockopt(SO_REUSEPORT) error");
     }
 
-    // --- 3. 绑定地址和端口 ---
     // 初始化服务器地址结构体
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET; // 地址族为 IPv4
     // INADDR_ANY 表示服务器将监听（绑定）所有可用的网络接口（IP地址）
-    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY); 
-    // 将命令行传入的端口号字符串转为整数，并从主机字节序转换到网络字节序
-    serv_addr.sin_port = htons(atoi(argv[1]));
+    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    // 将端口号从主机字节序转换到网络字节序
+    serv_addr.sin_port = htons(port);
 
     // 将套接字与指定的 IP 地址和端口号绑定
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
         error_handling("bind() error");
     }
 
-    // --- 4. 开始监听连接 ---
     // 将套接字设置为监听模式，准备接受客户端的连接请求。
-    // 第二个参数 5 是连接请求队列（backlog）的最大长度，即最多允许 5 个客户端等待连接。
-    if(listen(serv_sock, 5) == -1) {
+    // 第二个参数是连接请求队列（backlog）的最大长度。原来的 5 在压测的连接风暴下会直接溢出，
+    // 这里使用系统上限 SOMAXCONN（实际值还受 net.core.somaxconn 限制）。
+    if(listen(serv_sock, SOMAXCONN) == -1) {
         error_handling("listen() error");
     }
+    return serv_sock;
+}
+
+/**
+ * @brief 每个客户端连接的状态。
+ * buf 只在"数据已读入但还没完全回写"期间持有，回写完成立即归还给缓冲池，
+ * 因此空闲连接只占用这个结构体本身，不占用任何 I/O 缓冲区。
+ */
+struct Connection {
+    char* buf = nullptr; // 从 BufferPool 借来的 chunk，空闲时为 nullptr
+    size_t off = 0;      // buf 中已回写的字节数
+    size_t len = 0;      // buf 中有效数据的字节数
+    TimerWheel::TimerId timer = TimerWheel::INVALID; // 空闲超时定时器，每次读写有进展就顺延
+};
+
+/**
+ * @brief 修改客户端套接字在 epoll 中关注的事件。
+ * 有未写完的数据时只关注 EPOLLOUT（暂停读取，形成背压）；写完后切回 EPOLLIN。
+ */
+void set_interest(int epoll_fd, int fd, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        error_handling("epoll_ctl() mod clnt_sock error");
+    }
+}
+
+/**
+ * @brief 把连接缓冲区中剩余的数据写回客户端，直到写完或发送缓冲区满。
+ *
+ * @return int 1 表示全部写完；0 表示遇到 EAGAIN 还有剩余；-1 表示写出错。
+ */
+int flush_connection(int fd, Connection& conn) {
+    while (conn.off < conn.len) {
+        // MSG_NOSIGNAL: 对端已关闭时返回 EPIPE 而不是触发 SIGPIPE 杀死整个进程
+        ssize_t n = send(fd, conn.buf + conn.off, conn.len - conn.off, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.off += n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief 一个 reactor：独占一个 epoll 实例和一个监听套接字的事件循环。
+ * 单线程模式下直接在主线程运行；多 reactor 模式下每个工作线程运行一个，
+ * 连接一旦被某个 reactor accept，之后的所有读写都只在该线程中完成，线程之间不共享任何连接状态。
+ * 每个 reactor 也有自己的 BufferPool，取还缓冲区不需要加锁。
+ *
+ * @param reactor_id reactor 编号，仅用于日志。
+ * @param serv_sock 该 reactor 负责的监听套接字。
+ */
+void reactor_loop(int reactor_id, int serv_sock) {
+    int clnt_sock;               // 与特定客户端通信的套接字文件描述符
+    struct sockaddr_in clnt_addr; // 客户端地址信息结构体
+    socklen_t clnt_addr_size;    // 客户端地址结构体的长度，用于 accept 函数
+    std::string tag = "[reactor " + std::to_string(reactor_id) + "] ";
 
-    // --- 5. 初始化 epoll ---
+    BufferPool pool;                           // 本 reactor 的 I/O 缓冲池（16 KB 一块）
+    std::unordered_map<int, Connection> conns; // fd -> 连接状态
+    // 本 reactor 的时间轮。loop_now 是本轮 epoll_wait 返回时的时间，同一轮的事件共用
+    int64_t loop_now = now_ms();
+    TimerWheel timers(loop_now);
+
+    // --- 初始化 epoll ---
     // epoll_create() 创建一个 epoll 实例，并返回其文件描述符。
     // 参数已不再使用，但必须大于等于 0。
     int epoll_fd = epoll_create(1); // 建议使用更明确的变量名 epoll_fd
@@ -98,6 +188,27 @@ int main(int argc, char** argv) {
         error_handling("epoll_create() error");
     }
 
+    // fd 用完（EMFILE / ENFILE）时，水平触发的监听套接字会一直可读；先释放这个预留的 fd，
+    // 接受后立刻关闭，把排队的连接取走，避免 reactor 忙等（与 echo_selectserv 相同）
+    int spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    // 关闭连接：移出 epoll、关闭套接字、把缓冲区还给缓冲池
+    auto close_connection = [&](int fd) {
+        auto it = conns.find(fd);
+        if (it != conns.end()) {
+            if (it->second.buf != nullptr) {
+                pool.release(it->second.buf);
+            }
+            timers.cancel(it->second.timer);
+            conns.erase(it);
+        }
+        // 从 epoll 实例中移除对该文件描述符的监控。
+        // EPOLL_CTL_DEL: 表示从监控列表中删除一个文件描述符。
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        // 关闭与该客户端通信的套接字，释放资源。
+        close(fd);
+    };
+
     // 定义 epoll 事件结构体，用于描述要监控的事件
     struct epoll_event ev;
     // 设置要监控的事件类型：
@@ -116,16 +227,16 @@ int main(int argc, char** argv) {
     // 分配一个事件数组，用于存储 epoll_wait() 返回的就绪事件
     struct epoll_event *events = new epoll_event[MAX_EVENTS]; // 使用 new/delete 更符合C++风格
 
-    // --- 6. 服务器主循环 ---
-    std::cout << "Server started on port " << argv[1] << ", waiting for connections..." << std::endl;
+    // --- 事件主循环 ---
     while(true) {
         // 等待事件发生。
         // epoll_fd: epoll 实例的文件描述符。
         // events: 指向一个 epoll_event 数组，内核将就绪的事件复制到这个数组中。
         // MAX_EVENTS: 告诉内核本次最多可以返回多少个事件。
-        // -1: 表示永久阻塞，直到有事件发生。如果设置为 0，则非阻塞；如果为正数，则超时（毫秒）。
-        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
-        
+        // 超时：-1 表示永久阻塞，直到有事件发生。如果设置为 0，则非阻塞；如果为正数，则超时（毫秒）。
+        // 这里由时间轮给出：没有定时器时永久阻塞，否则最多等到最近的定时器到期。
+        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, timers.timeout_ms(now_ms(), -1));
+
         if(nfds == -1) {
             // 如果 epoll_wait 被信号中断，可以继续等待
             if (errno == EINTR) {
@@ -133,6 +244,7 @@ int main(int argc, char** argv) {
             }
             error_handling("epoll_wait() error");
         }
+        loop_now = now_ms();
 
         // 遍历所有发生的事件
         for(int i = 0; i < nfds; i++) {
@@ -142,21 +254,37 @@ int main(int argc, char** argv) {
             if(current_fd == serv_sock) {
                 // --- 处理新连接 ---
                 // 如果是服务器监听套接字可读，表明有新的客户端连接请求到达。
-                
+
                 clnt_addr_size = sizeof(clnt_addr);
-                // accept() 会从监听队列中取出第一个连接请求，创建一个新的套接字用于与该客户端通信。
-                clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
-                
+                // accept4() 会从监听队列中取出第一个连接请求，创建一个新的套接字用于与该客户端通信。
+                // SOCK_NONBLOCK: 新套接字直接设为非阻塞，写不完时返回 EAGAIN 而不是卡住整个 reactor。
+                clnt_sock = accept4(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size, SOCK_NONBLOCK);
+
                 if(clnt_sock == -1) {
-                    error_handling("accept() error");
+                    if ((errno == EMFILE || errno == ENFILE) && spare_fd != -1) {
+                        close(spare_fd);
+                        close(accept(serv_sock, NULL, NULL));
+                        spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                        if (!quiet) {
+                            log_line(tag + "Too many open files, connection rejected");
+                        }
+                        continue;
+                    }
+                    // 如对端在 accept 前就重置了连接：只打印，不终止服务器
+                    if (errno != EAGAIN && errno != EINTR) {
+                        std::cerr << tag << "accept() error (errno: " << errno << ")" << std::endl;
+                    }
+                    continue;
                 }
 
                 // 获取客户端的IP和端口信息并打印
-                char clnt_ip[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
-                std::cout << "New client connected: IP=" << clnt_ip 
-                          << ", Port=" << ntohs(clnt_addr.sin_port) 
-                          << ", Socket=" << clnt_sock << std::endl;
+                if (!quiet) {
+                    char clnt_ip[INET_ADDRSTRLEN];
+                    inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
+                    log_line(tag + "New client connected: IP=" + clnt_ip
+                             + ", Port=" + std::to_string(ntohs(clnt_addr.sin_port))
+                             + ", Socket=" + std::to_string(clnt_sock));
+                }
 
                 // 将新创建的客户端套接字也加入到 epoll 的监控中，以便接收其数据。
                 ev.events = EPOLLIN;
@@ -164,46 +292,160 @@ int main(int argc, char** argv) {
                 if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &ev) == -1) {
                     error_handling("epoll_ctl() add clnt_sock error");
                 }
+                Connection& conn = conns[clnt_sock];
+                conn = Connection();
+                if (idle_timeout_sec > 0) {
+                    conn.timer = timers.add(loop_now + idle_timeout_sec * 1000LL, clnt_sock);
+                }
 
             } else {
+                auto it = conns.find(current_fd);
+                if (it == conns.end()) {
+                    continue;
+                }
+                Connection& conn = it->second;
+                // 有事件就说明连接还活着（可读或者又能写了），空闲超时顺延；O(1)
+                timers.reset(conn.timer, loop_now + idle_timeout_sec * 1000LL);
+
+                if (conn.buf != nullptr) {
+                    // --- 继续回写上次没写完的数据 ---
+                    // 此时只注册了 EPOLLOUT，说明发送缓冲区有空间了（或连接出错）。
+                    int r = flush_connection(current_fd, conn);
+                    if (r == -1) {
+                        close_connection(current_fd);
+                    } else if (r == 1) {
+                        // 写完了：归还缓冲区，恢复读取
+                        pool.release(conn.buf);
+                        conn.buf = nullptr;
+                        conn.off = conn.len = 0;
+                        set_interest(epoll_fd, current_fd, EPOLLIN);
+                    }
+                    continue;
+                }
+
                 // --- 处理客户端数据 ---
                 // 否则是某个客户端套接字可读，表明有数据可读或连接已关闭。
-                
-                int str_len = read(current_fd, message, sizeof(message) - 1); // 预留一个位置给'\0'
-                
-                if(str_len == -1) {
-                    // 读取出错
-                    error_handling("read() error");
-                } else if(str_len == 0) {
-                    // read() 返回 0 表示对端（客户端）已正常关闭连接（发送了 FIN）。
-                    std::cout << "Client disconnected (socket " << current_fd << ")" << std::endl;
-                    
-                    // 从 epoll 实例中移除对该文件描述符的监控。
-                    // EPOLL_CTL_DEL: 表示从监控列表中删除一个文件描述符。
-                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                    // 关闭与该客户端通信的套接字，释放资源。
-                    close(current_fd);
-                } else if(str_len > 0) {
+                // 只有此刻才向缓冲池借一块 chunk，一次 read 最多可读 16 KB。
+                conn.buf = pool.acquire();
+                int str_len = read(current_fd, conn.buf, pool.chunk_size());
+
+                if(str_len == -1 && (errno == EAGAIN || errno == EINTR)) {
+                    // 虚假唤醒，什么也没读到
+                    pool.release(conn.buf);
+                    conn.buf = nullptr;
+                } else if(str_len <= 0) {
+                    // read() 返回 0 表示对端（客户端）已正常关闭连接（发送了 FIN）；
+                    // 返回 -1 表示读取出错（如连接被重置），两种情况都只关闭这一个连接。
+                    if (!quiet) {
+                        log_line(tag + "Client disconnected (socket " + std::to_string(current_fd) + ")");
+                    }
+                    close_connection(current_fd);
+                } else {
                     // 成功读取到数据
-                    message[str_len] = '\0'; // 添加字符串结束符，以便安全输出
-                    
-                    std::cout << "Message from client " << current_fd << ": " << message << std::endl;
-                    
-                    // 将收到的数据原样回写给客户端。
-                    // 注意：一个完整的回显服务可能需要处理 write 的部分写入情况。
-                    if(write(current_fd, message, str_len) == -1) {
-                         error_handling("write() error");
+                    conn.len = str_len;
+                    if (!quiet) {
+                        log_line(tag + "Message from client " + std::to_string(current_fd) + ": "
+                                 + std::string(conn.buf, str_len));
+                    }
+
+                    // 将收到的数据原样回写给客户端，并处理部分写入的情况。
+                    int r = flush_connection(current_fd, conn);
+                    if (r == -1) {
+                        close_connection(current_fd);
+                    } else if (r == 1) {
+                        // 常见情况：一次写完，缓冲区立刻还回池里
+                        pool.release(conn.buf);
+                        conn.buf = nullptr;
+                        conn.off = conn.len = 0;
+                    } else {
+                        // 对端接收慢：保留缓冲区，改为等待可写，期间不再读取该连接
+                        set_interest(epoll_fd, current_fd, EPOLLOUT);
                     }
                 }
             }
         }
+
+        // --- 空闲超时：只处理到期的定时器。对端不再读取时写方向也不会有进展，同样会超时 ---
+        timers.advance(now_ms(), [&](uint64_t fd) {
+            if (!quiet) {
+                log_line(tag + "Client timed out (socket " + std::to_string(fd) + ")");
+            }
+            close_connection((int)fd);
+        });
     }
 
-    // --- 7. 清理资源 ---
+    // --- 清理资源 ---
     // 这部分代码在无限循环中是不可达的，但作为良好实践，保留它们以便程序能优雅退出（例如通过信号）。
     close(serv_sock);         // 关闭服务器监听套接字
+    if (spare_fd != -1) {
+        close(spare_fd);
+    }
     close(epoll_fd);          // 关闭 epoll 实例
     delete[] events;          // 释放事件数组内存
-    
+}
+
+/**
+ * @brief 主函数，实现一个基于 epoll 的高并发 TCP Echo 服务器。
+ * 该服务器能够同时处理多个客户端连接，并将任何收到的数据原样回送给客户端。
+ *
+ * 默认是单线程单 epoll 循环；指定 --threads N (N > 1) 时进入多 reactor 模式：
+ * 创建 N 个带 SO_REUSEPORT 的监听套接字，每个工作线程各持有一个监听套接字和一个 epoll 实例，
+ * 由内核在监听套接字之间分发新连接，从而把负载分摊到多个 CPU 核心上。
+ *
+ * @param argc 命令行参数的数量。
+ * @param argv 命令行参数数组：<port> [--threads N] [--idle-timeout SEC] [--quiet]。
+ * @return int 程序的退出状态码。
+ */
+int main(int argc, char** argv) {
+
+    // --- 1. 初始化和参数检查 ---
+    int threads = 1; // reactor 线程数量，默认单线程
+    int port = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--idle-timeout" && i + 1 < argc) {
+            idle_timeout_sec = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || threads <= 0 || idle_timeout_sec < 0) {
+        // 检查命令行参数，确保用户提供了端口号
+        std::cout << "Usage: " << argv[0] << " <port> [--threads N] [--idle-timeout SEC] [--quiet]" << std::endl;
+        error_handling("Incorrect number of arguments");
+    }
+
+    // --- 2. 创建监听套接字 ---
+    // 在启动线程前全部创建完毕，这样端口被占用等错误能在启动阶段直接暴露。
+    bool reuse_port = threads > 1;
+    std::vector<int> listen_socks;
+    for (int i = 0; i < threads; i++) {
+        listen_socks.push_back(create_listen_socket(port, reuse_port));
+    }
+
+    std::cout << "Server started on port " << port << " with " << threads
+              << " reactor(s), waiting for connections..." << std::endl;
+
+    if (threads == 1) {
+        reactor_loop(0, listen_socks[0]);
+        return 0;
+    }
+
+    // --- 3. 多 reactor 模式：每个线程一个 epoll 循环 ---
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(reactor_loop, i, listen_socks[i]);
+    }
+    for (auto& t : workers) {
+        t.join();
+    }
+
     return 0;
 }
@@ -1,6 +1,8 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>          // 预派生模式：worker 的 pid 列表、每个连接的状态
+#include <algorithm>       // std::fill
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <sys/wait.h>
@@ -9,61 +11,106 @@
 #include <wait.h>
 #include <signal.h>
 #include <errno.h>
+#include <fcntl.h>         // O_NONBLOCK；open，预留一个空闲 fd 应对 EMFILE
+#include <time.h>          // clock_gettime，判断 worker 是否启动后立刻崩溃
+#include <sys/epoll.h>     // 预派生模式下每个 worker 一个 epoll 事件循环
 const int BUF_SIZE = 1024;
+const int MAX_EVENTS = 256;      // worker 单次 epoll_wait 最多返回的事件数
+const int ACCEPT_BATCH = 16;     // worker 一次唤醒最多 accept 多少个连接，剩下的留给其他 worker
+bool quiet = false;              // --quiet: 关闭逐连接/逐消息日志
+
 void error_handling(std::string message) {
     std::cout << message << std::endl;
     exit(1);
 }
+
+/**
+ * @brief 信号处理函数里可以安全调用的日志：只用 write，不用 cout / printf
+ */
+void signal_safe_log(const char* text, long value) {
+    char buf[96];
+    size_t len = 0;
+    while (*text && len < 64) {
+        buf[len++] = *text++;
+    }
+    char digits[24];
+    int n = 0;
+    bool neg = value < 0;
+    unsigned long v = neg ? -(unsigned long)value : value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (neg) {
+        buf[len++] = '-';
+    }
+    while (n) {
+        buf[len++] = digits[--n];
+    }
+    buf[len++] = '\n';
+    ssize_t ignored = write(STDOUT_FILENO, buf, len);
+    (void)ignored;
+}
+
+/**
+ * @brief SIGCHLD 处理函数（每个连接一个进程的模式）。
+ * 多个子进程几乎同时退出时，内核只会投递一次 SIGCHLD（同一信号在挂起期间不排队），
+ * 所以必须循环 waitpid 直到没有可回收的子进程，否则剩下的就成了僵尸进程。
+ * 处理函数里只能调用异步信号安全的函数，errno 也要恢复，免得影响被打断的 accept。
+ */
 void read_childproc(int) {
+    int saved_errno = errno;
     int status;
-    pid_t id = waitpid(-1, &status, WNOHANG);
-    if ( WIFEXITED(status)) {
-        std::cout << "child process " << id << " terminated" << std::endl;
-        std::cout << "exit code: " << WEXITSTATUS(status) << std::endl;
+    pid_t id;
+    while ((id = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (WIFEXITED(status)) {
+            signal_safe_log("child process terminated, pid ", id);
+            signal_safe_log("exit code: ", WEXITSTATUS(status));
+        }
     }
+    errno = saved_errno;
 }
-int main(int argc, char** argv) {
 
-    int serv_sock;
-    int clnt_sock;
+/**
+ * @brief 把 buf 中的 len 个字节全部写出
+ * @return bool 写出错（对端已关闭等）返回 false
+ */
+bool write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
 
-    struct sockaddr_in serv_addr;
+int64_t monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 每个连接一个进程的模式（原来的实现）：主进程阻塞在 accept 上，每来一个连接 fork 一次
+ */
+void fork_per_connection(int serv_sock) {
+    int clnt_sock;
     struct sockaddr_in clnt_addr;
     socklen_t clnt_addr_size;
     char message[BUF_SIZE];
-    
+
     struct sigaction act;
     act.sa_handler = read_childproc;
     sigemptyset(&act.sa_mask);
     act.sa_flags = 0;
     sigaction(SIGCHLD, &act, NULL);
 
-    if (argc != 2) {
-        error_handling("Usage: <port>");
-    }
-
-    serv_sock = socket(PF_INET, SOCK_STREAM, 0);
-    int optval = 1;
-    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, 
-                (void*)&optval, sizeof(optval));
-    if(serv_sock == -1) {
-        error_handling("socket() error");
-    }
-
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serv_addr.sin_port = htons(atoi(argv[1]));
-
-    if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
-        error_handling("bind() error");
-    }
-
-    if(listen(serv_sock, 5) == -1) {
-        error_handling("listen() error");
-    }
-    
-    clnt_addr_size = sizeof(clnt_addr);
     int i = 0;
     /* 在客户端断开时 accept() 会返回 -1,原因是子线程退出，被信号中断 */
     /*信号中断的过程：
@@ -83,15 +130,18 @@ int main(int argc, char** argv) {
         关键点：由于accept()系统调用被信号中断了，它会立即返回-1，
                 并且系统会设置一个全局变量errno为EINTR（Interrupted system call，即“系统调用被中断”）。*/
     while(1) {
+        clnt_addr_size = sizeof(clnt_addr);
         clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
         if(clnt_sock == -1) {
             if(errno == EINTR) {
-                std::cout << "accept() interrupted by signal. Continuing..." << std::endl;
+                if (!quiet) {
+                    std::cout << "accept() interrupted by signal. Continuing..." << std::endl;
+                }
                 continue;
             } else  {
                 error_handling("accept() error");
             }
-        } else {
+        } else if (!quiet) {
             std::cout << "Connected client " << ++i << std::endl;
         }
 
@@ -99,19 +149,383 @@ int main(int argc, char** argv) {
         if(pid == 0) {   /* child process */
             close(serv_sock);
             while (1) {
-                memset(message, 0, sizeof(message));
-                int str_len = read(clnt_sock, message, sizeof(BUF_SIZE));
-                if(str_len == 0) {
+                // 原来这里读的是 sizeof(BUF_SIZE) 即 4 个字节，每条消息被拆成很多次 read/write
+                int str_len = read(clnt_sock, message, BUF_SIZE);
+                if (str_len == -1 && errno == EINTR) {
+                    continue;
+                }
+                if(str_len <= 0) {
+                    break;
+                }
+                if (!quiet) {
+                    std::cout << "Message from client " << i << ": " << std::string(message, str_len) << std::endl;
+                }
+                if (!write_all(clnt_sock, message, str_len)) {
                     break;
                 }
-                std::cout << "Message from client " << i << ": " << message << std::endl;
-                write(clnt_sock, message, str_len);
             }
+            // 子进程处理完这个连接就退出，不能回到 accept 循环
+            close(clnt_sock);
+            exit(0);
         } else {
+            if (pid == -1) {
+                std::cout << "fork() error (errno: " << errno << ")" << std::endl;
+            }
             close(clnt_sock);
         }
     }
+}
+
+/**
+ * @brief 预派生模式下一个连接的状态：没能立刻写出去的回显数据
+ */
+struct Client {
+    std::string pending;
+};
+
+/**
+ * @brief 预派生 worker：一个 epoll 事件循环，和其他 worker 共享同一个监听套接字。
+ *
+ * 监听套接字以 EPOLLEXCLUSIVE 加入各自的 epoll 实例：新连接到来时内核只唤醒其中一个（或少数几个）
+ * 等待中的 worker，而不是全部唤醒后只有一个 accept 成功（惊群）。每次唤醒最多 accept ACCEPT_BATCH 个，
+ * 剩下的连接会再次唤醒某个 worker，负载因此分散到各个进程上。
+ */
+void worker_loop(int worker_id, int serv_sock) {
+    std::string tag = "[worker " + std::to_string(worker_id) + " pid " + std::to_string(getpid()) + "] ";
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        error_handling(tag + "epoll_create1() error");
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = serv_sock;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, serv_sock, &ev) == -1) {
+        // 4.5 之前的内核不认识 EPOLLEXCLUSIVE：退回普通的 EPOLLIN，只是会有惊群
+        ev.events = EPOLLIN;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, serv_sock, &ev) == -1) {
+            error_handling(tag + "epoll_ctl() add serv_sock error");
+        }
+    }
+
+    std::vector<Client> clients; // fd -> 连接状态
+    std::vector<struct epoll_event> events(MAX_EVENTS);
+    char message[BUF_SIZE];
+    long accepted = 0;
+
+    // fd 用完（EMFILE / ENFILE）时，监听套接字会一直可读、这个 worker 会被反复唤醒；
+    // 先释放这个预留的 fd，接受后立刻关闭，把排队的连接取走，避免忙等（与 echo_epollserv 相同）
+    int spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    auto set_interest = [&](int fd, uint32_t interest) {
+        struct epoll_event cev;
+        cev.events = interest;
+        cev.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &cev);
+    };
+    auto close_client = [&](int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        close(fd);
+        clients[fd].pending.clear();
+        clients[fd].pending.shrink_to_fit();
+    };
+    // 尽量写出积压的数据；连接出错返回 false
+    auto flush_pending = [&](int fd, Client& client) {
+        while (!client.pending.empty()) {
+            ssize_t n = send(fd, client.pending.data(), client.pending.size(), MSG_NOSIGNAL);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            client.pending.erase(0, n);
+        }
+        return true;
+    };
+
+    while (true) {
+        int nfds = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, -1);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling(tag + "epoll_wait() error");
+        }
+        for (int i = 0; i < nfds; i++) {
+            int fd = events[i].data.fd;
+            if (fd == serv_sock) {
+                for (int k = 0; k < ACCEPT_BATCH; k++) {
+                    struct sockaddr_in clnt_addr;
+                    socklen_t clnt_addr_size = sizeof(clnt_addr);
+                    int clnt_sock = accept4(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size,
+                                            SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (clnt_sock == -1) {
+                        if ((errno == EMFILE || errno == ENFILE) && spare_fd != -1) {
+                            // fd 不够时 accept 在检查队列之前就失败，队列空了也一直是 EMFILE，所以取不到连接时要退出循环
+                            close(spare_fd);
+                            int rejected = accept(serv_sock, NULL, NULL);
+                            if (rejected != -1) {
+                                close(rejected);
+                            }
+                            spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                            if (rejected == -1) {
+                                break;
+                            }
+                            if (!quiet) {
+                                std::cout << tag << "Too many open files, connection rejected" << std::endl;
+                            }
+                            continue;
+                        }
+                        // EAGAIN：连接被别的 worker 取走了，或者队列已经空了
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED) {
+                            std::cout << tag << "accept() error (errno: " << errno << ")" << std::endl;
+                        }
+                        break;
+                    }
+                    struct epoll_event cev;
+                    cev.events = EPOLLIN;
+                    cev.data.fd = clnt_sock;
+                    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &cev) == -1) {
+                        close(clnt_sock);
+                        continue;
+                    }
+                    if ((size_t)clnt_sock >= clients.size()) {
+                        clients.resize(clnt_sock + 1);
+                    }
+                    accepted++;
+                    if (!quiet) {
+                        std::cout << tag << "Connected client " << accepted << " (socket " << clnt_sock << ")" << std::endl;
+                    }
+                }
+                continue;
+            }
+
+            Client& client = clients[fd];
+            bool ok = true;
+            if (events[i].events & EPOLLOUT) {
+                // 积压的数据可以继续写了，写完后恢复读取
+                ok = flush_pending(fd, client);
+                if (ok && client.pending.empty()) {
+                    set_interest(fd, EPOLLIN);
+                }
+            } else {
+                ssize_t str_len = read(fd, message, BUF_SIZE);
+                if (str_len == 0 || (str_len == -1 && errno != EAGAIN && errno != EINTR)) {
+                    ok = false;
+                } else if (str_len > 0) {
+                    if (!quiet) {
+                        std::cout << tag << "Message from client " << fd << ": " << std::string(message, str_len) << std::endl;
+                    }
+                    // 写不完的部分留到可写时再发，期间不再读，慢客户端只会拖慢自己
+                    client.pending.append(message, str_len);
+                    ok = flush_pending(fd, client);
+                    if (ok && !client.pending.empty()) {
+                        set_interest(fd, EPOLLOUT);
+                    }
+                }
+            }
+            if (!ok) {
+                close_client(fd);
+            }
+        }
+    }
+}
+
+/**
+ * @brief fork 出一个 worker 进程，返回它的 pid（失败返回 -1）
+ */
+pid_t spawn_worker(int worker_id, int serv_sock, const sigset_t& old_mask) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        // worker 恢复默认的信号处理和信号掩码：收到 SIGTERM 直接退出
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_IGN);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        worker_loop(worker_id, serv_sock);
+        exit(0);
+    }
+    return pid;
+}
+
+/**
+ * @brief 预派生模式的主进程：启动 N 个常驻 worker，之后只负责监管。
+ *
+ * SIGCHLD / SIGTERM / SIGINT 全部阻塞，用 sigwaitinfo 同步地取出来处理，没有信号处理函数，
+ * 也就没有异步信号安全的问题。每次 SIGCHLD 都循环 waitpid(WNOHANG) 回收所有已退出的 worker
+ * （多个退出可能合并成一次信号），然后在同一个编号上重新 fork 一个；启动后 1 秒内就退出的 worker
+ * 推迟 1 秒再重启（用 sigtimedwait 的超时实现，期间照样响应信号），避免崩溃循环把 CPU 耗在 fork 上。
+ * fork 失败的编号同样 1 秒后重试，worker 全部退出时主进程也不会卡在 sigwaitinfo 上。
+ * 收到 SIGTERM / SIGINT 时通知所有 worker 退出并等待它们结束。
+ */
+void prefork_master(int serv_sock, int workers) {
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    std::vector<pid_t> pids(workers, -1);
+    std::vector<int64_t> started(workers, 0);
+    std::vector<int64_t> respawn_at(workers, 0); // 非 0 表示这个编号的 worker 等到这个时间再重启
+    for (int i = 0; i < workers; i++) {
+        pids[i] = spawn_worker(i, serv_sock, old_mask);
+        started[i] = monotonic_ms();
+        if (pids[i] == -1) {
+            error_handling("fork() error");
+        }
+    }
+    std::cout << "Master " << getpid() << " started " << workers << " worker(s)" << std::endl;
+
+    bool stopping = false;
+    int alive = workers;
+    auto respawn = [&](int slot) {
+        respawn_at[slot] = 0;
+        pids[slot] = spawn_worker(slot, serv_sock, old_mask);
+        started[slot] = monotonic_ms();
+        if (pids[slot] == -1) {
+            // fork 失败（例如暂时的 EAGAIN）：1 秒后再试，不能让这个编号从此空着
+            std::cout << "fork() error (errno: " << errno << "), worker " << slot << " retry in 1s" << std::endl;
+            respawn_at[slot] = monotonic_ms() + 1000;
+            return;
+        }
+        alive++;
+        std::cout << "Worker " << slot << " restarted (pid " << pids[slot] << ")" << std::endl;
+    };
+
+    while (alive > 0 || !stopping) {
+        // 有推迟重启的 worker 时，最多等到最早的那个重启时间
+        int64_t now = monotonic_ms();
+        int64_t wait_ms = -1;
+        for (int i = 0; i < workers; i++) {
+            if (respawn_at[i] != 0 && respawn_at[i] <= now) {
+                respawn(i); // 失败时会重新设置 respawn_at
+            }
+            if (respawn_at[i] != 0 && (wait_ms == -1 || respawn_at[i] - now < wait_ms)) {
+                wait_ms = respawn_at[i] - now;
+            }
+        }
+        int sig;
+        if (wait_ms >= 0) {
+            struct timespec ts = {(time_t)(wait_ms / 1000), (long)(wait_ms % 1000) * 1000000};
+            sig = sigtimedwait(&mask, NULL, &ts);
+        } else {
+            sig = sigwaitinfo(&mask, NULL);
+        }
+        if (sig == -1) {
+            continue; // EINTR 或者到了重启时间（EAGAIN）
+        }
+        if (sig == SIGTERM || sig == SIGINT) {
+            if (!stopping) {
+                stopping = true;
+                std::fill(respawn_at.begin(), respawn_at.end(), 0);
+                std::cout << "Master shutting down, stopping workers..." << std::endl;
+                for (pid_t pid : pids) {
+                    if (pid > 0) {
+                        kill(pid, SIGTERM);
+                    }
+                }
+            }
+            continue;
+        }
+        // SIGCHLD：回收所有已经退出的 worker
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            int slot = -1;
+            for (int i = 0; i < workers; i++) {
+                if (pids[i] == pid) {
+                    slot = i;
+                }
+            }
+            if (slot == -1) {
+                continue;
+            }
+            pids[slot] = -1;
+            alive--;
+            if (WIFEXITED(status)) {
+                std::cout << "Worker " << slot << " (pid " << pid << ") exited with code " << WEXITSTATUS(status) << std::endl;
+            } else if (WIFSIGNALED(status)) {
+                std::cout << "Worker " << slot << " (pid " << pid << ") killed by signal " << WTERMSIG(status) << std::endl;
+            }
+            if (stopping) {
+                continue;
+            }
+            if (monotonic_ms() - started[slot] < 1000) {
+                // 刚启动就退出，多半是每次都会失败，慢一点重启
+                respawn_at[slot] = started[slot] + 1000;
+                std::cout << "Worker " << slot << " exited too quickly, restarting in 1s" << std::endl;
+            } else {
+                respawn(slot);
+            }
+        }
+    }
+    std::cout << "All workers stopped" << std::endl;
+}
+
+/**
+ * @brief 多进程 Echo 服务器。
+ *
+ * 默认模式：每个连接 fork 一个子进程（经典写法）。
+ * --prefork N：启动时预先 fork N 个常驻 worker，都在同一个监听套接字上 accept，
+ * 每个 worker 用 epoll 同时服务很多连接，建立连接时不再有 fork 的开销；主进程只负责监管和重启 worker。
+ *
+ * @param argv <port> [--prefork N] [--quiet]
+ */
+int main(int argc, char** argv) {
+
+    int serv_sock;
+    struct sockaddr_in serv_addr;
+
+    int port = -1;
+    int prefork = 0; // 0 表示每个连接一个进程
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--prefork" && i + 1 < argc) {
+            prefork = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || prefork < 0) {
+        error_handling("Usage: <port> [--prefork N] [--quiet]");
+    }
+
+    serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    int optval = 1;
+    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR,
+                (void*)&optval, sizeof(optval));
+    if(serv_sock == -1) {
+        error_handling("socket() error");
+    }
+
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    serv_addr.sin_port = htons(port);
+
+    if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
+        error_handling("bind() error");
+    }
+
+    // 原来的 5 在连接风暴下会溢出
+    if(listen(serv_sock, SOMAXCONN) == -1) {
+        error_handling("listen() error");
+    }
+
+    if (prefork > 0) {
+        // 多个 worker 共享这个套接字：没抢到连接的 worker 要立刻拿到 EAGAIN，而不是阻塞在 accept 上
+        fcntl(serv_sock, F_SETFL, fcntl(serv_sock, F_GETFL, 0) | O_NONBLOCK);
+        prefork_master(serv_sock, prefork);
+    } else {
+        fork_per_connection(serv_sock);
+    }
 
     close(serv_sock);
     return 0;
-}
\ No newline at end of file
+}
@@ -5,14 +5,32 @@
 #include <netinet/in.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>      // open，预留一个空闲 fd 应对 EMFILE
+#include <sys/epoll.h>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
 
 // ===================================================================================
-// 全局变量定义 (已简化)
+// 全局变量定义
 // ===================================================================================
 
-const int BUF_SIZE = 1024; // 消息缓冲区的大小
-// 注意：不再需要 MAX_CLNT, clnt_count, clnt_socks, mtx
+const int BUF_SIZE = 16 * 1024; // 每个工作线程的读缓冲区大小（按线程而不是按连接分配）
+const int MAX_EVENTS = 1024;    // epoll 单次调用最多可返回的事件数量
+const int READ_BUDGET = 16;     // 工作线程处理一个连接时最多连续读多少次，之后让出给别的连接，避免单个连接霸占线程
+
+// 注意：不再为每个客户端创建一个线程。
+// 主线程用 epoll 等待"哪些连接有数据"，只把就绪的连接交给固定数量的工作线程处理，
+// 空闲连接只占一个 Connection 对象，不占线程也不占缓冲区，连接数增长时内存基本保持平稳。
+
+int epoll_fd = -1;
+bool quiet = false;  // --quiet: 关闭逐连接日志
+std::mutex log_mtx;  // 多个工作线程共享 cout，需要加锁避免输出交错
 
 // ===================================================================================
 // 辅助函数定义
@@ -23,35 +41,216 @@ void error_handling(std::string message) {
     exit(1);
 }
 
-// 注意：不再需要 send_msg_to_all 函数
+void log_line(const std::string& line) {
+    if (quiet) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(log_mtx);
+    std::cout << line << std::endl;
+}
 
 /**
- * @brief 处理单个客户端通信的线程函数 (已修改)
- * @param clnt_sock 该线程负责的客户端的套接字文件描述符
- * 现在这个函数只做一件事：接收客户端消息，然后原样发回。
+ * @brief 一个客户端连接的状态。
+ * 连接以 EPOLLONESHOT 注册：事件触发一次后自动失效，直到处理它的工作线程重新 arm，
+ * 因此任意时刻最多只有一个线程在操作同一个连接，Connection 本身不需要加锁。
  */
-void handle_client(int clnt_sock) {
-    char message[BUF_SIZE];
-    int str_len;
+struct Connection {
+    int fd;
+    std::string pending; // 对端接收窗口满时尚未写出的数据，只有出现写背压时才非空
+};
 
-    // 循环从客户端套接字读取数据
-    while ((str_len = read(clnt_sock, message, sizeof(message))) > 0) {
-        // 【核心修改】: 将收到的数据原封不动地写回给同一个客户端
-        write(clnt_sock, message, str_len);   
+/**
+ * @brief 重新 arm 连接的 epoll 事件：有待写数据时等可写，否则等可读。
+ */
+void rearm(Connection* conn) {
+    struct epoll_event ev;
+    ev.events = EPOLLONESHOT | EPOLLRDHUP;
+    if (conn->pending.empty()) {
+        ev.events |= EPOLLIN;
+    } else {
+        ev.events |= EPOLLOUT;
     }
+    ev.data.ptr = conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
 
-    // 如果while循环结束，说明客户端已断开连接
-    std::cout << "Client disconnected: Socket FD=" << clnt_sock << std::endl;
+void close_connection(Connection* conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    log_line("Client disconnected: Socket FD=" + std::to_string(conn->fd));
+    delete conn;
+}
 
-    // 注意：不再需要从全局列表中删除客户端的操作
-    // 因为线程之间是独立的，这个线程结束后，它的资源会被自动回收
+/**
+ * @brief 尽量把 pending 中的数据写出去。
+ * @return int 1: 全部写完；0: 内核发送缓冲区满；-1: 连接出错。
+ */
+int flush_pending(Connection* conn) {
+    while (!conn->pending.empty()) {
+        ssize_t n = send(conn->fd, conn->pending.data(), conn->pending.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->pending.erase(0, n);
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    std::string().swap(conn->pending); // 背压解除后释放内存，让空闲连接回到最小占用
+    return 1;
+}
 
-    // 关闭与该客户端通信的套接字
-    close(clnt_sock);
+/**
+ * @brief 处理一个就绪的客户端 (在工作线程中执行)
+ * @param conn 就绪的连接，调用期间归当前线程独占
+ * @param buf 当前工作线程的读缓冲区
+ * 先写出积压的数据，然后读取客户端消息并原样发回；处理完毕后重新 arm 或关闭连接。
+ */
+void handle_client(Connection* conn, char* buf) {
+    int ret = flush_pending(conn);
+    if (ret == -1) {
+        close_connection(conn);
+        return;
+    }
+    if (ret == 0) {
+        rearm(conn); // 仍然写不动，继续等 EPOLLOUT，暂不读取新数据（背压传导给客户端）
+        return;
+    }
+
+    for (int i = 0; i < READ_BUDGET; i++) {
+        ssize_t str_len = read(conn->fd, buf, BUF_SIZE);
+        if (str_len == 0) {
+            // 客户端已断开连接
+            close_connection(conn);
+            return;
+        }
+        if (str_len == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break; // 数据读完了
+            }
+            close_connection(conn);
+            return;
+        }
+
+        // 将收到的数据原封不动地写回给同一个客户端
+        ssize_t sent = send(conn->fd, buf, str_len, MSG_NOSIGNAL);
+        if (sent == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_connection(conn);
+            return;
+        }
+        if (sent < str_len) {
+            // 只写出一部分：把剩下的存起来，改为等待可写
+            if (sent < 0) {
+                sent = 0;
+            }
+            conn->pending.assign(buf + sent, str_len - sent);
+            break;
+        }
+    }
+    // 读预算用完时连接可能还有数据，水平触发下重新 arm 会立刻再次就绪，排到队尾等待下一轮处理
+    rearm(conn);
 }
 
 // ===================================================================================
-// 主函数 (已简化)
+// 线程池定义
+// ===================================================================================
+
+/**
+ * @brief 固定大小、带工作窃取的线程池。
+ * 每个工作线程有自己的就绪连接队列，主线程轮流往各个队列投递；
+ * 工作线程优先从自己队列的头部取，自己的队列空了就从其他线程队列的尾部"偷"，
+ * 这样某个线程碰上一批繁忙的连接时，其余空闲线程可以分担。
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int n) : queues_(n) {
+        for (auto& q : queues_) {
+            q.reset(new WorkQueue);
+        }
+        for (int i = 0; i < n; i++) {
+            threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    /**
+     * @brief 投递一个就绪连接（由 epoll 线程调用）。
+     */
+    void submit(Connection* conn) {
+        WorkQueue& q = *queues_[next_++ % queues_.size()];
+        {
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.tasks.push_back(conn);
+        }
+        {
+            // 在 idle_mtx 下更新计数，避免和正准备睡眠的工作线程之间丢失唤醒
+            std::lock_guard<std::mutex> lock(idle_mtx_);
+            queued_++;
+        }
+        idle_cv_.notify_one();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mtx;
+        std::deque<Connection*> tasks;
+    };
+
+    Connection* try_pop(int id) {
+        // 先取自己队列的头部
+        {
+            WorkQueue& q = *queues_[id];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if (!q.tasks.empty()) {
+                Connection* conn = q.tasks.front();
+                q.tasks.pop_front();
+                return conn;
+            }
+        }
+        // 再从其他线程的队列尾部窃取
+        for (size_t k = 1; k < queues_.size(); k++) {
+            WorkQueue& q = *queues_[(id + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if (!q.tasks.empty()) {
+                Connection* conn = q.tasks.back();
+                q.tasks.pop_back();
+                return conn;
+            }
+        }
+        return nullptr;
+    }
+
+    void worker_loop(int id) {
+        std::unique_ptr<char[]> buf(new char[BUF_SIZE]);
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(idle_mtx_);
+                idle_cv_.wait(lock, [this] { return queued_ > 0; });
+                queued_--;
+            }
+            // 计数保证至少有一个任务属于自己，但它可能在别的队列里，按"自己 -> 窃取"的顺序找到为止
+            Connection* conn;
+            while ((conn = try_pop(id)) == nullptr) {
+                std::this_thread::yield();
+            }
+            handle_client(conn, buf.get());
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> threads_;
+    size_t next_ = 0;             // 轮询投递的下一个队列，只有 epoll 线程访问
+    std::mutex idle_mtx_;
+    std::condition_variable idle_cv_;
+    long queued_ = 0;             // 所有队列中尚未被领取的任务总数
+};
+
+// ===================================================================================
+// 主函数
 // ===================================================================================
 
 int main(int argc, char** argv) {
@@ -62,54 +261,129 @@ int main(int argc, char** argv) {
     struct sockaddr_in clnt_addr;
     socklen_t clnt_addr_size;
 
-    if (argc != 2) {
-        error_handling("Usage: <port>");
+    int threads = (int)std::thread::hardware_concurrency(); // 工作线程数量，默认等于 CPU 核数
+    if (threads <= 0) {
+        threads = 4;
+    }
+    int port = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || threads <= 0) {
+        error_handling("Usage: <port> [--threads N] [--quiet]");
     }
 
-    serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    serv_sock = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     if(serv_sock == -1) {
         error_handling("socket() error");
     }
 
+    int optval = 1;
+    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serv_addr.sin_port = htons(atoi(argv[1]));
+    serv_addr.sin_port = htons(port);
 
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
         error_handling("bind() error");
     }
 
-    if(listen(serv_sock, 5) == -1) {
+    if(listen(serv_sock, SOMAXCONN) == -1) {
         error_handling("listen() error");
     }
-    
-    std::cout << "Echo Server started. Waiting for client connections..." << std::endl;
-    
-    clnt_addr_size = sizeof(clnt_addr);
 
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        error_handling("epoll_create1() error");
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // 监听套接字用空指针标识
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, serv_sock, &ev);
+
+    ThreadPool pool(threads);
+
+    // fd 用完（EMFILE / ENFILE）时，水平触发的监听套接字会一直可读；先释放这个预留的 fd，
+    // 接受后立刻关闭，把排队的连接取走，避免主线程忙等（与 echo_epollserv 相同）
+    int spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    std::cout << "Echo Server started with " << threads
+              << " worker thread(s). Waiting for client connections..." << std::endl;
+
+    std::vector<struct epoll_event> events(MAX_EVENTS);
     while(1) {
-        clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
-        if(clnt_sock == -1) {
-            error_handling("accept() error");
+        int nfds = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, -1);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling("epoll_wait() error");
         }
-        
-        // 【核心修改】: 不再将客户端套接字加入全局列表，因为不需要了
-        // mtx.lock(); // <- 不再需要
-        // clnt_socks[clnt_count++] = clnt_sock; // <- 不再需要
-        // mtx.unlock(); // <- 不再需要
-
-        // 创建工作线程，处理该客户端的回显请求
-        std::thread t(handle_client, clnt_sock);
-        t.detach();
-                        
-        char clnt_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
-        std::cout << "New client connected: IP=" << clnt_ip 
-                    << ", Port=" << ntohs(clnt_addr.sin_port) 
-                    << ", Socket FD=" << clnt_sock << std::endl;
-    }
-    
+
+        for (int i = 0; i < nfds; i++) {
+            Connection* conn = (Connection*)events[i].data.ptr;
+            if (conn != nullptr) {
+                // 连接就绪：交给线程池。EPOLLONESHOT 保证在工作线程 rearm 之前不会再次上报
+                pool.submit(conn);
+                continue;
+            }
+
+            // 监听套接字就绪：把积压的新连接全部接受
+            while (true) {
+                clnt_addr_size = sizeof(clnt_addr);
+                clnt_sock = accept4(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size, SOCK_NONBLOCK);
+                if(clnt_sock == -1) {
+                    if ((errno == EMFILE || errno == ENFILE) && spare_fd != -1) {
+                        // fd 不够时 accept 在检查队列之前就失败，队列空了也一直是 EMFILE，所以取不到连接时要退出循环
+                        close(spare_fd);
+                        int rejected = accept(serv_sock, NULL, NULL);
+                        if (rejected != -1) {
+                            close(rejected);
+                        }
+                        spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                        if (rejected == -1) {
+                            break;
+                        }
+                        if (!quiet) {
+                            log_line("Too many open files, connection rejected");
+                        }
+                        continue;
+                    }
+                    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                        log_line("accept() error (errno: " + std::to_string(errno) + ")");
+                    }
+                    break;
+                }
+
+                Connection* new_conn = new Connection{clnt_sock, std::string()};
+                struct epoll_event cev;
+                cev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                cev.data.ptr = new_conn;
+                epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &cev);
+
+                if (!quiet) {
+                    char clnt_ip[INET_ADDRSTRLEN];
+                    inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
+                    log_line(std::string("New client connected: IP=") + clnt_ip
+                             + ", Port=" + std::to_string(ntohs(clnt_addr.sin_port))
+                             + ", Socket FD=" + std::to_string(clnt_sock));
+                }
+            }
+        }
+    }
+
     close(serv_sock); // 这行代码同样不会被执行
     return 0;
 }
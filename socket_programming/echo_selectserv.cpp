@@ -1,23 +1,45 @@
-#include <bits/types/struct_timeval.h> // 包含 timeval 结构体的定义
 #include <cstring> // 包含内存操作函数，如 memset
 #include <iostream> // 包含标准输入输出流
 #include <string> // 包含 std::string
+#include <vector> // 包含 std::vector，按 fd 下标保存每个连接的状态
 #include <sys/socket.h> // 包含套接字相关的函数和结构体
 #include <netinet/in.h> // 包含互联网地址族结构体（sockaddr_in）
-#include <sys/wait.h> // 包含 waitpid 等待子进程的函数
 #include <unistd.h> // 包含 POSIX 操作系统 API，如 close, read, write
 #include <arpa/inet.h> // 包含网络地址转换函数，如 htonl, htons
-#include <wait.h> // 包含 wait 相关的函数（通常 sys/wait.h 已经包含）
 #include <signal.h> // 包含信号处理函数
 #include <errno.h> // 包含错误码定义
-#include <sys/select.h> // 包含 select 函数和 fd_set 相关的宏
+#include <fcntl.h> // 包含 fcntl，把监听套接字设为非阻塞
+#include <sys/resource.h> // 包含 setrlimit，提高可打开的 fd 上限
+#include <chrono> // 包含 steady_clock，用于空闲超时
+#include "poller.h" // select / poll / epoll 三种就绪通知实现
+#include "timer_wheel.h" // 分层时间轮，给每个连接挂空闲超时
 
 const int BUF_SIZE = 1024; // 定义缓冲区大小
 #define ISPRINT true // 定义是否打印错误信息
 
+bool quiet = false; // --quiet: 关闭逐连接/逐消息日志，压测时避免 cout 成为瓶颈
+int idle_timeout_sec = 60; // --idle-timeout: 连接多少秒没有任何读写进展就关闭，0 表示不超时
+
+/**
+ * @brief 每个客户端连接的状态：没能立刻写出去的回显数据和空闲超时定时器。
+ * 有积压时只关注可写事件、不再读，等积压发完再恢复读取。
+ */
+struct Client {
+    std::string pending;
+    TimerWheel::TimerId timer = TimerWheel::INVALID;
+};
+
+/**
+ * @brief 单调时钟的当前时间（毫秒）
+ */
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /**
  * @brief 错误处理函数，打印错误信息并退出程序。
- * 
+ *
  * @param message 要打印的错误信息。
  */
 void error_handling(std::string message) {
@@ -28,36 +50,86 @@ void error_handling(std::string message) {
 }
 
 /**
- * @brief 主函数，实现一个基于 select 的多连接 TCP 服务器。
- * 
+ * @brief 把可打开的 fd 数量提高到硬上限，几万个连接需要几万个 fd
+ */
+void raise_fd_limit() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        std::cout << "fd limit: " << rl.rlim_cur << std::endl;
+    }
+}
+
+/**
+ * @brief 尽量写出积压的数据
+ * @return bool 连接出错返回 false
+ */
+bool flush_pending(int fd, Client& client) {
+    while (!client.pending.empty()) {
+        ssize_t n = write(fd, client.pending.data(), client.pending.size());
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.pending.erase(0, n);
+    }
+    return true;
+}
+
+/**
+ * @brief 主函数，实现一个基于 select（也可以换成 poll / epoll）的多连接 TCP 服务器。
+ *
  * @param argc 参数个数。
- * @param argv 参数数组。第一个参数应为端口号。
+ * @param argv 参数数组：<port> [--backend select|poll|epoll] [--idle-timeout SEC] [--quiet]。
  * @return int 返回程序退出状态。
  */
 int main(int argc, char** argv) {
 
     int serv_sock; // 服务器套接字文件描述符
     int clnt_sock; // 客户端套接字文件描述符
-    fd_set read_fds; // 文件描述符集合，用于 select 监控可读事件
-    struct timeval timeout; // select 的超时时间结构体
 
     struct sockaddr_in serv_addr; // 服务器地址信息结构体
     struct sockaddr_in clnt_addr; // 客户端地址信息结构体
     socklen_t clnt_addr_size; // 客户端地址结构体大小
     char message[BUF_SIZE]; // 用于接收和发送数据的缓冲区
-    
-    
-    if (argc != 2) {
-        // 检查参数数量，确保用户提供了端口号
-        error_handling("Usage: <port>");
+
+    int port = -1;
+    std::string backend = "select"; // --backend：就绪通知的实现
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--backend" && i + 1 < argc) {
+            backend = argv[++i];
+        } else if (arg == "--idle-timeout" && i + 1 < argc) {
+            idle_timeout_sec = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    std::unique_ptr<Poller> poller = Poller::create(backend);
+    if (port <= 0 || !poller || idle_timeout_sec < 0) {
+        // 检查参数，确保用户提供了端口号和认识的后端
+        error_handling("Usage: <port> [--backend select|poll|epoll] [--idle-timeout SEC] [--quiet]");
     }
 
+    signal(SIGPIPE, SIG_IGN); // 对端关闭后继续写只返回 EPIPE，不要杀死进程
+    raise_fd_limit();
+
     // 1. 创建服务器套接字：使用 IPv4 (PF_INET)，TCP 协议 (SOCK_STREAM)，默认协议 (0)
     serv_sock = socket(PF_INET, SOCK_STREAM, 0);
 
     // 设置套接字选项 SO_REUSEADDR，允许地址重用，防止 TIME_WAIT 状态导致重启失败
     int optval = 1;
-    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, 
+    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR,
                 (void*)&optval, sizeof(optval));
 
     if(serv_sock == -1) {
@@ -68,107 +140,149 @@ int main(int argc, char** argv) {
     memset(&serv_addr, 0, sizeof(serv_addr)); // 清零
     serv_addr.sin_family = AF_INET; // 设置为 IPv4
     // INADDR_ANY 表示接受来自任何 IP 地址的连接请求，使用网络字节序
-    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY); 
+    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     // 设置端口号，从命令行参数获取并转换为网络字节序
-    serv_addr.sin_port = htons(atoi(argv[1]));
+    serv_addr.sin_port = htons(port);
 
     // 3. 绑定套接字到指定地址和端口
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
         error_handling("bind() error");
     }
 
-    // 4. 监听连接请求，设置等待队列最大长度为 5
-    if(listen(serv_sock, 5) == -1) {
+    // 4. 监听连接请求；大量连接同时到来时，队列太短会让客户端的 SYN 被丢弃
+    if(listen(serv_sock, SOMAXCONN) == -1) {
         error_handling("listen() error");
     }
+    // 非阻塞：一次可读通知里把排队的连接全部 accept 掉，直到 EAGAIN
+    fcntl(serv_sock, F_SETFL, fcntl(serv_sock, F_GETFL, 0) | O_NONBLOCK);
 
-    // 初始化文件描述符集合 (read_fds)
-    FD_ZERO(&read_fds);
-    // 将服务器套接字添加到监控集合中，因为它负责接收新的连接
-    FD_SET(serv_sock, &read_fds);
-    // 初始化当前最大文件描述符为服务器套接字
-    int max_fd = serv_sock;
+    // 将服务器套接字加入监控，因为它负责接收新的连接
+    poller->add(serv_sock, Poller::READ);
 
-    // 设置 select 的超时时间为 5 秒
-    timeout.tv_sec = 5;
-    timeout.tv_usec = 0;
+    // fd 用完（EMFILE）时，监听套接字会一直可读；先释放这个预留的 fd，接受后立刻关闭，避免忙等
+    int spare_fd = open("/dev/null", O_RDONLY);
 
+    std::vector<Client> clients; // fd -> 连接状态
+    std::vector<PollEvent> events;
+    int64_t loop_now = now_ms(); // 本轮 wait 返回时的时间，同一轮的事件共用
+    TimerWheel timers(loop_now);
 
-    // 5. 主循环：使用 select 监听事件
+    // 从监控中移除该套接字，再关闭；select 后端的 max_fd 会随之降低
+    auto close_client = [&](int fd) {
+        Client& client = clients[fd];
+        timers.cancel(client.timer);
+        client.timer = TimerWheel::INVALID;
+        poller->remove(fd);
+        close(fd);
+        client.pending.clear();
+        client.pending.shrink_to_fit();
+    };
+    std::cout << "Server started on port " << port << " (backend: " << poller->name() << ")" << std::endl;
+
+    // 5. 主循环：等待事件，只处理就绪的 fd
     while(1) {
-        // 每次调用 select 前必须重新复制 read_fds，因为 select 会修改其内容
-        fd_set tmp_fds = read_fds;
-        
-        // 每次循环需要重置 timeout，因为一些系统（如 Linux）select 可能会修改 timeout
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
-
-        // 调用 select 进行阻塞等待，监听 max_fd + 1 个描述符的读事件
-        int result = select(max_fd + 1, &tmp_fds, NULL, NULL, &timeout);
-        
+        // 超时由时间轮决定：没有连接时一直等，否则最多等到最近的空闲定时器到期
+        int result = poller->wait(events, timers.timeout_ms(now_ms(), -1));
+
         if(result == -1) {
-            // select 错误
-            error_handling("select() error");
-        } else if(result == 0) {
-            // 超时，没有发生任何事件
-            std::cout << "Time out" << std::endl;
-            continue;
+            if (errno == EINTR) {
+                continue;
+            }
+            // wait 错误
+            error_handling("wait() error");
         }
+        loop_now = now_ms();
 
-        // 遍历所有可能的 fd，检查哪个 fd 产生了事件
-        for(int fd = 0; fd <= max_fd; fd++) { 
-            // 检查当前 fd 是否在 select 返回的集合中（即可读）
-            if(FD_ISSET(fd, &tmp_fds)) { 
-                
-                if(fd == serv_sock) {
-                    // 如果是服务器套接字可读，表示有新的连接请求
-                    std::cout << "Connected client (socket " << fd << ")" << std::endl;
-                    
+        for (const PollEvent& ev : events) {
+            int fd = ev.fd;
+            if(fd == serv_sock) {
+                // 如果是服务器套接字可读，表示有新的连接请求
+                while (true) {
                     clnt_addr_size = sizeof(clnt_addr);
-                    // 接受新的连接
-                    clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
-                    
+                    // 接受新的连接，直接设为非阻塞
+                    clnt_sock = accept4(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size, SOCK_NONBLOCK);
+
                     if(clnt_sock == -1) {
-                        // 如果 accept 被信号中断 (EINTR)，则继续循环
+                        // 如果 accept 被信号中断 (EINTR)，则继续
                         if (errno == EINTR) {
                             continue;
                         }
-                        error_handling("accept() error");
+                        if (errno == EMFILE && spare_fd != -1) {
+                            close(spare_fd);
+                            close(accept(serv_sock, NULL, NULL));
+                            spare_fd = open("/dev/null", O_RDONLY);
+                            if (!quiet) {
+                                std::cout << "Too many open files, connection rejected" << std::endl;
+                            }
+                            continue;
+                        }
+                        break; // EAGAIN：排队的连接已经取完
+                    }
+
+                    if (!poller->add(clnt_sock, Poller::READ)) {
+                        close(clnt_sock);
+                        continue;
+                    }
+                    if ((size_t)clnt_sock >= clients.size()) {
+                        clients.resize(clnt_sock + 1);
                     }
-                    
-                    // 将新的客户端套接字加入到总的监控集合 read_fds 中
-                    FD_SET(clnt_sock, &read_fds);
-                    // 更新最大文件描述符
-                    max_fd = std::max(max_fd, clnt_sock);
-
-                } else {
-                    // 如果是客户端套接字可读，表示有数据到达或连接关闭
-
-                    // 读取数据
-                    int str_len = read(fd, message, sizeof(message));
-                    
-                    if(str_len == 0) {
-                        // read() 返回 0 表示客户端关闭了连接 (EOF)
+                    if (idle_timeout_sec > 0) {
+                        clients[clnt_sock].timer = timers.add(loop_now + idle_timeout_sec * 1000LL, clnt_sock);
+                    }
+                    if (!quiet) {
+                        std::cout << "Connected client (socket " << clnt_sock << ")" << std::endl;
+                    }
+                }
+                continue;
+            }
+
+            Client& client = clients[fd];
+            bool ok = true;
+            timers.reset(client.timer, loop_now + idle_timeout_sec * 1000LL); // 有事件就顺延空闲超时，O(1)
+            if (ev.events & Poller::WRITE) {
+                // 积压的数据可以继续写了，写完后恢复读取
+                ok = flush_pending(fd, client);
+                if (ok && client.pending.empty()) {
+                    poller->modify(fd, Poller::READ);
+                }
+            } else if (ev.events & (Poller::READ | Poller::ERROR)) {
+                // 如果是客户端套接字可读，表示有数据到达或连接关闭
+                ssize_t str_len = read(fd, message, sizeof(message));
+
+                if(str_len == 0 || (str_len == -1 && errno != EAGAIN && errno != EINTR)) {
+                    // read() 返回 0 表示客户端关闭了连接 (EOF)
+                    if (!quiet) {
                         std::cout << "Client " << fd << " disconnected" << std::endl;
-                        
-                        // 从监控集合中移除该套接字
-                        FD_CLR(fd, &read_fds);
-                        // 关闭该套接字
-                        close(fd);
-                        // 注意：此处如果断开的 fd 是 max_fd，理论上需要重新计算 max_fd，
-                        // 但由于 max_fd 只是 select 的上限，不影响正确性，只是效率略有降低。
-                    } else {
-                        // 读到数据，进行回显
-                        message[str_len] = '\0'; // 确保数据以 null 结尾（如果需要按字符串输出）
-                        std::cout << "Message from client " << fd << ": " << message << std::endl;
-                        
-                        // 将收到的数据回写给客户端
-                        write(fd, message, str_len);
+                    }
+                    ok = false;
+                } else if (str_len > 0) {
+                    // 读到数据，进行回显
+                    if (!quiet) {
+                        std::cout << "Message from client " << fd << ": " << std::string(message, str_len) << std::endl;
+                    }
+                    // 将收到的数据回写给客户端；写不完的部分留到可写时再发，期间不再读
+                    client.pending.append(message, str_len);
+                    ok = flush_pending(fd, client);
+                    if (ok && !client.pending.empty()) {
+                        poller->modify(fd, Poller::WRITE);
                     }
                 }
-            } 
+            }
+
+            if (!ok) {
+                close_client(fd);
+            }
         }
 
+        // 空闲超时：只处理到期的定时器；对端不收数据时也不会再有可写事件，同样会超时
+        timers.advance(now_ms(), [&](uint64_t fd) {
+            if (!quiet) {
+                std::cout << "Client " << fd << " timed out" << std::endl;
+            }
+            clients[fd].timer = TimerWheel::INVALID;
+            close_client((int)fd);
+        });
+
     }
     // 6. 关闭服务器套接字（实际上循环是无限的，这行代码不会执行到）
     close(serv_sock);
@@ -0,0 +1,696 @@
+#include <cstring>                     // 包含内存操作函数，如 memset
+#include <iostream>                    // 包含标准输入输出流，用于 cout
+#include <string>                      // 包含 std::string
+#include <vector>                      // 包含 std::vector
+#include <deque>                       // 包含 std::deque，保存每个连接排队待发送的缓冲区
+#include <thread>                      // 包含 std::thread，多 reactor 模式下每个线程一个 ring
+#include <mutex>                       // 包含 std::mutex，用于多线程下串行化日志输出
+#include <atomic>                      // 包含 std::atomic，统计计数
+#include <sys/socket.h>                // 包含套接字相关的函数和结构体定义
+#include <netinet/in.h>                // 包含互联网地址族结构体（sockaddr_in）
+#include <unistd.h>                    // 包含 POSIX 操作系统 API，如 close
+#include <arpa/inet.h>                 // 包含网络地址转换函数，如 htonl, htons
+#include <errno.h>                     // 包含错误码定义 (errno)
+#include <signal.h>                    // 包含信号处理函数，Ctrl+C 时打印统计
+#include <sys/mman.h>                  // 包含 mmap，用于映射 io_uring 的共享环形队列
+#include <sys/syscall.h>               // 包含 syscall 编号（系统里没有 liburing，直接走系统调用）
+#include <linux/io_uring.h>            // 包含 io_uring 的内核接口定义
+
+const int RING_ENTRIES = 4096;     // 提交队列（SQ）长度，完成队列（CQ）默认是它的两倍
+const int BUF_COUNT = 1024;        // 每个 reactor 提供给内核的缓冲区个数，必须是 2 的幂
+const int BUF_SIZE = 16 * 1024;    // 每个缓冲区 16 KB，与 echo_epollserv 的缓冲池 chunk 大小一致
+const int BUF_GROUP = 0;           // 缓冲区组编号（recv 时由内核从这个组里挑缓冲区）
+const size_t MAX_QUEUED = 32;      // 每个连接最多排队多少个待发送的缓冲区，超过时停止接收
+const size_t RESUME_QUEUED = MAX_QUEUED / 2; // 排队降到这么多时恢复接收
+
+#define ISPRINT true // 宏定义，用于控制错误信息是否打印到控制台
+
+bool quiet = false;  // --quiet: 关闭逐连接/逐消息日志，压测时避免 cout 成为瓶颈
+std::mutex log_mtx;  // 多个 reactor 线程共享 cout，需要加锁避免输出交错
+
+// 统计信息：Ctrl+C 时打印"系统调用次数 / 消息数"，用来和 epoll 版本对比
+std::atomic<unsigned long long> total_enters(0);   // io_uring_enter 调用次数
+std::atomic<unsigned long long> total_messages(0); // 收到的消息（recv 完成事件）数
+std::atomic<unsigned long long> total_bytes(0);    // 回显的字节数
+
+/**
+ * @brief 统一的错误处理函数。
+ * 打印指定的错误信息并终止程序运行。
+ *
+ * @param message 需要打印的错误信息字符串。
+ */
+void error_handling(std::string message) {
+    #if ISPRINT
+    std::cerr << message << " (errno: " << errno << ")" << std::endl; // 使用 cerr 输出错误流，并附带 errno
+    #endif
+    exit(1); // 异常退出程序
+}
+
+/**
+ * @brief 线程安全的日志输出，--quiet 时直接忽略。
+ */
+void log_line(const std::string& line) {
+    if (quiet) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(log_mtx);
+    std::cout << line << std::endl;
+}
+
+/**
+ * @brief 创建、绑定并监听一个 TCP 服务器套接字（与 echo_epollserv 相同）。
+ *
+ * @param port 监听端口。
+ * @param reuse_port 是否设置 SO_REUSEPORT，多 reactor 模式下每个线程各持有一个监听套接字。
+ * @return int 监听套接字的文件描述符。
+ */
+int create_listen_socket(int port, bool reuse_port) {
+    struct sockaddr_in serv_addr;
+
+    int serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    if(serv_sock == -1) {
+        error_handling("socket() error");
+    }
+
+    int optval = 1;
+    if(setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR,
+                  (void*)&optval, sizeof(optval)) == -1) {
+        error_handling("setsockopt() error");
+    }
+    if(reuse_port && setsockopt(serv_sock, SOL_SOCKET, SO_REUSEPORT,
+                                (void*)&optval, sizeof(optval)) == -1) {
+        error_handling("setsockopt(SO_REUSEPORT) error");
+    }
+
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    serv_addr.sin_port = htons(port);
+
+    if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
+        error_handling("bind() error");
+    }
+    if(listen(serv_sock, SOMAXCONN) == -1) {
+        error_handling("listen() error");
+    }
+    return serv_sock;
+}
+
+// ===================================================================================
+// 最小化的 io_uring 封装
+// 只实现本程序用到的部分：建立 SQ/CQ 共享内存、取 SQE、批量提交并等待、遍历 CQE。
+// ===================================================================================
+
+/**
+ * @brief 一个 io_uring 实例。
+ * 用户态和内核通过两个共享的环形队列通信：
+ *   SQ（提交队列）：用户填写 SQE 描述要做的 I/O，移动 tail 通知内核；
+ *   CQ（完成队列）：内核把结果写成 CQE，移动 tail；用户处理完后移动 head。
+ * 一次 io_uring_enter 可以同时提交任意多个 SQE 并等待完成事件，这就是批量化的来源。
+ */
+struct Ring {
+    int fd = -1;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    io_uring_sqe* sqes;
+    unsigned sq_local_tail = 0; // 已填写但尚未对内核可见的 tail
+    unsigned to_submit = 0;     // 本轮累计、尚未提交的 SQE 数
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+    std::vector<io_uring_cqe> backlog; // SQ 满而内核因为 CQ 积压不肯取走 SQE 时，从 CQ 里先搬出来、还没处理的 CQE
+
+    void setup(unsigned entries) {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        fd = syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) {
+            error_handling("io_uring_setup() error, kernel may not support io_uring (try echo_epollserv)");
+        }
+        if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+            error_handling("io_uring: kernel too old (IORING_FEAT_SINGLE_MMAP required)");
+        }
+
+        // SQ 和 CQ 的环形头部共用一块映射（IORING_FEAT_SINGLE_MMAP），取两者较大的长度
+        size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        size_t ring_size = sq_size > cq_size ? sq_size : cq_size;
+        char* ring = (char*)mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED) {
+            error_handling("mmap() io_uring ring error");
+        }
+        sqes = (io_uring_sqe*)mmap(NULL, p.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            error_handling("mmap() io_uring sqes error");
+        }
+
+        sq_head = (unsigned*)(ring + p.sq_off.head);
+        sq_tail = (unsigned*)(ring + p.sq_off.tail);
+        sq_mask = (unsigned*)(ring + p.sq_off.ring_mask);
+        sq_array = (unsigned*)(ring + p.sq_off.array);
+        cq_head = (unsigned*)(ring + p.cq_off.head);
+        cq_tail = (unsigned*)(ring + p.cq_off.tail);
+        cq_mask = (unsigned*)(ring + p.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(ring + p.cq_off.cqes);
+        sq_local_tail = *sq_tail;
+    }
+
+    /**
+     * @brief 取一个空闲 SQE。SQ 满时先把已有的提交给内核再取。
+     * CQ 积压时内核不取走 SQE（EBUSY），这时把 CQ 里的完成事件搬进 backlog 腾出空间再提交，
+     * 直到 SQ 有空位；不能在这里处理它们（调用者可能正在处理某个 CQE），for_each_cqe 会按顺序补上。
+     */
+    io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        while (sq_local_tail - head > *sq_mask) {
+            enter(0);
+            head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            if (sq_local_tail - head > *sq_mask && !stash_cqes()) {
+                error_handling("io_uring: submission queue full and kernel consumed nothing");
+            }
+        }
+        unsigned idx = sq_local_tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array[idx] = idx;
+        sq_local_tail++;
+        to_submit++;
+        return sqe;
+    }
+
+    /**
+     * @brief 提交本轮累计的全部 SQE，并至少等待 wait_nr 个完成事件（一次系统调用）。
+     */
+    void enter(unsigned wait_nr) {
+        __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        while (true) {
+            int ret = syscall(__NR_io_uring_enter, fd, to_submit, wait_nr, flags, NULL, 0);
+            total_enters.fetch_add(1, std::memory_order_relaxed);
+            if (ret >= 0) {
+                to_submit -= ret < (int)to_submit ? ret : to_submit;
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EBUSY || errno == EAGAIN) {
+                return; // CQ 积压，先回去处理完成事件
+            }
+            error_handling("io_uring_enter() error");
+        }
+    }
+
+    /**
+     * @brief 依次处理当前所有可用的 CQE（先处理 backlog 里更早的）。
+     * 每个 CQE 先拷贝出来、推进 head 再处理，处理过程中 get_sqe 可以安全地把剩下的 CQE 搬进 backlog。
+     */
+    template <typename F>
+    void for_each_cqe(F&& handle) {
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (true) {
+            while (!backlog.empty()) {
+                std::vector<io_uring_cqe> pending;
+                pending.swap(backlog);
+                for (const io_uring_cqe& cqe : pending) {
+                    handle(cqe);
+                }
+            }
+            unsigned head = *cq_head;
+            if ((int)(tail - head) <= 0) {
+                break;
+            }
+            io_uring_cqe cqe = cqes[head & *cq_mask];
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            handle(cqe);
+        }
+    }
+
+    /**
+     * @brief 把 CQ 里所有可用的 CQE 搬进 backlog，返回是否搬出了任何一个
+     */
+    bool stash_cqes() {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (unsigned h = head; h != tail; h++) {
+            backlog.push_back(cqes[h & *cq_mask]);
+        }
+        __atomic_store_n(cq_head, tail, __ATOMIC_RELEASE);
+        return head != tail;
+    }
+};
+
+// user_data 的高 8 位表示操作类型，低位放 fd 或缓冲区编号
+enum OpKind : unsigned long long { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_PROVIDE = 4, OP_PROBE = 5, OP_CANCEL = 6 };
+
+inline unsigned long long make_user_data(OpKind kind, unsigned value) {
+    return ((unsigned long long)kind << 56) | value;
+}
+
+/**
+ * @brief 提供给内核的缓冲区环（provided buffer ring）。
+ * 多发 recv 不预先绑定缓冲区，而是在数据到达时由内核从这个环里取一个空闲缓冲区，
+ * CQE 里带回缓冲区编号（bid）。用户用完后把缓冲区重新放回环中，归还只是写内存，不需要系统调用。
+ *
+ * 有些内核/沙箱环境能注册缓冲区环但 recv 始终返回 ENOBUFS，所以启动时用一对 socketpair 做一次探测；
+ * 探测失败则退回到旧式的 IORING_OP_PROVIDE_BUFFERS：归还缓冲区改为追加一个 SQE，
+ * 随下一次 io_uring_enter 批量提交，仍然不会额外增加系统调用。
+ */
+struct BufferRing {
+    io_uring_buf_ring* br = nullptr;
+    char* buffers;
+    unsigned mask;
+    bool use_ring = true; // false 表示退回到 IORING_OP_PROVIDE_BUFFERS
+
+    void setup(Ring& ring) {
+        buffers = new char[(size_t)BUF_COUNT * BUF_SIZE];
+        mask = BUF_COUNT - 1;
+
+        size_t ring_bytes = BUF_COUNT * sizeof(io_uring_buf);
+        br = (io_uring_buf_ring*)mmap(NULL, ring_bytes, PROT_READ | PROT_WRITE,
+                                      MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (br == MAP_FAILED) {
+            error_handling("mmap() buffer ring error");
+        }
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (unsigned long)br;
+        reg.ring_entries = BUF_COUNT;
+        reg.bgid = BUF_GROUP;
+        if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            use_ring = false; // 5.19 以前的内核没有缓冲区环
+        } else {
+            br->tail = 0;
+            for (int bid = 0; bid < BUF_COUNT; bid++) {
+                put(bid, bid);
+            }
+            publish(BUF_COUNT);
+            use_ring = probe(ring);
+            if (!use_ring) {
+                syscall(__NR_io_uring_register, ring.fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            }
+        }
+
+        if (!use_ring) {
+            // 一个 SQE 一次性提供全部缓冲区
+            io_uring_sqe* sqe = ring.get_sqe();
+            sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+            sqe->fd = BUF_COUNT;
+            sqe->addr = (unsigned long)buffers;
+            sqe->len = BUF_SIZE;
+            sqe->off = 0;
+            sqe->buf_group = BUF_GROUP;
+            sqe->user_data = make_user_data(OP_PROVIDE, 0);
+            ring.enter(1);
+            ring.for_each_cqe([](const io_uring_cqe& cqe) {
+                if (cqe.res < 0) {
+                    errno = -cqe.res;
+                    error_handling("IORING_OP_PROVIDE_BUFFERS error");
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief 用一次单发 recv 验证缓冲区环真的可用，成功则把用掉的缓冲区放回去。
+     */
+    bool probe(Ring& ring) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+            return true;
+        }
+        if (write(sv[1], "x", 1) != 1) {
+            close(sv[0]);
+            close(sv[1]);
+            return true;
+        }
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = sv[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUF_GROUP;
+        sqe->user_data = make_user_data(OP_PROBE, 0);
+        ring.enter(1);
+        bool ok = false;
+        ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                ok = true;
+                put(cqe.flags >> IORING_CQE_BUFFER_SHIFT, 0);
+                publish(1);
+            }
+        });
+        close(sv[0]);
+        close(sv[1]);
+        return ok;
+    }
+
+    char* addr(unsigned bid) { return buffers + (size_t)bid * BUF_SIZE; }
+
+    // 在 tail 之后第 offset 个位置放入缓冲区 bid（还未对内核可见）
+    void put(unsigned bid, unsigned offset) {
+        io_uring_buf* buf = &br->bufs[(br->tail + offset) & mask];
+        buf->addr = (unsigned long)addr(bid);
+        buf->len = BUF_SIZE;
+        buf->bid = bid;
+    }
+
+    // 让内核看到新放入的 count 个缓冲区
+    void publish(unsigned count) {
+        __atomic_store_n(&br->tail, (unsigned short)(br->tail + count), __ATOMIC_RELEASE);
+    }
+
+    void recycle(Ring& ring, unsigned bid) {
+        if (use_ring) {
+            put(bid, 0);
+            publish(1);
+            return;
+        }
+        // 成功时不产生 CQE（IOSQE_CQE_SKIP_SUCCESS），跟随下一次 io_uring_enter 一起提交
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->fd = 1;
+        sqe->addr = (unsigned long)addr(bid);
+        sqe->len = BUF_SIZE;
+        sqe->off = bid;
+        sqe->buf_group = BUF_GROUP;
+        sqe->user_data = make_user_data(OP_PROVIDE, bid);
+    }
+};
+
+/**
+ * @brief 每个客户端连接的状态（按 fd 下标存放）。
+ * 同一连接同一时刻只允许一个 send 在途，后续收到的数据排队，保证回显顺序与接收顺序一致。
+ * 排队的缓冲区超过 MAX_QUEUED 时取消多发 recv（只发不收的客户端不能占满整个缓冲区环，
+ * 让其他连接都拿不到缓冲区），排队降到 RESUME_QUEUED 以下再重新挂上。
+ */
+struct Conn {
+    bool recv_armed = false;     // 多发 recv 是否仍在内核中有效
+    bool sending = false;        // 是否有 send 在途
+    bool peer_closed = false;    // 对端已关闭或连接出错，不再接收新数据
+    bool throttled = false;      // 因为排队太多而停止接收
+    std::deque<unsigned> queue;  // 等待发送的缓冲区编号
+};
+
+/**
+ * @brief 每个发送中缓冲区的状态（按 bid 下标存放，一个缓冲区最多对应一个在途 send）。
+ */
+struct SendState {
+    int fd;
+    unsigned len;
+    unsigned off;
+};
+
+/**
+ * @brief 一个 reactor：独占一个 io_uring 实例和一个监听套接字。
+ *
+ * 事件循环的每一轮只有一次 io_uring_enter：把上一轮处理完成事件时产生的所有新请求
+ * （新的 recv、send、accept）一并提交，同时等待下一批完成事件。
+ *   - accept 使用多发模式：提交一次，之后每来一个连接产生一个 CQE；
+ *   - recv 使用多发模式 + 缓冲区环：每个连接只提交一次，数据到达时内核自己挑缓冲区；
+ *   - send 直接发送 recv 得到的缓冲区，完成后把缓冲区还给缓冲区环，全程没有数据拷贝。
+ *
+ * @param reactor_id reactor 编号，仅用于日志。
+ * @param serv_sock 该 reactor 负责的监听套接字。
+ */
+void reactor_loop(int reactor_id, int serv_sock) {
+    std::string tag = "[reactor " + std::to_string(reactor_id) + "] ";
+    Ring ring;
+    ring.setup(RING_ENTRIES);
+    BufferRing bufs;
+    bufs.setup(ring);
+    {
+        std::lock_guard<std::mutex> lock(log_mtx);
+        std::cout << tag << (bufs.use_ring ? "using provided buffer ring"
+                                           : "buffer ring unavailable, using IORING_OP_PROVIDE_BUFFERS")
+                  << std::endl;
+    }
+
+    std::vector<Conn> conns;                 // fd -> 连接状态
+    std::vector<SendState> sends(BUF_COUNT); // bid -> 发送状态
+    std::vector<int> starved;                // 因缓冲区耗尽而停止接收、等待重新挂 recv 的连接
+
+    auto arm_accept = [&]() {
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = serv_sock;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->user_data = make_user_data(OP_ACCEPT, 0);
+    };
+
+    auto arm_recv = [&](int fd) {
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUF_GROUP;
+        sqe->user_data = make_user_data(OP_RECV, fd);
+        conns[fd].recv_armed = true;
+    };
+
+    auto arm_send = [&](unsigned bid) {
+        SendState& st = sends[bid];
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = st.fd;
+        sqe->addr = (unsigned long)(bufs.addr(bid) + st.off);
+        sqe->len = st.len - st.off;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = make_user_data(OP_SEND, bid);
+    };
+
+    // 排队太多：取消这个连接的多发 recv，内核随后以 -ECANCELED 结束它
+    auto throttle = [&](int fd) {
+        Conn& c = conns[fd];
+        c.throttled = true;
+        if (c.recv_armed) {
+            io_uring_sqe* sqe = ring.get_sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = make_user_data(OP_RECV, fd);
+            sqe->user_data = make_user_data(OP_CANCEL, fd);
+        }
+    };
+
+    // 排队已经消化：恢复接收。被取消的多发 recv 还没送来最后一个 CQE 时先不动，由那个 CQE 再调用这里
+    auto maybe_resume = [&](int fd) {
+        Conn& c = conns[fd];
+        if (c.throttled && !c.recv_armed && c.queue.size() <= RESUME_QUEUED) {
+            c.throttled = false;
+            if (!c.peer_closed) {
+                arm_recv(fd);
+            }
+        }
+    };
+
+    // 连接上所有操作都结束后才真正 close，避免 fd 被复用后收到旧连接的完成事件
+    auto maybe_close = [&](int fd) {
+        Conn& c = conns[fd];
+        if (c.peer_closed && !c.recv_armed && !c.sending) {
+            log_line(tag + "Client disconnected (socket " + std::to_string(fd) + ")");
+            close(fd);
+            c = Conn();
+        }
+    };
+
+    // 缓冲区还回环中；如有连接因缓冲区耗尽而停收，重新给它们挂上 recv
+    auto recycle = [&](unsigned bid) {
+        bufs.recycle(ring, bid);
+        if (!starved.empty()) {
+            for (int fd : starved) {
+                if (!conns[fd].peer_closed && !conns[fd].recv_armed && !conns[fd].throttled) {
+                    arm_recv(fd);
+                }
+            }
+            starved.clear();
+        }
+    };
+
+    arm_accept();
+
+    while (true) {
+        // 一次系统调用：提交所有新 SQE + 至少等待 1 个完成事件
+        ring.enter(1);
+
+        ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+            OpKind kind = (OpKind)(cqe.user_data >> 56);
+            unsigned value = (unsigned)(cqe.user_data & 0xffffffffu);
+            bool more = cqe.flags & IORING_CQE_F_MORE;
+
+            if (kind == OP_ACCEPT) {
+                // --- 新连接 ---
+                if (cqe.res >= 0) {
+                    int fd = cqe.res;
+                    if ((size_t)fd >= conns.size()) {
+                        conns.resize(fd + 1);
+                    }
+                    conns[fd] = Conn();
+                    log_line(tag + "New client connected: Socket=" + std::to_string(fd));
+                    arm_recv(fd);
+                } else {
+                    std::cerr << tag << "accept error: " << strerror(-cqe.res) << std::endl;
+                }
+                if (!more) {
+                    arm_accept(); // 多发 accept 被内核终止（如出错），重新挂上
+                }
+
+            } else if (kind == OP_RECV) {
+                // --- 收到数据 ---
+                int fd = value;
+                Conn& c = conns[fd];
+                if (!more) {
+                    c.recv_armed = false;
+                }
+                if (cqe.res > 0) {
+                    unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                    total_messages.fetch_add(1, std::memory_order_relaxed);
+                    total_bytes.fetch_add(cqe.res, std::memory_order_relaxed);
+                    if (!quiet) {
+                        log_line(tag + "Message from client " + std::to_string(fd) + ": "
+                                 + std::string(bufs.addr(bid), cqe.res));
+                    }
+                    if (c.peer_closed) {
+                        recycle(bid);
+                    } else {
+                        sends[bid] = SendState{fd, (unsigned)cqe.res, 0};
+                        if (c.sending) {
+                            c.queue.push_back(bid);
+                            if (c.queue.size() >= MAX_QUEUED && !c.throttled) {
+                                throttle(fd);
+                            }
+                        } else {
+                            c.sending = true;
+                            arm_send(bid);
+                        }
+                    }
+                    if (!c.recv_armed && !c.peer_closed && !c.throttled) {
+                        arm_recv(fd);
+                    }
+                } else if (cqe.res == -ECANCELED && c.throttled) {
+                    // 被 throttle 取消；如果排队在此期间已经消化，立即恢复
+                    maybe_resume(fd);
+                } else if (cqe.res == -ENOBUFS) {
+                    // 缓冲区环暂时耗尽：等有缓冲区归还后再挂 recv
+                    starved.push_back(fd);
+                } else {
+                    // 0: 对端关闭；<0: 出错。都不再接收
+                    c.peer_closed = true;
+                    maybe_close(fd);
+                }
+
+            } else if (kind == OP_SEND) {
+                // --- 发送完成 ---
+                unsigned bid = value;
+                SendState& st = sends[bid];
+                int fd = st.fd;
+                Conn& c = conns[fd];
+                if (cqe.res > 0 && st.off + cqe.res < st.len) {
+                    st.off += cqe.res; // 部分发送，继续发剩下的
+                    arm_send(bid);
+                    return;
+                }
+                recycle(bid);
+                if (cqe.res < 0 && !c.peer_closed) {
+                    // 发送失败：丢弃排队的数据，关闭读方向让多发 recv 结束
+                    c.peer_closed = true;
+                    shutdown(fd, SHUT_RDWR);
+                }
+                if (c.peer_closed) {
+                    for (unsigned queued : c.queue) {
+                        recycle(queued);
+                    }
+                    c.queue.clear();
+                }
+                if (!c.queue.empty()) {
+                    unsigned next = c.queue.front();
+                    c.queue.pop_front();
+                    arm_send(next);
+                    maybe_resume(fd);
+                } else {
+                    maybe_resume(fd);
+                    c.sending = false;
+                    maybe_close(fd);
+                }
+
+            } else if (kind == OP_PROVIDE && cqe.res < 0) {
+                std::cerr << tag << "provide buffers error: " << strerror(-cqe.res) << std::endl;
+            }
+        });
+    }
+}
+
+/**
+ * @brief 主函数，实现一个基于 io_uring 的 TCP Echo 服务器。
+ * 命令行参数与 echo_epollserv 完全一致，方便在同一个压测下对比两者的
+ * 每条消息系统调用次数和尾延迟。Ctrl+C 退出时打印 io_uring_enter 次数和消息数。
+ *
+ * @param argc 命令行参数的数量。
+ * @param argv 命令行参数数组：<port> [--threads N] [--quiet]。
+ * @return int 程序的退出状态码。
+ */
+int main(int argc, char** argv) {
+
+    // --- 1. 初始化和参数检查 ---
+    int threads = 1; // reactor 线程数量，默认单线程
+    int port = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || threads <= 0) {
+        std::cout << "Usage: " << argv[0] << " <port> [--threads N] [--quiet]" << std::endl;
+        error_handling("Incorrect number of arguments");
+    }
+
+    // --- 2. 创建监听套接字 ---
+    bool reuse_port = threads > 1;
+    std::vector<int> listen_socks;
+    for (int i = 0; i < threads; i++) {
+        listen_socks.push_back(create_listen_socket(port, reuse_port));
+    }
+
+    // --- 3. 屏蔽 SIGINT/SIGTERM，由主线程统一用 sigwait 等待 ---
+    // 必须在创建工作线程之前设置，新线程会继承信号屏蔽字，这样信号只会被主线程收到。
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    std::cout << "io_uring server started on port " << port << " with " << threads
+              << " reactor(s), waiting for connections..." << std::endl;
+
+    // --- 4. 每个线程一个 io_uring 事件循环 ---
+    for (int i = 0; i < threads; i++) {
+        std::thread(reactor_loop, i, listen_socks[i]).detach();
+    }
+
+    int sig;
+    sigwait(&sigs, &sig);
+
+    unsigned long long enters = total_enters.load();
+    unsigned long long messages = total_messages.load();
+    std::cout << "\nio_uring_enter calls: " << enters
+              << ", messages: " << messages
+              << ", bytes: " << total_bytes.load();
+    if (messages > 0) {
+        std::cout << ", syscalls/message: " << (double)enters / messages;
+    }
+    std::cout << std::endl;
+    return 0;
+}
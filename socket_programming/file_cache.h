@@ -0,0 +1,446 @@
+#pragma once
+
+#include <cstddef>        // size_t
+#include <cstdint>        // int64_t
+#include <cstdio>         // snprintf
+#include <ctime>          // gmtime_r, strftime
+#include <list>           // std::list，LRU 链表
+#include <memory>         // std::shared_ptr
+#include <string>         // std::string
+#include <unordered_map>  // 键 -> LRU 节点
+#include <vector>         // std::vector
+#include <fcntl.h>        // open
+#include <unistd.h>       // read, close
+#include <sys/stat.h>     // fstat
+#include <sys/mman.h>     // mmap，大文件直接映射而不是读进堆内存
+#include <sys/inotify.h>  // inotify，文件被修改时让缓存项失效
+#include <limits.h>       // NAME_MAX
+
+/**
+ * @brief 热点文件缓存（LRU）：缓存文件内容和已经序列化好的响应头。
+ *
+ * 命中时既不打开文件也不 stat，更不重新拼接响应头：调用者拿到一个 Entry，直接把
+ * header 和 body 交给 writev/sendmsg。小文件读进内存，大文件用 mmap 映射（由页缓存承担，不占堆）。
+ * 总大小受内存预算限制，超出时淘汰最久未使用的项；单个超过 max_entry_bytes 的文件不缓存。
+ *
+ * 失效：优先用 inotify 监视缓存文件所在的目录，文件被修改、替换或删除时立刻丢弃对应的项；
+ * inotify 不可用时退化为每隔 REVALIDATE_MS 毫秒用 stat 检查一次 mtime 和大小。单个目录加不上监视时
+ * （例如达到 max_user_watches 上限），这个目录下的缓存项和元数据同样退化为定期 stat 检查；
+ * inotify 事件队列溢出时丢失了哪些事件无从知道，整个缓存清空。
+ *
+ * 除了原样缓存文件，调用者还可以用 insert() 放入由文件计算出来的内容（例如 gzip 压缩后的正文），
+ * 以自定义的键区分；每个缓存项记录自己依赖哪些文件，其中任何一个变化都会让它失效。
+ *
+ * 另外维护一张按路径索引的元数据表（inode、大小、mtime 以及由它们生成的 ETag / Last-Modified），
+ * 包括因为太大而不缓存内容的文件，条件请求的重新验证因此不需要 stat；它和缓存项一样由 inotify 失效。
+ *
+ * Entry 通过 shared_ptr 交给调用者，被淘汰后只要还有响应在发送它，内存就不会被释放。
+ * 非线程安全：设计上每个事件循环线程各自持有一个缓存。
+ */
+class FileCache {
+public:
+    static const size_t MMAP_THRESHOLD = 256 * 1024; // 超过这个大小的文件用 mmap
+    static const int64_t REVALIDATE_MS = 1000;       // 没有 inotify 时的 mtime 检查间隔
+
+    struct Entry {
+        std::string key;               // 缓存键，默认就是文件路径
+        std::string path;              // 内容来源的文件（无 inotify 时用它的 mtime 和大小校验）
+        std::vector<std::string> deps; // 依赖的文件，任何一个被修改、创建或删除都会让缓存项失效
+        size_t source_size = 0;        // 来源文件的大小
+        std::string header_keep_alive; // 完整的响应头（Connection: keep-alive）
+        std::string header_close;      // 完整的响应头（Connection: close）
+        const char* body = nullptr;    // 文件内容，指向 data 或 mmap 区域
+        size_t size = 0;
+        std::string data;              // 小文件的内容
+        void* map = nullptr;           // 大文件的 mmap 区域
+        struct timespec mtime = {0, 0};
+        std::string etag;              // 内容的 ETag（带引号），load 时由来源文件生成，调用者可以改写
+        std::string last_modified;     // HTTP 日期格式的修改时间
+        int64_t checked_ms = 0;        // 上一次 stat 校验的时间（无 inotify 时使用）
+        bool watched = false;          // 依赖的文件所在的目录是否都在 inotify 监视之下，否则定期 stat 校验
+        bool compressible = false;     // 调用者的标记：内容是否值得压缩（是否需要查找压缩版本）
+        mutable bool incompressible = false; // 调用者的标记：实时压缩过但没有变小，以后直接发送原内容（放入缓存后仍可修改）
+
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry() {
+            if (map != nullptr) {
+                munmap(map, size);
+            }
+        }
+        const std::string& header(bool keep_alive) const {
+            return keep_alive ? header_keep_alive : header_close;
+        }
+    };
+
+    /**
+     * @brief 一个文件的元数据和由它生成的验证器
+     */
+    struct Meta {
+        ino_t ino = 0;
+        off_t size = 0;
+        struct timespec mtime = {0, 0};
+        std::string etag;              // "<inode>-<mtime>-<大小>"（十六进制，带引号）
+        std::string last_modified;     // 例如 "Sun, 06 Nov 1994 08:49:37 GMT"
+        int64_t checked_ms = 0;        // 上一次 stat 的时间（无 inotify 时使用）
+        bool watched = false;          // 所在目录是否在 inotify 监视之下，否则定期 stat
+    };
+
+    static const size_t MAX_META = 16384; // 元数据表的项数上限，满了就整张清空
+
+    /**
+     * @param budget_bytes 所有缓存项内容的总大小上限
+     * @param max_entry_bytes 单个文件的大小上限，默认为预算的 1/4
+     */
+    explicit FileCache(size_t budget_bytes, size_t max_entry_bytes = 0)
+        : budget_(budget_bytes), max_entry_(max_entry_bytes ? max_entry_bytes : budget_bytes / 4) {
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+
+    ~FileCache() {
+        if (inotify_fd_ != -1) {
+            close(inotify_fd_);
+        }
+    }
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    /**
+     * @brief 查找缓存项，命中时移到 LRU 队首。
+     * @param now_ms 当前时间（毫秒），只在没有 inotify 时用于决定是否重新校验
+     */
+    std::shared_ptr<const Entry> lookup(const std::string& key, int64_t now_ms) {
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        std::shared_ptr<Entry>& entry = *it->second;
+        if (!entry->watched && now_ms - entry->checked_ms >= REVALIDATE_MS) {
+            struct stat st;
+            if (stat(entry->path.c_str(), &st) == -1 || (size_t)st.st_size != entry->source_size
+                || st.st_mtim.tv_sec != entry->mtime.tv_sec || st.st_mtim.tv_nsec != entry->mtime.tv_nsec) {
+                erase(it);
+                misses_++;
+                return nullptr;
+            }
+            entry->checked_ms = now_ms;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        hits_++;
+        return entry;
+    }
+
+    /**
+     * @brief 查询文件的元数据，命中时不访问文件系统。
+     * @return 文件不存在或不是普通文件时返回 nullptr（这种结果不缓存）；指针在下一次调用本对象的方法之前有效
+     */
+    const Meta* metadata(const std::string& path, int64_t now_ms) {
+        auto it = meta_.find(path);
+        if (it != meta_.end()) {
+            if (it->second.watched || now_ms - it->second.checked_ms < REVALIDATE_MS) {
+                return &it->second;
+            }
+            if (stat_meta(path, it->second)) {
+                it->second.checked_ms = now_ms;
+                return &it->second;
+            }
+            meta_.erase(it);
+            return nullptr;
+        }
+        Meta meta;
+        if (!stat_meta(path, meta)) {
+            return nullptr;
+        }
+        if (meta_.size() >= MAX_META) {
+            meta_.clear();
+        }
+        meta.checked_ms = now_ms;
+        meta.watched = watch_dir_of(path);
+        return &(meta_[path] = std::move(meta));
+    }
+
+    /**
+     * @brief 直接 stat 一个文件并生成它的验证器（不经过元数据表）
+     */
+    static bool stat_meta(const std::string& path, Meta& meta) {
+        struct stat st;
+        if (stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+            return false;
+        }
+        meta.ino = st.st_ino;
+        meta.size = st.st_size;
+        meta.mtime = st.st_mtim;
+        make_validators(st, meta.etag, meta.last_modified);
+        return true;
+    }
+
+    /**
+     * @brief 由 stat 结果生成强 ETag 和 Last-Modified
+     */
+    static void make_validators(const struct stat& st, std::string& etag, std::string& last_modified) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "\"%lx-%lx.%lx-%lx\"", (unsigned long)st.st_ino, (unsigned long)st.st_mtim.tv_sec,
+                 (unsigned long)st.st_mtim.tv_nsec, (unsigned long)st.st_size);
+        etag = buf;
+        struct tm tm;
+        time_t t = st.st_mtim.tv_sec;
+        gmtime_r(&t, &tm);
+        strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        last_modified = buf;
+    }
+
+    /**
+     * @brief 从磁盘加载文件并以文件路径为键放入缓存。
+     * @param init 内容读入后调用的函数 void(Entry&)，负责填写两个响应头和调用者自己的标记
+     * @return 新的缓存项；文件不存在、不是普通文件或超过单项上限时返回 nullptr，由调用者走非缓存路径
+     */
+    template <typename Init>
+    std::shared_ptr<const Entry> load(const std::string& path, int64_t now_ms, Init init) {
+        return load_as(path, path, {path}, now_ms, init);
+    }
+
+    /**
+     * @brief 从磁盘加载文件 path，以 key 为键放入缓存（例如用原文件的键缓存它的 .gz 版本）。
+     * @param deps 缓存项依赖的文件（通常包含 path 本身）
+     */
+    template <typename Init>
+    std::shared_ptr<const Entry> load_as(const std::string& key, const std::string& path,
+                                         std::vector<std::string> deps, int64_t now_ms, Init init) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || (size_t)st.st_size > max_entry_) {
+            close(fd);
+            return nullptr;
+        }
+
+        auto entry = std::make_shared<Entry>();
+        entry->path = path;
+        entry->size = st.st_size;
+        entry->source_size = st.st_size;
+        entry->mtime = st.st_mtim;
+        entry->checked_ms = now_ms;
+        make_validators(st, entry->etag, entry->last_modified);
+        if (entry->size >= MMAP_THRESHOLD) {
+            void* addr = mmap(nullptr, entry->size, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                return nullptr;
+            }
+            entry->map = addr;
+            entry->body = (const char*)addr;
+        } else {
+            entry->data.resize(entry->size);
+            size_t got = 0;
+            while (got < entry->size) {
+                ssize_t n = read(fd, &entry->data[got], entry->size - got);
+                if (n <= 0) {
+                    break;
+                }
+                got += n;
+            }
+            if (got != entry->size) {
+                close(fd); // 读的过程中文件被截断，下次请求再试
+                return nullptr;
+            }
+            entry->body = entry->data.data();
+        }
+        close(fd);
+        init(*entry);
+        return insert(key, std::move(deps), entry);
+    }
+
+    /**
+     * @brief 放入一个由调用者生成内容的缓存项。
+     * 调用者需要填好 data（或 body/size）、两个响应头，以及 path/source_size/mtime（无 inotify 时用于校验）。
+     * @return 放入的缓存项；超过单项上限时不缓存，但仍然返回它供本次使用
+     */
+    std::shared_ptr<const Entry> insert(const std::string& key, std::vector<std::string> deps,
+                                        std::shared_ptr<Entry> entry) {
+        if (entry->body == nullptr) {
+            entry->body = entry->data.data();
+            entry->size = entry->data.size();
+        }
+        if (entry->size > max_entry_) {
+            return entry;
+        }
+        entry->key = key;
+        entry->deps = std::move(deps);
+        auto old = index_.find(key);
+        if (old != index_.end()) {
+            erase(old);
+        }
+        entry->watched = true;
+        for (const auto& dep : entry->deps) {
+            entry->watched = watch_dir_of(dep) && entry->watched;
+            deps_.emplace(dep, key);
+        }
+        lru_.push_front(entry);
+        index_[key] = lru_.begin();
+        used_ += entry->size;
+        evict();
+        return entry;
+    }
+
+    /**
+     * @brief inotify 的 fd，调用者把它加入自己的 epoll；不可用时为 -1
+     */
+    int inotify_fd() const { return inotify_fd_; }
+
+    /**
+     * @brief inotify fd 可读时调用：读出所有事件，让被修改的文件对应的缓存项失效
+     */
+    void handle_inotify() {
+        alignas(struct inotify_event) char buf[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+        while (true) {
+            ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+            if (n <= 0) {
+                return;
+            }
+            for (char* p = buf; p < buf + n; ) {
+                struct inotify_event* ev = (struct inotify_event*)p;
+                p += sizeof(struct inotify_event) + ev->len;
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    // 事件队列溢出（wd 为 -1）：不知道丢了哪些文件的事件，全部作废
+                    invalidate_all();
+                    continue;
+                }
+                auto dir = watched_.find(ev->wd);
+                if (dir == watched_.end()) {
+                    continue;
+                }
+                if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    // 目录本身没了，这个目录下的缓存项全部作废
+                    invalidate_dir(dir->second);
+                    if (ev->mask & IN_IGNORED) {
+                        watched_dirs_.erase(dir->second);
+                        watched_.erase(dir);
+                    }
+                    continue;
+                }
+                if (ev->len > 0) {
+                    std::string path = dir->second.empty() ? std::string(ev->name) : dir->second + "/" + ev->name;
+                    invalidate_path(path);
+                }
+            }
+        }
+    }
+
+    size_t entries() const { return index_.size(); }
+    size_t used_bytes() const { return used_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    typedef std::list<std::shared_ptr<Entry>> LruList;
+
+    typedef std::unordered_map<std::string, LruList::iterator> Index;
+
+    static std::string dir_of(const std::string& path) {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? std::string() : path.substr(0, slash);
+    }
+
+    void erase(Index::iterator it) {
+        const Entry& entry = **it->second;
+        for (const auto& dep : entry.deps) {
+            auto range = deps_.equal_range(dep);
+            for (auto d = range.first; d != range.second; ++d) {
+                if (d->second == entry.key) {
+                    deps_.erase(d);
+                    break;
+                }
+            }
+        }
+        used_ -= entry.size;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    void evict() {
+        while (used_ > budget_ && !lru_.empty()) {
+            erase(index_.find(lru_.back()->key));
+        }
+    }
+
+    // 让依赖 path 的所有缓存项以及 path 的元数据失效
+    void invalidate_path(const std::string& path) {
+        meta_.erase(path);
+        std::vector<std::string> keys;
+        auto range = deps_.equal_range(path);
+        for (auto d = range.first; d != range.second; ++d) {
+            keys.push_back(d->second);
+        }
+        for (const auto& key : keys) {
+            auto it = index_.find(key);
+            if (it != index_.end()) {
+                erase(it);
+            }
+        }
+    }
+
+    // 让依赖 dir 目录下任何文件的缓存项失效
+    void invalidate_dir(const std::string& dir) {
+        std::vector<std::string> paths;
+        for (const auto& d : deps_) {
+            if (dir_of(d.first) == dir) {
+                paths.push_back(d.first);
+            }
+        }
+        for (const auto& m : meta_) {
+            if (dir_of(m.first) == dir) {
+                paths.push_back(m.first);
+            }
+        }
+        for (const auto& path : paths) {
+            invalidate_path(path);
+        }
+    }
+
+    // 丢弃所有缓存项和元数据
+    void invalidate_all() {
+        lru_.clear();
+        index_.clear();
+        deps_.clear();
+        meta_.clear();
+        used_ = 0;
+    }
+
+    // 监视 path 所在的目录；返回 false 表示没有监视（inotify 不可用或加监视失败），调用者需要定期 stat
+    bool watch_dir_of(const std::string& path) {
+        if (inotify_fd_ == -1) {
+            return false;
+        }
+        std::string dir = dir_of(path);
+        if (watched_dirs_.count(dir)) {
+            return true;
+        }
+        int wd = inotify_add_watch(inotify_fd_, dir.empty() ? "." : dir.c_str(),
+                                   IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+                                   | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+        if (wd == -1) {
+            return false;
+        }
+        watched_[wd] = dir;
+        watched_dirs_[dir] = wd;
+        return true;
+    }
+
+    size_t budget_;
+    size_t max_entry_;
+    size_t used_ = 0;
+    LruList lru_;                                                // 队首最近使用
+    Index index_;                                                // 键 -> LRU 节点
+    std::unordered_multimap<std::string, std::string> deps_;     // 依赖的文件 -> 缓存键
+    std::unordered_map<std::string, Meta> meta_;                 // 文件路径 -> 元数据
+    int inotify_fd_ = -1;
+    std::unordered_map<int, std::string> watched_;               // inotify wd -> 目录（"" 表示当前目录）
+    std::unordered_map<std::string, int> watched_dirs_;          // 目录 -> wd
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>  // int64_t
+#include <vector>   // std::vector
+
+/**
+ * @brief 简化版 HdrHistogram（高动态范围直方图），用于记录延迟分布并计算百分位。
+ *
+ * 思路与原版 HdrHistogram 相同：数值按 2 的幂分成若干个 bucket，每个 bucket 内再线性划分
+ * sub_bucket，因此在整个范围内（例如 1 ns ~ 1 min）都能保持固定的相对精度（有效数字位数），
+ * 而内存只和 log2(最大值) 成正比。record() 只做几次位运算加一次数组自增，适合在压测热路径上调用。
+ *
+ * 只支持最小可记录值为 1 的情况（单位由调用者决定，例如纳秒或微秒）。非线程安全：
+ * 每个线程各记一个，结束后用 merge() 合并。
+ */
+class HdrHistogram {
+public:
+    /**
+     * @param highest 可记录的最大值，超过的值按最大值记录。
+     * @param significant_figures 有效数字位数（1~5），3 表示相对误差不超过 0.1%。
+     */
+    explicit HdrHistogram(int64_t highest = 60LL * 1000 * 1000 * 1000, int significant_figures = 3)
+        : highest_(highest) {
+        int64_t largest_single_unit = 2;
+        for (int i = 0; i < significant_figures; i++) {
+            largest_single_unit *= 10;
+        }
+        sub_bucket_count_magnitude_ = 0;
+        while ((1LL << sub_bucket_count_magnitude_) < largest_single_unit) {
+            sub_bucket_count_magnitude_++;
+        }
+        sub_bucket_half_count_magnitude_ = sub_bucket_count_magnitude_ - 1;
+        sub_bucket_count_ = 1LL << sub_bucket_count_magnitude_;
+        sub_bucket_half_count_ = sub_bucket_count_ / 2;
+        sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+        // 需要多少个 bucket 才能覆盖到 highest
+        int64_t smallest_untrackable = sub_bucket_count_;
+        int bucket_count = 1;
+        while (smallest_untrackable <= highest_) {
+            if (smallest_untrackable > INT64_MAX / 2) {
+                bucket_count++;
+                break;
+            }
+            smallest_untrackable <<= 1;
+            bucket_count++;
+        }
+        counts_.assign((size_t)(bucket_count + 1) * sub_bucket_half_count_, 0);
+    }
+
+    /**
+     * @brief 记录一个值（小于 1 的按 1 记录，超过 highest 的按 highest 记录）。
+     */
+    void record(int64_t value) {
+        if (value < 1) {
+            value = 1;
+        }
+        if (value > highest_) {
+            value = highest_;
+        }
+        counts_[counts_index_for(value)]++;
+        total_count_++;
+        if (value < min_) {
+            min_ = value;
+        }
+        if (value > max_) {
+            max_ = value;
+        }
+        sum_ += value;
+    }
+
+    /**
+     * @brief 把另一个参数相同的直方图合并进来。
+     */
+    void merge(const HdrHistogram& other) {
+        for (size_t i = 0; i < counts_.size() && i < other.counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+        total_count_ += other.total_count_;
+        sum_ += other.sum_;
+        if (other.min_ < min_) {
+            min_ = other.min_;
+        }
+        if (other.max_ > max_) {
+            max_ = other.max_;
+        }
+    }
+
+    /**
+     * @brief 返回第 percentile 百分位的值（0~100），例如 99.9 表示 p999。
+     * 返回的是所在 sub_bucket 的上界，与原版 HdrHistogram 的 highest_equivalent_value 一致。
+     */
+    int64_t value_at_percentile(double percentile) const {
+        if (total_count_ == 0) {
+            return 0;
+        }
+        if (percentile > 100.0) {
+            percentile = 100.0;
+        }
+        int64_t target = (int64_t)(percentile / 100.0 * total_count_ + 0.5);
+        if (target < 1) {
+            target = 1;
+        }
+        int64_t running = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            running += counts_[i];
+            if (running >= target) {
+                int64_t v = highest_equivalent_value(value_from_index(i));
+                return v < max_ ? v : max_;
+            }
+        }
+        return max_;
+    }
+
+    int64_t count() const { return total_count_; }
+    int64_t min() const { return total_count_ == 0 ? 0 : min_; }
+    int64_t max() const { return max_; }
+    double mean() const { return total_count_ == 0 ? 0.0 : (double)sum_ / total_count_; }
+
+private:
+    int bucket_index_for(int64_t value) const {
+        int pow2ceiling = 64 - __builtin_clzll((uint64_t)(value | sub_bucket_mask_));
+        return pow2ceiling - (sub_bucket_half_count_magnitude_ + 1);
+    }
+
+    size_t counts_index_for(int64_t value) const {
+        int bucket = bucket_index_for(value);
+        int64_t sub_bucket = value >> bucket;
+        return ((size_t)(bucket + 1) << sub_bucket_half_count_magnitude_) + (sub_bucket - sub_bucket_half_count_);
+    }
+
+    int64_t value_from_index(size_t index) const {
+        int bucket = (int)(index >> sub_bucket_half_count_magnitude_) - 1;
+        int64_t sub_bucket = (int64_t)(index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+        if (bucket < 0) {
+            sub_bucket -= sub_bucket_half_count_;
+            bucket = 0;
+        }
+        return sub_bucket << bucket;
+    }
+
+    // 与 value 落在同一个 sub_bucket 里的最大值
+    int64_t highest_equivalent_value(int64_t value) const {
+        int bucket = bucket_index_for(value);
+        return value + (1LL << bucket) - 1;
+    }
+
+    int64_t highest_;
+    int sub_bucket_count_magnitude_;
+    int sub_bucket_half_count_magnitude_;
+    int64_t sub_bucket_count_;
+    int64_t sub_bucket_half_count_;
+    int64_t sub_bucket_mask_;
+    std::vector<int64_t> counts_;
+    int64_t total_count_ = 0;
+    int64_t min_ = INT64_MAX;
+    int64_t max_ = 0;
+    int64_t sum_ = 0;
+};
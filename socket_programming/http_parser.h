@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>      // size_t
+#include <cstring>      // memchr, memmove
+#include <string_view>  // std::string_view，解析结果直接指向读缓冲区，不做拷贝
+#include <vector>       // std::vector
+#include <sys/types.h>  // ssize_t
+#include <sys/socket.h> // recv
+#include <errno.h>      // errno
+
+/**
+ * @brief 每个连接复用的读缓冲区。
+ * [start, end) 是已读入但尚未被消费的数据。消费掉一个请求后，剩余数据（流水线里的下一个请求）
+ * 留在原地；只有尾部空间不够时才把它们挪回开头，缓冲区本身在连接的整个生命周期内只分配一次。
+ */
+class HttpReadBuffer {
+public:
+    explicit HttpReadBuffer(size_t capacity = 16 * 1024) : buf_(capacity) {}
+
+    const char* data() const { return buf_.data() + start_; }
+    size_t size() const { return end_ - start_; }
+    bool full() const { return start_ == 0 && end_ == buf_.size(); }
+
+    /**
+     * @brief 从套接字读一次，尽量填满剩余空间。
+     * @return ssize_t 同 recv：>0 读到的字节数，0 对端关闭，-1 出错（errno 有效）。
+     */
+    ssize_t read_from(int fd) {
+        if (end_ == buf_.size() && start_ > 0) {
+            compact();
+        }
+        ssize_t n = recv(fd, buf_.data() + end_, buf_.size() - end_, 0);
+        if (n > 0) {
+            end_ += n;
+        }
+        return n;
+    }
+
+    /**
+     * @brief 丢弃开头的 n 个字节（一个已处理完的请求）。
+     * 注意：之前解析出的 string_view 会随之失效。
+     */
+    void consume(size_t n) {
+        start_ += n;
+        if (start_ == end_) {
+            start_ = end_ = 0;
+        }
+    }
+
+private:
+    void compact() {
+        memmove(buf_.data(), buf_.data() + start_, end_ - start_);
+        end_ -= start_;
+        start_ = 0;
+    }
+
+    std::vector<char> buf_;
+    size_t start_ = 0;
+    size_t end_ = 0;
+};
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @brief 解析结果。所有 string_view 都指向 HttpReadBuffer 内部，在 consume() 之前有效。
+ */
+struct HttpRequest {
+    static const int MAX_HEADERS = 64;
+
+    std::string_view method;   // "GET"
+    std::string_view target;   // "/index.html?x=1"
+    std::string_view version;  // "HTTP/1.1"
+    HttpHeader headers[MAX_HEADERS];
+    int header_count = 0;
+    size_t header_bytes = 0;   // 请求行 + 请求头 + 空行的总长度，即要 consume 的字节数
+
+    /**
+     * @brief 按名字查找请求头（大小写不敏感），不存在时返回空 string_view。
+     */
+    std::string_view header(std::string_view name) const {
+        for (int i = 0; i < header_count; i++) {
+            if (iequals(headers[i].name, name)) {
+                return headers[i].value;
+            }
+        }
+        return std::string_view();
+    }
+
+    static bool iequals(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            char x = a[i], y = b[i];
+            if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+            if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+            if (x != y) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief 增量式 HTTP/1.x 请求解析器（只解析请求行和请求头，GET 请求没有请求体）。
+ *
+ * 数据可能分多次到达：每次 parse() 只从上次扫描到的位置继续寻找请求头结束标志（空行），
+ * 找到之后再一次性切分请求行和各个请求头，因此不论请求被拆成多少段，总扫描量都是线性的。
+ * 解析完成一个请求后调用 reset()，再解析缓冲区里的下一个请求。
+ */
+class HttpRequestParser {
+public:
+    enum Result {
+        INCOMPLETE, // 数据还不够，需要继续读
+        DONE,       // 解析出一个完整请求
+        BAD         // 格式错误或请求头过大
+    };
+
+    static const size_t MAX_HEADER_BYTES = 8 * 1024;
+
+    /**
+     * @param data 缓冲区中未消费数据的起点（每次调用都应指向同一个请求的开头）
+     * @param len 可用字节数
+     */
+    Result parse(const char* data, size_t len, HttpRequest& req) {
+        // --- 1. 继续寻找空行（"\r\n\r\n"，也接受裸 "\n\n"） ---
+        size_t end = 0;
+        size_t pos = scanned_;
+        while (pos < len) {
+            const char* nl = (const char*)memchr(data + pos, '\n', len - pos);
+            if (nl == nullptr) {
+                pos = len;
+                break;
+            }
+            size_t i = nl - data;
+            // 上一行是否为空：前一个字符也是 '\n'，或者是 "\n\r"
+            if ((i >= 1 && data[i - 1] == '\n') || (i >= 2 && data[i - 1] == '\r' && data[i - 2] == '\n')) {
+                end = i + 1;
+                break;
+            }
+            pos = i + 1;
+        }
+        if (end == 0) {
+            // 回退两个字符，保证跨越两次 read 的 "\r\n\r\n" 也能被识别
+            scanned_ = pos >= 2 ? pos - 2 : 0;
+            return len > MAX_HEADER_BYTES ? BAD : INCOMPLETE;
+        }
+        if (end > MAX_HEADER_BYTES) {
+            return BAD;
+        }
+
+        // --- 2. 请求行：METHOD SP TARGET SP VERSION ---
+        std::string_view block(data, end);
+        size_t line_end = block.find('\n');
+        std::string_view line = trim_cr(block.substr(0, line_end));
+        size_t sp1 = line.find(' ');
+        size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+        if (sp1 == std::string_view::npos || sp2 == std::string_view::npos) {
+            return BAD;
+        }
+        req.method = line.substr(0, sp1);
+        req.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        req.version = line.substr(sp2 + 1);
+        if (req.method.empty() || req.target.empty() || req.version.substr(0, 5) != "HTTP/") {
+            return BAD;
+        }
+
+        // --- 3. 请求头：Name: value ---
+        req.header_count = 0;
+        size_t line_start = line_end + 1;
+        while (line_start < end) {
+            size_t nl = block.find('\n', line_start);
+            std::string_view h = trim_cr(block.substr(line_start, nl - line_start));
+            line_start = nl + 1;
+            if (h.empty()) {
+                break; // 空行，请求头结束
+            }
+            size_t colon = h.find(':');
+            if (colon == std::string_view::npos || colon == 0) {
+                return BAD;
+            }
+            if (req.header_count == HttpRequest::MAX_HEADERS) {
+                return BAD;
+            }
+            std::string_view value = h.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+                value.remove_prefix(1);
+            }
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                value.remove_suffix(1);
+            }
+            req.headers[req.header_count++] = {h.substr(0, colon), value};
+        }
+        req.header_bytes = end;
+        return DONE;
+    }
+
+    /**
+     * @brief 开始解析下一个请求。
+     */
+    void reset() { scanned_ = 0; }
+
+private:
+    static std::string_view trim_cr(std::string_view s) {
+        if (!s.empty() && s.back() == '\r') {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    size_t scanned_ = 0; // 已经确认不含请求头结束标志的前缀长度
+};
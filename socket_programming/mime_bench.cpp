@@ -0,0 +1,151 @@
+#include <cstdlib>                     // 包含 malloc, free
+#include <iostream>                    // 包含标准输入输出流
+#include <iomanip>                     // 包含 std::setw，对齐输出表格
+#include <string>                      // 包含 std::string
+#include <string_view>                 // 包含 std::string_view
+#include <vector>                      // 包含 std::vector
+#include <unordered_map>               // 包含 std::unordered_map，对比常见的哈希表写法
+#include <chrono>                      // 包含计时工具
+#include <new>                         // 包含 std::bad_alloc
+#include "mime_types.h"                // 编译期完美哈希的 MIME 表
+
+// 统计全局 operator new 的调用次数，用来证明查表过程不分配内存
+static size_t alloc_count = 0;
+
+void* operator new(size_t size) {
+    alloc_count++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/**
+ * @brief webserv_get 原来的实现：substr 取扩展名，再逐个比较
+ */
+std::string legacy_content_type(const std::string& file) {
+   size_t dot_pos = file.find_last_of(".");
+   if (dot_pos == std::string::npos || dot_pos == 0) {
+       return "text/plain";
+   }
+
+
+   std::string extension = file.substr(dot_pos);
+   if (extension == ".html" || extension == ".htm") {
+       return "text/html";
+   }
+   else if (extension == ".css") return "text/css";
+   else if (extension == ".js")  return "application/javascript";
+   else if (extension == ".jpg")  return "image/jpeg";
+   else if (extension == ".png")  return "image/png";
+   else {
+       return "text/plain";
+   }
+}
+
+/**
+ * @brief 常见的另一种写法：启动时把表放进 unordered_map<string, string>
+ */
+const std::string& map_content_type(const std::string& file) {
+    static const std::unordered_map<std::string, std::string> table = [] {
+        std::unordered_map<std::string, std::string> m;
+        for (const auto& e : mime_detail::TABLE) {
+            m.emplace(std::string(e.ext), std::string(e.type));
+        }
+        return m;
+    }();
+    static const std::string fallback(MIME_DEFAULT);
+    size_t dot_pos = file.find_last_of(".");
+    if (dot_pos == std::string::npos || dot_pos == 0) {
+        return fallback;
+    }
+    auto it = table.find(file.substr(dot_pos + 1));
+    return it == table.end() ? fallback : it->second;
+}
+
+struct Result {
+    double ns_per_op;
+    double allocs_per_op;
+    size_t sink; // 累加结果长度，防止编译器把调用优化掉
+};
+
+template <typename F>
+Result run(const std::vector<std::string>& names, size_t rounds, F lookup) {
+    size_t sink = 0;
+    for (const auto& name : names) {
+        sink += lookup(name); // 预热（包括 unordered_map 的一次性构造）
+    }
+    size_t allocs_before = alloc_count;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (const auto& name : names) {
+            sink += lookup(name);
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double ops = (double)rounds * names.size();
+    return {secs * 1e9 / ops, (alloc_count - allocs_before) / ops, sink};
+}
+
+/**
+ * @brief 主函数：比较三种 Content-Type 查找方式的耗时（ns/次）和每次调用的内存分配次数。
+ * "legacy" 工作集只包含原实现认识的 5 种扩展名，"mixed" 是一个静态站点常见的扩展名组合。
+ */
+int main(int argc, char** argv) {
+    size_t rounds = 200000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--rounds N]" << std::endl;
+            return 1;
+        }
+    }
+
+    struct Workload {
+        const char* name;
+        std::vector<std::string> files;
+    };
+    const Workload workloads[] = {
+        {"legacy", {"index.html", "about.htm", "static/css/site.css", "static/js/app.js",
+                    "img/photo.jpg", "img/logo.png", "docs/guide.html", "static/js/vendor.js"}},
+        {"mixed", {"index.html", "static/css/site.css", "static/js/app.mjs", "img/hero.webp",
+                   "fonts/inter.woff2", "video/intro.mp4", "icons/logo.svg", "api/data.json",
+                   "favicon.ico", "downloads/release.tar.gz", "Readme.MD", "LICENSE"}},
+    };
+
+    std::cout << std::left << std::setw(10) << "workload" << std::setw(24) << "method"
+              << std::right << std::setw(10) << "ns/op" << std::setw(12) << "allocs/op" << std::endl;
+
+    size_t sink = 0;
+    for (const auto& w : workloads) {
+        struct Method {
+            const char* name;
+            Result result;
+        };
+        const Method methods[] = {
+            {"if-chain (legacy)", run(w.files, rounds, [](const std::string& f) {
+                return legacy_content_type(f).size();
+            })},
+            {"unordered_map", run(w.files, rounds, [](const std::string& f) {
+                return map_content_type(f).size();
+            })},
+            {"perfect hash", run(w.files, rounds, [](const std::string& f) {
+                return mime_type(f).size();
+            })},
+        };
+        for (const auto& m : methods) {
+            sink += m.result.sink;
+            std::cout << std::left << std::setw(10) << w.name << std::setw(24) << m.name
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(10) << m.result.ns_per_op
+                      << std::setprecision(2) << std::setw(12) << m.result.allocs_per_op << std::endl;
+        }
+    }
+    std::cout << "(" << mime_detail::COUNT << " extensions in table, checksum " << sink << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,733 @@
+#pragma once
+
+#include <cstddef>      // size_t
+#include <cstdint>      // uint16_t, uint32_t
+#include <string_view>  // std::string_view，输入输出都不分配内存
+
+/**
+ * @brief 按扩展名查 MIME 类型（Content-Type）。
+ *
+ * 表在编译期生成一个完美哈希（hash-and-displace）：扩展名先哈希到一个桶，每个桶有一个
+ * 编译期找出的位移种子，用它再哈希一次就落到一个没有冲突的槽。查询只需两次哈希和一次比较，
+ * 不分配内存，不做字符串拼接；返回值指向静态字符串，可以一直持有。
+ *
+ * 扩展名大小写不敏感；未知扩展名返回 MIME_DEFAULT。
+ */
+
+inline constexpr std::string_view MIME_DEFAULT = "application/octet-stream";
+
+namespace mime_detail {
+
+struct MimeEntry {
+    std::string_view ext;   // 小写，不带 '.'
+    std::string_view type;
+};
+
+inline constexpr MimeEntry TABLE[] = {
+    // 文本
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"shtml", "text/html"},
+    {"xhtml", "application/xhtml+xml"},
+    {"xht", "application/xhtml+xml"},
+    {"css", "text/css"},
+    {"js", "text/javascript"},
+    {"mjs", "text/javascript"},
+    {"cjs", "text/javascript"},
+    {"jsx", "text/javascript"},
+    {"txt", "text/plain"},
+    {"text", "text/plain"},
+    {"log", "text/plain"},
+    {"conf", "text/plain"},
+    {"cfg", "text/plain"},
+    {"ini", "text/plain"},
+    {"def", "text/plain"},
+    {"list", "text/plain"},
+    {"in", "text/plain"},
+    {"srt", "text/plain"},
+    {"csv", "text/csv"},
+    {"tsv", "text/tab-separated-values"},
+    {"md", "text/markdown"},
+    {"markdown", "text/markdown"},
+    {"mdx", "text/markdown"},
+    {"rst", "text/x-rst"},
+    {"rtx", "text/richtext"},
+    {"ics", "text/calendar"},
+    {"ifb", "text/calendar"},
+    {"vcf", "text/vcard"},
+    {"vcard", "text/vcard"},
+    {"vtt", "text/vtt"},
+    {"uri", "text/uri-list"},
+    {"uris", "text/uri-list"},
+    {"appcache", "text/cache-manifest"},
+    {"manifest", "text/cache-manifest"},
+    {"sgml", "text/sgml"},
+    {"sgm", "text/sgml"},
+    {"n3", "text/n3"},
+    {"ttl", "text/turtle"},
+    {"jad", "text/vnd.sun.j2me.app-descriptor"},
+    {"wml", "text/vnd.wml"},
+    {"wmls", "text/vnd.wap.wmlscript"},
+    {"htc", "text/x-component"},
+    {"etx", "text/x-setext"},
+    {"t", "text/troff"},
+    {"tr", "text/troff"},
+    {"roff", "text/troff"},
+    {"man", "text/troff"},
+    {"me", "text/troff"},
+    {"ms", "text/troff"},
+    {"gv", "text/vnd.graphviz"},
+    {"yaml", "text/yaml"},
+    {"yml", "text/yaml"},
+    {"toml", "text/x-toml"},
+
+    // 源代码
+    {"c", "text/x-c"},
+    {"h", "text/x-c"},
+    {"cc", "text/x-c++src"},
+    {"cpp", "text/x-c++src"},
+    {"cxx", "text/x-c++src"},
+    {"hh", "text/x-c++hdr"},
+    {"hpp", "text/x-c++hdr"},
+    {"hxx", "text/x-c++hdr"},
+    {"ipp", "text/x-c++hdr"},
+    {"inl", "text/x-c++hdr"},
+    {"cu", "text/x-cuda"},
+    {"m", "text/x-objcsrc"},
+    {"mm", "text/x-objc++src"},
+    {"cs", "text/x-csharp"},
+    {"java", "text/x-java"},
+    {"kt", "text/x-kotlin"},
+    {"kts", "text/x-kotlin"},
+    {"scala", "text/x-scala"},
+    {"groovy", "text/x-groovy"},
+    {"gradle", "text/x-groovy"},
+    {"go", "text/x-go"},
+    {"rs", "text/x-rust"},
+    {"swift", "text/x-swift"},
+    {"d", "text/x-d"},
+    {"f", "text/x-fortran"},
+    {"f77", "text/x-fortran"},
+    {"f90", "text/x-fortran"},
+    {"for", "text/x-fortran"},
+    {"pas", "text/x-pascal"},
+    {"p", "text/x-pascal"},
+    {"asm", "text/x-asm"},
+    {"s", "text/x-asm"},
+    {"py", "text/x-python"},
+    {"pyi", "text/x-python"},
+    {"pl", "text/x-perl"},
+    {"pm", "text/x-perl"},
+    {"rb", "text/x-ruby"},
+    {"php", "text/x-php"},
+    {"lua", "text/x-lua"},
+    {"tcl", "text/x-tcl"},
+    {"tk", "text/x-tcl"},
+    {"hs", "text/x-haskell"},
+    {"lhs", "text/x-literate-haskell"},
+    {"ml", "text/x-ocaml"},
+    {"mli", "text/x-ocaml"},
+    {"erl", "text/x-erlang"},
+    {"hrl", "text/x-erlang"},
+    {"ex", "text/x-elixir"},
+    {"exs", "text/x-elixir"},
+    {"clj", "text/x-clojure"},
+    {"cljs", "text/x-clojure"},
+    {"lisp", "text/x-common-lisp"},
+    {"el", "text/x-emacs-lisp"},
+    {"scm", "text/x-scheme"},
+    {"r", "text/x-r"},
+    {"jl", "text/x-julia"},
+    {"dart", "text/x-dart"},
+    {"nim", "text/x-nim"},
+    {"zig", "text/x-zig"},
+    {"v", "text/x-verilog"},
+    {"sv", "text/x-systemverilog"},
+    {"vhd", "text/x-vhdl"},
+    {"vhdl", "text/x-vhdl"},
+    {"sql", "application/sql"},
+    {"tsx", "text/x-typescript"},
+    {"cts", "text/x-typescript"},
+    {"vue", "text/x-vue"},
+    {"svelte", "text/x-svelte"},
+    {"coffee", "text/x-coffeescript"},
+    {"scss", "text/x-scss"},
+    {"sass", "text/x-sass"},
+    {"less", "text/x-less"},
+    {"styl", "text/x-stylus"},
+    {"diff", "text/x-diff"},
+    {"patch", "text/x-diff"},
+    {"cmake", "text/x-cmake"},
+    {"mk", "text/x-makefile"},
+    {"proto", "text/x-protobuf"},
+    {"glsl", "text/x-glsl"},
+    {"wgsl", "text/wgsl"},
+    {"bib", "text/x-bibtex"},
+    {"tex", "application/x-tex"},
+    {"ltx", "application/x-tex"},
+    {"sty", "application/x-tex"},
+    {"cls", "application/x-tex"},
+    {"latex", "application/x-latex"},
+    {"texi", "application/x-texinfo"},
+    {"texinfo", "application/x-texinfo"},
+    {"bat", "application/x-msdos-batch"},
+    {"cmd", "application/x-msdos-batch"},
+    {"ps1", "text/x-powershell"},
+    {"sh", "application/x-sh"},
+    {"bash", "application/x-sh"},
+    {"zsh", "application/x-sh"},
+    {"csh", "application/x-csh"},
+
+    // 结构化数据
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"jsonld", "application/ld+json"},
+    {"geojson", "application/geo+json"},
+    {"topojson", "application/json"},
+    {"webmanifest", "application/manifest+json"},
+    {"har", "application/json"},
+    {"ndjson", "application/x-ndjson"},
+    {"jsonl", "application/x-ndjson"},
+    {"xml", "application/xml"},
+    {"xsd", "application/xml"},
+    {"xsl", "application/xslt+xml"},
+    {"xslt", "application/xslt+xml"},
+    {"dtd", "application/xml-dtd"},
+    {"rss", "application/rss+xml"},
+    {"atom", "application/atom+xml"},
+    {"rdf", "application/rdf+xml"},
+    {"owl", "application/rdf+xml"},
+    {"kml", "application/vnd.google-earth.kml+xml"},
+    {"kmz", "application/vnd.google-earth.kmz"},
+    {"gpx", "application/gpx+xml"},
+    {"gml", "application/gml+xml"},
+    {"mathml", "application/mathml+xml"},
+    {"mml", "application/mathml+xml"},
+    {"smil", "application/smil+xml"},
+    {"smi", "application/smil+xml"},
+    {"wsdl", "application/wsdl+xml"},
+    {"xspf", "application/xspf+xml"},
+    {"xliff", "application/xliff+xml"},
+    {"xlf", "application/xliff+xml"},
+    {"opml", "text/x-opml"},
+    {"plist", "application/x-plist"},
+    {"cbor", "application/cbor"},
+    {"msgpack", "application/msgpack"},
+    {"pb", "application/x-protobuf"},
+    {"avro", "application/avro"},
+    {"parquet", "application/vnd.apache.parquet"},
+    {"arrow", "application/vnd.apache.arrow.file"},
+    {"sqlite", "application/vnd.sqlite3"},
+    {"db", "application/vnd.sqlite3"},
+
+    // 图片
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"jpe", "image/jpeg"},
+    {"jfif", "image/jpeg"},
+    {"pjpeg", "image/jpeg"},
+    {"pjp", "image/jpeg"},
+    {"png", "image/png"},
+    {"apng", "image/apng"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"avifs", "image/avif-sequence"},
+    {"heic", "image/heic"},
+    {"heics", "image/heic-sequence"},
+    {"heif", "image/heif"},
+    {"heifs", "image/heif-sequence"},
+    {"jxl", "image/jxl"},
+    {"jp2", "image/jp2"},
+    {"j2k", "image/jp2"},
+    {"jpf", "image/jpx"},
+    {"jpx", "image/jpx"},
+    {"jpm", "image/jpm"},
+    {"jxr", "image/jxr"},
+    {"wdp", "image/vnd.ms-photo"},
+    {"hdp", "image/vnd.ms-photo"},
+    {"bmp", "image/bmp"},
+    {"dib", "image/bmp"},
+    {"ico", "image/x-icon"},
+    {"cur", "image/x-icon"},
+    {"icns", "image/icns"},
+    {"svg", "image/svg+xml"},
+    {"svgz", "image/svg+xml"},
+    {"tif", "image/tiff"},
+    {"tiff", "image/tiff"},
+    {"psd", "image/vnd.adobe.photoshop"},
+    {"xcf", "image/x-xcf"},
+    {"dds", "image/vnd.ms-dds"},
+    {"ktx", "image/ktx"},
+    {"ktx2", "image/ktx2"},
+    {"exr", "image/x-exr"},
+    {"hdr", "image/vnd.radiance"},
+    {"tga", "image/x-tga"},
+    {"pcx", "image/vnd.zbrush.pcx"},
+    {"pbm", "image/x-portable-bitmap"},
+    {"pgm", "image/x-portable-graymap"},
+    {"ppm", "image/x-portable-pixmap"},
+    {"pnm", "image/x-portable-anymap"},
+    {"pam", "image/x-portable-arbitrarymap"},
+    {"xbm", "image/x-xbitmap"},
+    {"xpm", "image/x-xpixmap"},
+    {"xwd", "image/x-xwindowdump"},
+    {"rgb", "image/x-rgb"},
+    {"ras", "image/x-cmu-raster"},
+    {"wbmp", "image/vnd.wap.wbmp"},
+    {"djvu", "image/vnd.djvu"},
+    {"djv", "image/vnd.djvu"},
+    {"emf", "image/emf"},
+    {"wmf", "image/wmf"},
+    {"cgm", "image/cgm"},
+    {"ief", "image/ief"},
+    {"dwg", "image/vnd.dwg"},
+    {"dxf", "image/vnd.dxf"},
+    {"fits", "image/fits"},
+    {"fit", "image/fits"},
+    {"dng", "image/x-adobe-dng"},
+    {"cr2", "image/x-canon-cr2"},
+    {"crw", "image/x-canon-crw"},
+    {"nef", "image/x-nikon-nef"},
+    {"orf", "image/x-olympus-orf"},
+    {"arw", "image/x-sony-arw"},
+    {"raf", "image/x-fuji-raf"},
+    {"rw2", "image/x-panasonic-rw2"},
+    {"dcm", "application/dicom"},
+
+    // 音频
+    {"mp3", "audio/mpeg"},
+    {"mpga", "audio/mpeg"},
+    {"mp2", "audio/mpeg"},
+    {"m4a", "audio/mp4"},
+    {"m4b", "audio/mp4"},
+    {"m4p", "audio/mp4"},
+    {"aac", "audio/aac"},
+    {"adts", "audio/aac"},
+    {"ogg", "audio/ogg"},
+    {"oga", "audio/ogg"},
+    {"opus", "audio/ogg"},
+    {"spx", "audio/ogg"},
+    {"weba", "audio/webm"},
+    {"flac", "audio/flac"},
+    {"wav", "audio/wav"},
+    {"wave", "audio/wav"},
+    {"aif", "audio/aiff"},
+    {"aiff", "audio/aiff"},
+    {"aifc", "audio/aiff"},
+    {"au", "audio/basic"},
+    {"snd", "audio/basic"},
+    {"mid", "audio/midi"},
+    {"midi", "audio/midi"},
+    {"kar", "audio/midi"},
+    {"rmi", "audio/midi"},
+    {"amr", "audio/amr"},
+    {"awb", "audio/amr-wb"},
+    {"ac3", "audio/ac3"},
+    {"eac3", "audio/eac3"},
+    {"dts", "audio/vnd.dts"},
+    {"mka", "audio/x-matroska"},
+    {"wma", "audio/x-ms-wma"},
+    {"wax", "audio/x-ms-wax"},
+    {"ra", "audio/x-realaudio"},
+    {"ram", "audio/x-pn-realaudio"},
+    {"m3u", "audio/x-mpegurl"},
+    {"pls", "audio/x-scpls"},
+    {"gsm", "audio/x-gsm"},
+    {"caf", "audio/x-caf"},
+    {"ape", "audio/x-ape"},
+    {"wv", "audio/x-wavpack"},
+    {"mod", "audio/x-mod"},
+    {"xm", "audio/x-xm"},
+    {"s3m", "audio/s3m"},
+    {"it", "audio/x-it"},
+
+    // 视频
+    {"mp4", "video/mp4"},
+    {"m4v", "video/mp4"},
+    {"mp4v", "video/mp4"},
+    {"mpg4", "video/mp4"},
+    {"f4v", "video/mp4"},
+    {"mpeg", "video/mpeg"},
+    {"mpg", "video/mpeg"},
+    {"mpe", "video/mpeg"},
+    {"m1v", "video/mpeg"},
+    {"m2v", "video/mpeg"},
+    {"webm", "video/webm"},
+    {"ogv", "video/ogg"},
+    {"mov", "video/quicktime"},
+    {"qt", "video/quicktime"},
+    {"avi", "video/x-msvideo"},
+    {"wmv", "video/x-ms-wmv"},
+    {"wm", "video/x-ms-wm"},
+    {"wmx", "video/x-ms-wmx"},
+    {"wvx", "video/x-ms-wvx"},
+    {"asf", "video/x-ms-asf"},
+    {"asx", "video/x-ms-asf"},
+    {"mkv", "video/x-matroska"},
+    {"mk3d", "video/x-matroska"},
+    {"flv", "video/x-flv"},
+    {"3gp", "video/3gpp"},
+    {"3gpp", "video/3gpp"},
+    {"3g2", "video/3gpp2"},
+    {"3gpp2", "video/3gpp2"},
+    {"m2ts", "video/mp2t"},
+    {"mts", "video/mp2t"},
+    {"ts", "video/mp2t"},
+    {"m4s", "video/iso.segment"},
+    {"m3u8", "application/vnd.apple.mpegurl"},
+    {"mpd", "application/dash+xml"},
+    {"mxu", "video/vnd.mpegurl"},
+    {"dv", "video/dv"},
+    {"dif", "video/dv"},
+    {"fli", "video/fli"},
+    {"mng", "video/x-mng"},
+    {"movie", "video/x-sgi-movie"},
+    {"mj2", "video/mj2"},
+    {"mjp2", "video/mj2"},
+    {"h261", "video/h261"},
+    {"h263", "video/h263"},
+    {"h264", "video/h264"},
+    {"h265", "video/h265"},
+    {"y4m", "video/x-yuv4mpeg"},
+    {"ivf", "video/x-ivf"},
+
+    // 字体
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"ttc", "font/collection"},
+    {"eot", "application/vnd.ms-fontobject"},
+    {"pfb", "application/x-font-type1"},
+    {"pfa", "application/x-font-type1"},
+    {"afm", "application/x-font-afm"},
+    {"bdf", "application/x-font-bdf"},
+    {"pcf", "application/x-font-pcf"},
+
+    // 文档
+    {"pdf", "application/pdf"},
+    {"ps", "application/postscript"},
+    {"eps", "application/postscript"},
+    {"ai", "application/postscript"},
+    {"rtf", "application/rtf"},
+    {"epub", "application/epub+zip"},
+    {"mobi", "application/x-mobipocket-ebook"},
+    {"azw", "application/vnd.amazon.ebook"},
+    {"azw3", "application/vnd.amazon.ebook"},
+    {"fb2", "application/x-fictionbook+xml"},
+    {"cbz", "application/vnd.comicbook+zip"},
+    {"cbr", "application/vnd.comicbook-rar"},
+    {"chm", "application/vnd.ms-htmlhelp"},
+    {"oxps", "application/oxps"},
+    {"xps", "application/vnd.ms-xpsdocument"},
+    {"doc", "application/msword"},
+    {"dot", "application/msword"},
+    {"docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+    {"dotx", "application/vnd.openxmlformats-officedocument.wordprocessingml.template"},
+    {"docm", "application/vnd.ms-word.document.macroenabled.12"},
+    {"xls", "application/vnd.ms-excel"},
+    {"xlt", "application/vnd.ms-excel"},
+    {"xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+    {"xltx", "application/vnd.openxmlformats-officedocument.spreadsheetml.template"},
+    {"xlsm", "application/vnd.ms-excel.sheet.macroenabled.12"},
+    {"xlsb", "application/vnd.ms-excel.sheet.binary.macroenabled.12"},
+    {"ppt", "application/vnd.ms-powerpoint"},
+    {"pps", "application/vnd.ms-powerpoint"},
+    {"pot", "application/vnd.ms-powerpoint"},
+    {"pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+    {"ppsx", "application/vnd.openxmlformats-officedocument.presentationml.slideshow"},
+    {"potx", "application/vnd.openxmlformats-officedocument.presentationml.template"},
+    {"pptm", "application/vnd.ms-powerpoint.presentation.macroenabled.12"},
+    {"vsd", "application/vnd.visio"},
+    {"vsdx", "application/vnd.ms-visio.drawing"},
+    {"mpp", "application/vnd.ms-project"},
+    {"one", "application/onenote"},
+    {"pub", "application/x-mspublisher"},
+    {"mdb", "application/x-msaccess"},
+    {"accdb", "application/x-msaccess"},
+    {"odt", "application/vnd.oasis.opendocument.text"},
+    {"ott", "application/vnd.oasis.opendocument.text-template"},
+    {"ods", "application/vnd.oasis.opendocument.spreadsheet"},
+    {"ots", "application/vnd.oasis.opendocument.spreadsheet-template"},
+    {"odp", "application/vnd.oasis.opendocument.presentation"},
+    {"otp", "application/vnd.oasis.opendocument.presentation-template"},
+    {"odg", "application/vnd.oasis.opendocument.graphics"},
+    {"otg", "application/vnd.oasis.opendocument.graphics-template"},
+    {"odc", "application/vnd.oasis.opendocument.chart"},
+    {"odf", "application/vnd.oasis.opendocument.formula"},
+    {"odb", "application/vnd.oasis.opendocument.database"},
+    {"odm", "application/vnd.oasis.opendocument.text-master"},
+    {"key", "application/vnd.apple.keynote"},
+    {"pages", "application/vnd.apple.pages"},
+    {"numbers", "application/vnd.apple.numbers"},
+    {"abw", "application/x-abiword"},
+    {"dvi", "application/x-dvi"},
+    {"ipynb", "application/x-ipynb+json"},
+
+    // 压缩包与归档
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"tgz", "application/gzip"},
+    {"bz2", "application/x-bzip2"},
+    {"tbz2", "application/x-bzip2"},
+    {"bz", "application/x-bzip"},
+    {"xz", "application/x-xz"},
+    {"txz", "application/x-xz"},
+    {"lz", "application/x-lzip"},
+    {"lzma", "application/x-lzma"},
+    {"lz4", "application/x-lz4"},
+    {"zst", "application/zstd"},
+    {"br", "application/x-brotli"},
+    {"z", "application/x-compress"},
+    {"tar", "application/x-tar"},
+    {"cpio", "application/x-cpio"},
+    {"shar", "application/x-shar"},
+    {"7z", "application/x-7z-compressed"},
+    {"rar", "application/vnd.rar"},
+    {"arj", "application/x-arj"},
+    {"lzh", "application/x-lzh-compressed"},
+    {"lha", "application/x-lzh-compressed"},
+    {"cab", "application/vnd.ms-cab-compressed"},
+    {"ace", "application/x-ace-compressed"},
+    {"xar", "application/x-xar"},
+    {"sit", "application/x-stuffit"},
+    {"sitx", "application/x-stuffitx"},
+    {"hqx", "application/mac-binhex40"},
+    {"cpt", "application/mac-compactpro"},
+
+    // 程序、安装包和磁盘镜像
+    {"bin", "application/octet-stream"},
+    {"exe", "application/vnd.microsoft.portable-executable"},
+    {"dll", "application/vnd.microsoft.portable-executable"},
+    {"msi", "application/x-msi"},
+    {"msp", "application/octet-stream"},
+    {"msu", "application/octet-stream"},
+    {"so", "application/octet-stream"},
+    {"o", "application/octet-stream"},
+    {"a", "application/octet-stream"},
+    {"lib", "application/octet-stream"},
+    {"class", "application/java-vm"},
+    {"jar", "application/java-archive"},
+    {"war", "application/java-archive"},
+    {"ear", "application/java-archive"},
+    {"ser", "application/java-serialized-object"},
+    {"wasm", "application/wasm"},
+    {"pyc", "application/x-python-code"},
+    {"elf", "application/x-elf"},
+    {"apk", "application/vnd.android.package-archive"},
+    {"aab", "application/vnd.android.aab"},
+    {"ipa", "application/octet-stream"},
+    {"xap", "application/x-silverlight-app"},
+    {"appx", "application/appx"},
+    {"msix", "application/msix"},
+    {"deb", "application/vnd.debian.binary-package"},
+    {"udeb", "application/vnd.debian.binary-package"},
+    {"rpm", "application/x-rpm"},
+    {"snap", "application/vnd.snap"},
+    {"flatpak", "application/vnd.flatpak"},
+    {"appimage", "application/vnd.appimage"},
+    {"dmg", "application/x-apple-diskimage"},
+    {"pkg", "application/octet-stream"},
+    {"iso", "application/x-iso9660-image"},
+    {"img", "application/octet-stream"},
+    {"vhdx", "application/x-vhdx"},
+    {"vmdk", "application/x-vmdk"},
+    {"qcow2", "application/x-qemu-disk"},
+    {"ova", "application/x-virtualbox-ova"},
+    {"crx", "application/x-chrome-extension"},
+    {"xpi", "application/x-xpinstall"},
+    {"swf", "application/x-shockwave-flash"},
+    {"torrent", "application/x-bittorrent"},
+
+    // 证书与密钥
+    {"pem", "application/x-pem-file"},
+    {"crt", "application/x-x509-ca-cert"},
+    {"der", "application/x-x509-ca-cert"},
+    {"cer", "application/pkix-cert"},
+    {"crl", "application/pkix-crl"},
+    {"p7b", "application/x-pkcs7-certificates"},
+    {"spc", "application/x-pkcs7-certificates"},
+    {"p7c", "application/pkcs7-mime"},
+    {"p7m", "application/pkcs7-mime"},
+    {"p7s", "application/pkcs7-signature"},
+    {"p8", "application/pkcs8"},
+    {"p10", "application/pkcs10"},
+    {"p12", "application/x-pkcs12"},
+    {"pfx", "application/x-pkcs12"},
+    {"csr", "application/pkcs10"},
+    {"asc", "application/pgp-signature"},
+    {"sig", "application/pgp-signature"},
+    {"pgp", "application/pgp-encrypted"},
+    {"gpg", "application/pgp-encrypted"},
+
+    // 三维模型
+    {"gltf", "model/gltf+json"},
+    {"glb", "model/gltf-binary"},
+    {"obj", "model/obj"},
+    {"stl", "model/stl"},
+    {"3mf", "model/3mf"},
+    {"ply", "model/x-ply"},
+    {"fbx", "application/octet-stream"},
+    {"dae", "model/vnd.collada+xml"},
+    {"usdz", "model/vnd.usdz+zip"},
+    {"wrl", "model/vrml"},
+    {"vrml", "model/vrml"},
+    {"x3d", "model/x3d+xml"},
+    {"igs", "model/iges"},
+    {"iges", "model/iges"},
+    {"step", "model/step"},
+    {"stp", "model/step"},
+
+    // 其他
+    {"eml", "message/rfc822"},
+    {"mht", "message/rfc822"},
+    {"mhtml", "message/rfc822"},
+    {"mbox", "application/mbox"},
+    {"msg", "application/vnd.ms-outlook"},
+    {"vsix", "application/vsix"},
+    {"unitypackage", "application/octet-stream"},
+    {"blend", "application/x-blender"},
+    {"sketch", "application/octet-stream"},
+    {"fig", "application/octet-stream"},
+    {"sav", "application/x-spss-sav"},
+    {"dta", "application/x-stata-dta"},
+    {"mat", "application/x-matlab-data"},
+    {"nc", "application/x-netcdf"},
+    {"h5", "application/x-hdf5"},
+    {"hdf5", "application/x-hdf5"},
+    {"npy", "application/octet-stream"},
+    {"npz", "application/zip"},
+    {"pkl", "application/octet-stream"},
+    {"onnx", "application/octet-stream"},
+    {"pt", "application/octet-stream"},
+    {"safetensors", "application/octet-stream"},
+};
+
+constexpr size_t COUNT = sizeof(TABLE) / sizeof(TABLE[0]);
+constexpr size_t MAX_EXT = 16;     // 更长的扩展名一定不在表里
+constexpr size_t BUCKETS = 256;    // 第一级哈希的桶数
+constexpr size_t SLOTS = 1024;     // 第二级哈希的槽数（2 的幂），装载率约一半，位移种子很快就能找到
+constexpr size_t MAX_BUCKET = 16;  // 一个桶最多容纳的扩展名个数
+static_assert(COUNT < SLOTS * 3 / 4, "MIME 表太大，需要增大 SLOTS");
+static_assert(COUNT < 0xFFFF, "槽里用 uint16_t 存下标");
+
+/**
+ * @brief FNV-1a，加上种子和最后的混合，不同种子得到近似独立的哈希
+ */
+constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char c : s) {
+        h ^= (unsigned char)c;
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+struct PerfectHash {
+    uint16_t disp[BUCKETS] = {};  // 每个桶的位移种子
+    uint16_t slot[SLOTS] = {};    // 槽 -> TABLE 下标 + 1，0 表示空槽
+    bool ok = false;
+};
+
+/**
+ * @brief 编译期构造完美哈希：按桶的大小从大到小，为每个桶找一个让它所有的键都落进空槽的种子
+ */
+constexpr PerfectHash build() {
+    PerfectHash ph;
+    size_t members[BUCKETS][MAX_BUCKET] = {};
+    size_t sizes[BUCKETS] = {};
+    for (size_t i = 0; i < COUNT; i++) {
+        size_t b = hash(TABLE[i].ext, 0) % BUCKETS;
+        if (sizes[b] == MAX_BUCKET) {
+            return ph;
+        }
+        members[b][sizes[b]++] = i;
+    }
+
+    bool done[BUCKETS] = {};
+    for (size_t round = 0; round < BUCKETS; round++) {
+        // 选出剩下的桶里最大的一个
+        size_t b = BUCKETS;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            if (!done[i] && (b == BUCKETS || sizes[i] > sizes[b])) {
+                b = i;
+            }
+        }
+        done[b] = true;
+        if (sizes[b] == 0) {
+            break; // 剩下的都是空桶
+        }
+
+        bool placed = false;
+        for (uint32_t d = 0; d < 0xFFFF && !placed; d++) {
+            size_t slots[MAX_BUCKET] = {};
+            placed = true;
+            for (size_t k = 0; k < sizes[b] && placed; k++) {
+                slots[k] = hash(TABLE[members[b][k]].ext, d + 1) % SLOTS;
+                if (ph.slot[slots[k]] != 0) {
+                    placed = false;
+                }
+                for (size_t j = 0; j < k; j++) {
+                    if (slots[j] == slots[k]) {
+                        placed = false; // 同一个桶里的两个键撞在一起（也可能是表里有重复的扩展名）
+                    }
+                }
+            }
+            if (placed) {
+                ph.disp[b] = (uint16_t)d;
+                for (size_t k = 0; k < sizes[b]; k++) {
+                    ph.slot[slots[k]] = (uint16_t)(members[b][k] + 1);
+                }
+            }
+        }
+        if (!placed) {
+            return ph;
+        }
+    }
+    ph.ok = true;
+    return ph;
+}
+
+inline constexpr PerfectHash PH = build();
+static_assert(PH.ok, "无法为 MIME 表构造完美哈希（是否有重复的扩展名？）");
+
+} // namespace mime_detail
+
+/**
+ * @brief 按扩展名（不带 '.'，大小写不敏感）查 MIME 类型，未知时返回 MIME_DEFAULT
+ */
+constexpr std::string_view mime_type_for_extension(std::string_view ext) {
+    using namespace mime_detail;
+    if (ext.empty() || ext.size() > MAX_EXT) {
+        return MIME_DEFAULT;
+    }
+    char lower[MAX_EXT] = {};
+    for (size_t i = 0; i < ext.size(); i++) {
+        char c = ext[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+    std::string_view key(lower, ext.size());
+    uint32_t d = PH.disp[hash(key, 0) % BUCKETS];
+    uint16_t idx = PH.slot[hash(key, d + 1) % SLOTS];
+    if (idx == 0 || TABLE[idx - 1].ext != key) {
+        return MIME_DEFAULT;
+    }
+    return TABLE[idx - 1].type;
+}
+
+/**
+ * @brief 按文件路径的扩展名查 MIME 类型。"a/b.tar.gz" 取 "gz"；没有扩展名（包括 ".bashrc" 这种隐藏文件）时返回 MIME_DEFAULT
+ */
+constexpr std::string_view mime_type(std::string_view path) {
+    size_t slash = path.find_last_of('/');
+    std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string_view::npos || dot == 0) {
+        return MIME_DEFAULT;
+    }
+    return mime_type_for_extension(name.substr(dot + 1));
+}
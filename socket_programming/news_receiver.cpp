@@ -10,7 +10,7 @@
 #include <unistd.h>
 
 
-const int BUF_SIZE = 30;
+const int BUF_SIZE = 65536;   // 能装下任何 UDP 数据报；发布模式的一个数据报里有多行消息
 void error_handling(std::string message) {
     std::cout << message << std::endl;
     exit(1);
@@ -49,12 +49,12 @@ int main(int argc, char* argv[]) {
                 (void*)&join_adr, sizeof(join_adr));
 
     while(1) { 
-        str_len = recvfrom(recv_sock, buf, BUF_SIZE, 0, NULL, NULL);
+        str_len = recvfrom(recv_sock, buf, BUF_SIZE - 1, 0, NULL, NULL);
         if(str_len < 0) {
             break;
         }
         buf[str_len] = 0;
-        std::cout << buf << std::endl;
+        std::cout << buf;
     }
     close(recv_sock);
     return 0;
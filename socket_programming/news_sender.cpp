@@ -2,31 +2,342 @@
 #include <cstdio>
 #include <cstring>
 #include <iostream>
-#include <arpa/inet.h>
+#include <iomanip>                     // 包含 std::setprecision，格式化统计结果
+#include <string>
+#include <vector>
+#include <algorithm>                   // 包含 std::min / std::max
+#include <chrono>                      // 包含计时工具，令牌桶按时间补充令牌
+#include <thread>                      // 包含 std::this_thread::sleep_for
 #include <sys/socket.h>
-#include <cstring>
+#include <sys/mman.h>                  // 包含 mmap，把输入文件映射进内存
+#include <sys/stat.h>                  // 包含 fstat，取文件大小
+#include <sys/resource.h>              // 包含 getrusage，统计发送端 CPU 时间
+#include <sys/uio.h>                   // 包含 struct iovec
+#include <poll.h>                      // 包含 poll，发送缓冲区满时等待可写
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <cstdlib>
 #include <unistd.h>
 
 const int TTL = 64;
-const int BUF_SIZE = 30;
+const int BUF_SIZE = 1024;             // 逐行模式下一行的最大长度，更长的行分成几次发送
+const int IP_UDP_HEADER_BYTES = 28;    // IPv4 头 20 字节 + UDP 头 8 字节
+const size_t MAX_DATAGRAM = 65507;     // 一个 UDP 数据报最多能装的字节数
 void error_handling(std::string message) {
     std::cout << message << std::endl;
     exit(1);
 }
 
+/**
+ * @brief 发布模式的参数，全部来自命令行
+ */
+struct PublishOptions {
+    std::string file = "hello.txt";
+    int mtu = 1500;                    // 数据报（含 IP / UDP 头）不超过 MTU，避免 IP 分片
+    int batch = 64;                    // 每次 sendmmsg 最多发多少个数据报
+    bool pack = true;                  // false: 每个数据报只装一条消息
+    double rate_msgs = 0;              // 目标速率（消息 / 秒），0 表示不限
+    double rate_mbps = 0;              // 目标速率（Mbit/s，按 UDP 载荷计），0 表示不限
+    long loops = 1;                    // 文件发送几遍，0 表示一直发
+};
+
+/**
+ * @brief 一个数据报：文件里连续的若干行。数据直接指向映射的文件，发送时不需要拷贝
+ */
+struct Datagram {
+    size_t offset;
+    size_t len;
+    uint32_t messages;
+};
+
+/**
+ * @brief 把文件按行切成消息，再把连续的消息装进不超过 payload 字节的数据报。
+ * 每条消息保留结尾的换行符，接收端按换行拆开；超过 payload 的单行单独占一个数据报（最多 MAX_DATAGRAM 字节）
+ */
+std::vector<Datagram> pack_datagrams(const char* data, size_t size, size_t payload, bool pack) {
+    std::vector<Datagram> out;
+    size_t pos = 0;
+    while (pos < size) {
+        const char* nl = (const char*)memchr(data + pos, '\n', size - pos);
+        size_t end = nl ? nl - data + 1 : size;
+        if (end - pos > MAX_DATAGRAM) {
+            end = pos + MAX_DATAGRAM;
+        }
+        if (pack && !out.empty() && out.back().offset + out.back().len == pos
+            && out.back().len + (end - pos) <= payload) {
+            out.back().len += end - pos;
+            out.back().messages++;
+        } else {
+            out.push_back({pos, end - pos, 1});
+        }
+        pos = end;
+    }
+    return out;
+}
+
+/**
+ * @brief 令牌桶：按 rate（每秒令牌数）持续补充，最多攒 burst 个，开始时是空的（不会一上来先突发一整桶）。
+ * 发送前用 take() 取令牌，不够时 wait() 睡到够为止；rate 为 0 时不限速
+ */
+class TokenBucket {
+public:
+    TokenBucket(double rate, double burst)
+        : rate_(rate), burst_(burst), tokens_(0), last_(std::chrono::steady_clock::now()) {}
+
+    bool unlimited() const { return rate_ <= 0; }
+
+    /**
+     * @brief 令牌够 n 个时扣除并返回 true
+     */
+    bool take(double n) {
+        if (unlimited()) {
+            return true;
+        }
+        refill();
+        if (tokens_ < n) {
+            return false;
+        }
+        tokens_ -= n;
+        return true;
+    }
+
+    /**
+     * @brief 睡到攒够 n 个令牌（n 超过 burst 时按 burst 算，否则永远等不到）
+     */
+    void wait(double n) {
+        refill();
+        double need = (n < burst_ ? n : burst_) - tokens_;
+        if (need > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(need / rate_));
+        }
+    }
+
+private:
+    void refill() {
+        auto now = std::chrono::steady_clock::now();
+        tokens_ += std::chrono::duration<double>(now - last_).count() * rate_;
+        if (tokens_ > burst_) {
+            tokens_ = burst_;
+        }
+        last_ = now;
+    }
+
+    double rate_;
+    double burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+/**
+ * @brief 原来的逐行模式：每行一次 sendto，间隔 2 秒
+ */
+int run_lines(int send_sock, const struct sockaddr_in& mul_adr) {
+    FILE* fp;
+    char message[BUF_SIZE];
+    if ((fp = fopen("hello.txt", "r")) == NULL) {
+        error_handling("fopen() error");
+    }
+
+    // fgets 读到文件末尾时返回 NULL；原来的 while(!feof(fp)) 在最后一行之后还会再进一次循环，
+    // 那次 fgets 失败、message 保留上一行的内容，最后一行就被发了两遍
+    while (fgets(message, BUF_SIZE, fp) != NULL) {
+        sendto(send_sock, message, strlen(message), 0,
+                (struct sockaddr*)&mul_adr, sizeof(mul_adr));
+        sleep(2);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief 发布模式：文件 mmap 进内存、消息装进 MTU 大小的数据报、sendmmsg 一次发一批、令牌桶控制速率。
+ * 每个数据报的 iovec 直接指向映射的文件，整个过程不拷贝消息内容；套接字 connect 到组播地址，
+ * 内核不必为每个数据报解析目的地址
+ */
+int run_publish(int send_sock, const PublishOptions& opt) {
+    int fd = open(opt.file.c_str(), O_RDONLY);
+    if (fd == -1) {
+        error_handling("open() error");
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        error_handling("empty input file");
+    }
+    size_t size = st.st_size;
+    const char* data = (const char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        error_handling("mmap() error");
+    }
+    close(fd);
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+
+    size_t payload = opt.mtu - IP_UDP_HEADER_BYTES;
+    std::vector<Datagram> grams = pack_datagrams(data, size, payload, opt.pack);
+    uint64_t file_messages = 0;
+    for (const Datagram& g : grams) {
+        file_messages += g.messages;
+    }
+    std::cout << "Publishing " << opt.file << ": " << file_messages << " messages in " << grams.size()
+              << " datagrams (payload <= " << payload << " bytes), batch " << opt.batch;
+    if (opt.rate_msgs > 0) {
+        std::cout << ", rate " << opt.rate_msgs << " msgs/s";
+    } else if (opt.rate_mbps > 0) {
+        std::cout << ", rate " << opt.rate_mbps << " Mbit/s";
+    }
+    std::cout << std::endl;
+
+    // 令牌按消息数或比特数计。桶的容量最多是两批（睡过头攒下的令牌不浪费），同时不超过 10 ms 的配额，
+    // 低速率时突发仍然很小；但至少能装下一个最大的数据报，否则它永远发不出去。
+    // 容量不够一整批时，每次只发令牌够的那几个数据报
+    bool by_bits = opt.rate_msgs <= 0 && opt.rate_mbps > 0;
+    auto cost = [&](const Datagram& g) { return by_bits ? (double)g.len * 8 : (double)g.messages; };
+    double max_cost = 0;
+    for (const Datagram& g : grams) {
+        max_cost = cost(g) > max_cost ? cost(g) : max_cost;
+    }
+    double rate = by_bits ? opt.rate_mbps * 1e6 : opt.rate_msgs;
+    double burst = std::min(max_cost * opt.batch * 2, std::max(max_cost, rate * 0.01));
+    TokenBucket bucket(rate, burst);
+
+    std::vector<struct mmsghdr> msgs(opt.batch);
+    std::vector<struct iovec> iovs(opt.batch);
+    memset(msgs.data(), 0, sizeof(struct mmsghdr) * msgs.size());
+    for (int i = 0; i < opt.batch; i++) {
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    uint64_t messages = 0, datagrams = 0, bytes = 0, calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long loop = 0; opt.loops == 0 || loop < opt.loops; loop++) {
+        size_t next = 0;
+        while (next < grams.size()) {
+            // 限速时先睡到够发一整批（或桶的容量），再取令牌凑成一批
+            if (!bucket.unlimited()) {
+                double want = 0;
+                for (size_t i = next; i < grams.size() && i < next + opt.batch; i++) {
+                    want += cost(grams[i]);
+                }
+                bucket.wait(want);
+            }
+            int n = 0;
+            while (n < opt.batch && next + n < grams.size() && bucket.take(cost(grams[next + n]))) {
+                const Datagram& g = grams[next + n];
+                iovs[n].iov_base = (void*)(data + g.offset);
+                iovs[n].iov_len = g.len;
+                n++;
+            }
+            if (n == 0) {
+                continue; // 睡眠时间不够精确，令牌还差一点
+            }
+            int sent = 0;
+            while (sent < n) {
+                int r = sendmmsg(send_sock, msgs.data() + sent, n - sent, 0);
+                if (r == -1) {
+                    // 已连接的 UDP 套接字会报告之前的数据报引起的 ICMP 错误（单播时没有接收端），
+                    // 这次的数据报并没有发出，错误已被取走，重试即可
+                    if (errno == EINTR || errno == ECONNREFUSED) {
+                        continue;
+                    }
+                    // 发送缓冲区满：等到可写再试；网卡队列满（ENOBUFS）时 poll 会立刻返回，只能睡一小会儿。
+                    // 直接重试会让发送端空转占满一个 CPU
+                    if (errno == EAGAIN) {
+                        struct pollfd pfd = {send_sock, POLLOUT, 0};
+                        poll(&pfd, 1, 10);
+                        continue;
+                    }
+                    if (errno == ENOBUFS) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                        continue;
+                    }
+                    error_handling("sendmmsg() error");
+                }
+                sent += r;
+                calls++;
+            }
+            for (int i = 0; i < n; i++) {
+                messages += grams[next + i].messages;
+                bytes += grams[next + i].len;
+            }
+            datagrams += n;
+            next += n;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    munmap((void*)data, size);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Sent:        " << messages << " messages, " << datagrams << " datagrams, "
+              << calls << " sendmmsg calls in " << elapsed << " s" << std::endl;
+    std::cout << "Rate:        " << messages / elapsed << " msgs/s, " << datagrams / elapsed << " datagrams/s, "
+              << std::setprecision(2) << bytes * 8 / elapsed / 1e6 << " Mbit/s" << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << "CPU:         " << cpu << " s (" << (messages ? cpu * 1e9 / messages : 0) << " ns/msg)" << std::endl;
+    return 0;
+}
+
+void print_usage() {
+    std::cout << "Usage : <group_address> <port> [--publish [options]]\n"
+              << "  --file F          input file, one message per line (default hello.txt)\n"
+              << "  --mtu N           datagram size limit incl. IP/UDP headers (default 1500)\n"
+              << "  --batch N         datagrams per sendmmsg call (default 64)\n"
+              << "  --no-pack         one message per datagram\n"
+              << "  --rate-msgs N     target rate in messages/s\n"
+              << "  --rate-mbps N     target rate in Mbit/s of UDP payload\n"
+              << "  --loops N         send the file N times, 0 = forever (default 1)" << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief 主函数：向组播地址发送 hello.txt 的内容。
+ * 不带参数时是原来的逐行模式（每行一次 sendto，间隔 2 秒）；--publish 是高速发布模式，见 run_publish
+ */
 int main(int argc, char* argv[]) {
-    
+
     int send_sock;
     struct sockaddr_in mul_adr;
     int time_live = TTL;
-    FILE* fp;
-    char message[BUF_SIZE];
 
-
-    if (argc != 3) {
-        std::cout << "Usage : <group_address> <port>" << std::endl;
-        exit(1);
+    if (argc < 3) {
+        print_usage();
+    }
+    bool publish = false;
+    PublishOptions opt;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--publish") {
+            publish = true;
+            continue;
+        } else if (arg == "--no-pack") {
+            opt.pack = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage();
+        }
+        std::string val = argv[++i];
+        if (arg == "--file") {
+            opt.file = val;
+        } else if (arg == "--mtu") {
+            opt.mtu = std::stoi(val);
+        } else if (arg == "--batch") {
+            opt.batch = std::stoi(val);
+        } else if (arg == "--rate-msgs") {
+            opt.rate_msgs = std::stod(val);
+        } else if (arg == "--rate-mbps") {
+            opt.rate_mbps = std::stod(val);
+        } else if (arg == "--loops") {
+            opt.loops = std::stol(val);
+        } else {
+            print_usage();
+        }
+    }
+    if (opt.mtu <= IP_UDP_HEADER_BYTES || opt.batch <= 0 || opt.loops < 0) {
+        print_usage();
     }
 
     send_sock  = socket(PF_INET, SOCK_DGRAM, 0);
@@ -38,22 +349,20 @@ int main(int argc, char* argv[]) {
     mul_adr.sin_family = AF_INET;
     mul_adr.sin_addr.s_addr = inet_addr(argv[1]);
     mul_adr.sin_port = htons(atoi(argv[2]));
-    
-    setsockopt(send_sock, IPPROTO_IP, IP_MULTICAST_TTL, 
+
+    setsockopt(send_sock, IPPROTO_IP, IP_MULTICAST_TTL,
                 (void*)&time_live, sizeof(time_live));
-    
-    if ((fp = fopen("hello.txt", "r")) == NULL) {
-        error_handling("fopen() error");
-    }
 
-    while(!feof(fp)) {
-        fgets(message, BUF_SIZE, fp);
-        sendto(send_sock, message, strlen(message), 0,
-                (struct sockaddr*)&mul_adr, sizeof(mul_adr));
-        sleep(2);
+    int ret;
+    if (publish) {
+        if (connect(send_sock, (struct sockaddr*)&mul_adr, sizeof(mul_adr)) == -1) {
+            error_handling("connect() error");
+        }
+        ret = run_publish(send_sock, opt);
+    } else {
+        ret = run_lines(send_sock, mul_adr);
     }
-    fclose(fp);
     close(send_sock);
-    return 0;
+    return ret;
 
 }
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>        // size_t
+#include <cstdint>        // uint64_t
+#include <cstring>        // memcpy, memcmp
+#include <list>           // std::list，LRU 链表
+#include <string>         // std::string
+#include <unordered_map>  // 哈希值 -> LRU 节点
+#include <vector>         // std::vector
+#include "op_protocol.h"  // OpResult
+
+/**
+ * @brief XXH64：一次处理 32 字节、四路独立累加，比 std::hash<std::string> 快得多，
+ * 用来给大请求的操作数计算缓存键
+ */
+inline uint64_t op_hash_bytes(const unsigned char* p, size_t len, uint64_t seed) {
+    const uint64_t P1 = 0x9E3779B185EBCA87ULL, P2 = 0xC2B2AE3D27D4EB4FULL, P3 = 0x165667B19E3779F9ULL;
+    const uint64_t P4 = 0x85EBCA77C2B2AE63ULL, P5 = 0x27D4EB2F165667C5ULL;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto read64 = [](const unsigned char* q) { uint64_t v; memcpy(&v, q, 8); return v; };
+    auto round = [&](uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; };
+    auto merge = [&](uint64_t acc, uint64_t v) { return (acc ^ round(0, v)) * P1 + P4; };
+
+    const unsigned char* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + P5;
+    }
+    h += len;
+    for (; end - p >= 8; p += 8) {
+        h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+    }
+    if (end - p >= 4) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        h = rotl(h ^ (v * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h = rotl(h ^ (*p * P5), 11) * P1;
+    }
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * @brief op_server 的结果缓存（LRU）：同样的（运算符，类型，操作数）再来时直接返回上次的结果。
+ *
+ * 键是操作数的 XXH64 哈希（运算符、类型、个数混进种子），索引只存 64 位哈希值；
+ * 缓存项里保留操作数的副本，命中时逐字节比较，哈希碰撞不会返回错误的结果（碰撞按未命中处理，新项替换旧项）。
+ * 值是一组结果：普通请求一个，表达式请求每行一个；结果里的 id 由调用者改写。
+ * 总大小（操作数副本 + 结果）受内存预算限制，超出时淘汰最久未使用的项；单项超过预算的 1/4 不缓存。
+ * 非线程安全。
+ */
+class OpResultCache {
+public:
+    explicit OpResultCache(size_t budget_bytes) : budget_(budget_bytes) {}
+
+    /**
+     * @brief 查找缓存，命中时移到 LRU 队首
+     * @param hash 输出键的哈希值，未命中时传给 insert，避免再算一遍
+     * @return const std::vector<OpResult>* 未命中时返回 nullptr
+     */
+    const std::vector<OpResult>* find(char op, uint8_t type, const unsigned char* operands, size_t bytes, uint64_t& hash) {
+        hash = op_hash_bytes(operands, bytes, seed(op, type));
+        auto it = index_.find(hash);
+        if (it == index_.end() || !matches(*it->second, op, type, operands, bytes)) {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return &it->second->results;
+    }
+
+    /**
+     * @brief 放入一项（hash 来自同一个键上一次 find 的输出）
+     */
+    void insert(uint64_t hash, char op, uint8_t type, const unsigned char* operands, size_t bytes,
+                const OpResult* results, size_t count) {
+        size_t size = entry_size(bytes, count);
+        if (size > budget_ / 4) {
+            return;
+        }
+        auto it = index_.find(hash);
+        if (it != index_.end()) {
+            erase(it); // 哈希碰撞或重复插入：新的替换旧的
+        }
+        lru_.emplace_front();
+        Entry& e = lru_.front();
+        e.hash = hash;
+        e.op = op;
+        e.type = type;
+        e.operands.assign((const char*)operands, bytes);
+        e.results.assign(results, results + count);
+        index_[hash] = lru_.begin();
+        used_ += size;
+        while (used_ > budget_ && !lru_.empty()) {
+            erase(index_.find(lru_.back().hash));
+            evictions_++;
+        }
+    }
+
+    size_t entries() const { return index_.size(); }
+    size_t used_bytes() const { return used_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t evictions() const { return evictions_; }
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        char op = 0;
+        uint8_t type = 0;
+        std::string operands;         // 操作数的副本，命中时比较
+        std::vector<OpResult> results;
+    };
+    typedef std::list<Entry> LruList;
+    typedef std::unordered_map<uint64_t, LruList::iterator> Index;
+
+    static uint64_t seed(char op, uint8_t type) {
+        return ((uint64_t)(unsigned char)op << 8) | type;
+    }
+
+    static size_t entry_size(size_t bytes, size_t count) {
+        return bytes + count * sizeof(OpResult) + sizeof(Entry) + 64; // 64：链表和索引节点的大致开销
+    }
+
+    static bool matches(const Entry& e, char op, uint8_t type, const unsigned char* operands, size_t bytes) {
+        return e.op == op && e.type == type && e.operands.size() == bytes
+            && memcmp(e.operands.data(), operands, bytes) == 0;
+    }
+
+    void erase(Index::iterator it) {
+        used_ -= entry_size(it->second->operands.size(), it->second->results.size());
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    size_t budget_;
+    size_t used_ = 0;
+    LruList lru_;   // 队首最近使用
+    Index index_;   // 哈希值 -> LRU 节点
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
@@ -1,24 +1,729 @@
+#include <cmath>
 #include <cstring>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <arpa/inet.h>
+#include "op_protocol.h"   // 批量二进制帧协议
+#include "op_kernels.h"    // --verify 时在本地算出期望结果
+#include "hdr_histogram.h" // 压测模式的延迟直方图
 
 void error_handling(std::string message) {
     std::cout << message << std::endl;
     exit(1);
 }
+
+/**
+ * @brief 打印一个结果
+ */
+void print_result(const OpResult& r) {
+    if (r.status == OP_OK) {
+        std::cout << "Result from server: " << r.value << std::endl;
+    } else {
+        std::cout << "Error from server: " << op_status_name(r.status) << std::endl;
+    }
+}
+
+/**
+ * @brief 解析一行里的操作数，按 T 的格式读入
+ * @return bool 整行都是合法的操作数时返回 true
+ */
+template <typename T>
+bool parse_operands(std::istringstream& ss, std::vector<T>& out) {
+    out.clear();
+    T v;
+    while (ss >> v) {
+        out.push_back(v);
+    }
+    return ss.eof();
+}
+
+/**
+ * @brief 把一个结果格式化成文本
+ */
+std::string format_result(const OpResult& r) {
+    if (r.status != OP_OK) {
+        return op_status_name(r.status);
+    }
+    std::ostringstream os;
+    if (r.type == OP_FLOAT64) {
+        os << r.as_double();
+    } else {
+        os << r.value;
+    }
+    return os.str();
+}
+
+/**
+ * @brief 解析表达式行的其余部分 "<表达式> | <第一行的值> | <第二行的值> ..."，例如 "(a+b)*c | 1 2 3 | 4 5 6"，
+ * 每行的值个数相同
+ */
+bool add_expr_line(OpBatch& batch, const std::string& rest, uint8_t type) {
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    while (true) {
+        size_t bar = rest.find('|', pos);
+        parts.push_back(rest.substr(pos, bar == std::string::npos ? std::string::npos : bar - pos));
+        if (bar == std::string::npos) {
+            break;
+        }
+        pos = bar + 1;
+    }
+    if (parts.size() < 2) {
+        return false;
+    }
+    std::vector<char> data;
+    size_t vars = 0;
+    std::vector<int32_t> i32;
+    std::vector<int64_t> i64;
+    std::vector<double> f64;
+    for (size_t i = 1; i < parts.size(); i++) {
+        std::istringstream ss(parts[i]);
+        bool ok = type == OP_INT32 ? parse_operands(ss, i32)
+                : type == OP_INT64 ? parse_operands(ss, i64) : parse_operands(ss, f64);
+        size_t n = type == OP_INT32 ? i32.size() : type == OP_INT64 ? i64.size() : f64.size();
+        if (!ok || n > 255 || (i > 1 && n != vars)) {
+            return false;
+        }
+        vars = n;
+        const char* p = type == OP_INT32 ? (const char*)i32.data()
+                      : type == OP_INT64 ? (const char*)i64.data() : (const char*)f64.data();
+        data.insert(data.end(), p, p + n * op_type_size(type));
+    }
+    std::string expr = parts[0];
+    expr.erase(0, expr.find_first_not_of(" \t"));
+    expr.erase(expr.find_last_not_of(" \t") + 1);
+    batch.add_expr(expr, type, (uint8_t)vars, data.data(), (uint32_t)(parts.size() - 1));
+    return true;
+}
+
+/**
+ * @brief 批处理模式：从标准输入读入所有请求，打包成一个帧一次发出，一个往返取回全部结果。
+ * 每行一个请求："<运算符> <操作数>..."（例如 "+ 1 2 3"），或者表达式 "e <表达式> | <值>... | <值>..."
+ * @param type 操作数类型，所有请求相同
+ * @param stats 最后附带查询服务端结果缓存的计数器
+ */
+int run_batch(int sock, uint8_t type, bool stats) {
+    OpBatch batch;
+    std::vector<std::string> lines;
+    std::vector<uint32_t> ids;
+    std::vector<int32_t> i32;
+    std::vector<int64_t> i64;
+    std::vector<double> f64;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream ss(line);
+        std::string op;
+        if (!(ss >> op)) {
+            continue; // 空行
+        }
+        uint32_t id = 0;
+        if (op.size() == 1 && op[0] == OP_EXPR) {
+            std::string rest;
+            std::getline(ss, rest);
+            uint32_t next = batch.size();
+            if (!add_expr_line(batch, rest, type)) {
+                std::cout << "Invalid line: " << line << std::endl;
+                continue;
+            }
+            id = next + 1; // OpBatch 的 id 从 1 开始连续分配
+        } else {
+            bool ok = type == OP_INT32 ? parse_operands(ss, i32)
+                    : type == OP_INT64 ? parse_operands(ss, i64) : parse_operands(ss, f64);
+            if (op.size() != 1 || !ok) {
+                std::cout << "Invalid line: " << line << std::endl;
+                continue;
+            }
+            if (type == OP_INT32) {
+                id = batch.add(op[0], i32.data(), (uint32_t)i32.size());
+            } else if (type == OP_INT64) {
+                id = batch.add(op[0], i64.data(), (uint32_t)i64.size());
+            } else {
+                id = batch.add(op[0], f64.data(), (uint32_t)f64.size());
+            }
+        }
+        lines.push_back(line);
+        ids.push_back(id);
+    }
+    const char* stat_names[] = {"hits", "misses", "evictions", "entries", "bytes"};
+    if (stats) {
+        for (int i = 0; i < 5; i++) {
+            ids.push_back(batch.add_stat((OpStat)i));
+            lines.push_back(std::string("cache ") + stat_names[i]);
+        }
+    }
+    if (batch.size() == 0) {
+        return 0;
+    }
+    std::vector<OpResult> results;
+    if (!batch.execute(sock, results)) {
+        error_handling("batch request failed");
+    }
+    // 结果按请求顺序排列，表达式请求有多个结果（id 相同）
+    size_t next = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        std::cout << lines[i] << " => ";
+        bool first = true;
+        while (next < results.size() && results[next].id == ids[i]) {
+            std::cout << (first ? "" : ", ") << format_result(results[next++]);
+            first = false;
+        }
+        std::cout << std::endl;
+    }
+    if (next != results.size()) {
+        error_handling("unexpected results from server");
+    }
+    return 0;
+}
+
+/**
+ * @brief 压测模式（--load）的参数
+ */
+struct LoadOptions {
+    int conns = 16;           // 总连接数
+    int threads = 1;          // 发压线程数，连接平均分到各线程
+    int window = 32;          // 每个连接最多多少个在途请求
+    int frame = 1;            // 每个帧最多装几个请求
+    int operands = 16;        // 每个请求的操作数个数；operands_max > operands 时在区间内随机
+    int operands_max = 16;
+    std::string ops = "+-*/<>";
+    uint8_t type = OP_INT32;
+    int pool = 4096;          // 每个线程预先生成的随机请求个数，发送时从中随机挑选
+    bool verify = false;      // 在本地算出期望结果并与响应比较
+    double duration = 10;     // 统计时长（秒）
+    double warmup = 1;        // 预热时长（秒），这段时间内的数据不计入结果
+};
+
+LoadOptions load_opt;
+std::atomic<bool> load_stop(false);
+std::atomic<bool> load_measuring(false);
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 预先生成的一个随机请求。expected 只在 --verify 时计算
+ */
+struct LoadRequest {
+    char op = '+';
+    uint32_t count = 0;
+    std::vector<char> operands;
+    OpResult expected;
+};
+
+/**
+ * @brief 一个压测连接。请求按 id 记在 inflight 里，响应到达时按 id 找到发送时间和对应的请求，
+ * 不依赖响应的顺序
+ */
+struct LoadConn {
+    int fd = -1;
+    bool connected = false;
+    bool want_write = false;       // 当前是否在 epoll 中注册了 EPOLLOUT
+    uint32_t next_id = 1;
+    std::vector<char> out;         // 待发送的帧
+    size_t out_off = 0;            // out 中已发送的字节数
+    std::vector<char> in;          // 收到但还没解析完的字节
+    size_t in_end = 0;
+    struct InFlight {
+        int64_t start_ns;          // 请求放进发送缓冲区的时间
+        uint32_t request;          // 在请求池中的下标
+    };
+    std::unordered_map<uint32_t, InFlight> inflight;
+};
+
+/**
+ * @brief 每个发压线程的统计结果，线程结束后由主线程汇总
+ */
+struct LoadStats {
+    HdrHistogram latency;          // 请求延迟（纳秒）
+    int64_t requests = 0;          // 统计期内完成的请求数
+    int64_t frames = 0;            // 统计期内收到的响应帧数
+    int64_t not_ok = 0;            // 状态不是 OP_OK 的结果（溢出、除数为 0 等）
+    int64_t mismatches = 0;        // --verify：与本地计算的结果不一致
+    int64_t unknown_ids = 0;       // 响应的 id 不在在途请求中
+    int64_t connect_errors = 0;
+    int64_t io_errors = 0;
+};
+
+/**
+ * @brief 生成请求池：运算符从 ops 中随机选，整数在 [-1000, 1000]，浮点数在 [-1, 1]
+ */
+std::vector<LoadRequest> make_request_pool(std::mt19937_64& rng) {
+    std::vector<LoadRequest> pool(load_opt.pool);
+    std::uniform_int_distribution<int> count_dist(load_opt.operands, load_opt.operands_max);
+    std::uniform_int_distribution<int> int_dist(-1000, 1000);
+    std::uniform_real_distribution<double> real_dist(-1, 1);
+    const OpKernels& reference = op_kernels_scalar();
+    for (auto& r : pool) {
+        r.op = load_opt.ops[rng() % load_opt.ops.size()];
+        r.count = (uint32_t)count_dist(rng);
+        r.operands.resize(r.count * op_type_size(load_opt.type));
+        for (uint32_t i = 0; i < r.count; i++) {
+            char* p = r.operands.data() + i * op_type_size(load_opt.type);
+            if (load_opt.type == OP_INT32) {
+                int32_t v = int_dist(rng);
+                memcpy(p, &v, 4);
+            } else if (load_opt.type == OP_INT64) {
+                int64_t v = int_dist(rng);
+                memcpy(p, &v, 8);
+            } else {
+                double v = real_dist(rng);
+                memcpy(p, &v, 8);
+            }
+        }
+        if (load_opt.verify) {
+            r.expected = op_evaluate(reference, r.op, load_opt.type, (const unsigned char*)r.operands.data(), r.count);
+        }
+    }
+    return pool;
+}
+
+/**
+ * @brief 响应与期望结果是否一致。浮点数的求和顺序与服务端的 SIMD 实现不同，允许很小的误差
+ */
+bool result_matches(const OpResult& got, const OpResult& want, uint32_t count) {
+    if (got.status != want.status) {
+        return false;
+    }
+    if (got.status != OP_OK) {
+        return true;
+    }
+    if (want.type != OP_FLOAT64) {
+        return got.value == want.value;
+    }
+    double a = got.as_double(), b = want.as_double();
+    if (a == b || (std::isnan(a) && std::isnan(b))) {
+        return true; // 包括两边都是同号的无穷大
+    }
+    return std::fabs(a - b) <= 1e-9 * (std::fabs(a) + std::fabs(b) + count);
+}
+
+void load_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+void load_update_interest(int epoll_fd, LoadConn& c, bool want_write) {
+    if (want_write == c.want_write) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (want_write ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.ptr = &c;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.want_write = want_write;
+}
+
+/**
+ * @brief 把窗口补满（每个帧最多 frame 个请求），再尽量多地写出发送缓冲区
+ * @return bool 连接仍然可用返回 true
+ */
+bool load_pump_send(int epoll_fd, LoadConn& c, const std::vector<LoadRequest>& pool,
+                    OpFrameBuilder& builder, std::mt19937_64& rng) {
+    if (!load_stop.load(std::memory_order_relaxed)) {
+        int64_t t = now_ns();
+        while ((int)c.inflight.size() < load_opt.window) {
+            int room = load_opt.window - (int)c.inflight.size();
+            int n = room < load_opt.frame ? room : load_opt.frame;
+            builder.start(OP_KIND_REQUEST);
+            for (int i = 0; i < n; i++) {
+                uint32_t index = (uint32_t)(rng() % pool.size());
+                const LoadRequest& r = pool[index];
+                uint32_t id = c.next_id++;
+                builder.add_request(id, r.op, load_opt.type, r.operands.data(), r.count);
+                c.inflight[id] = {t, index};
+            }
+            const std::vector<char>& frame = builder.finish();
+            c.out.insert(c.out.end(), frame.begin(), frame.end());
+        }
+    }
+    while (c.out_off < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out_off += n;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            load_update_interest(epoll_fd, c, true);
+            return true;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    c.out.clear();
+    c.out_off = 0;
+    load_update_interest(epoll_fd, c, false);
+    return true;
+}
+
+/**
+ * @brief 读出所有可读的数据，逐个解析完整的响应帧，按 id 匹配在途请求
+ * @return bool 连接仍然可用返回 true
+ */
+bool load_receive(LoadConn& c, const std::vector<LoadRequest>& pool, LoadStats* stats) {
+    while (true) {
+        if (c.in_end == c.in.size()) {
+            c.in.resize(c.in.size() * 2);
+        }
+        ssize_t n = recv(c.fd, c.in.data() + c.in_end, c.in.size() - c.in_end, 0);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        c.in_end += n;
+    }
+
+    bool counting = load_measuring.load(std::memory_order_relaxed);
+    int64_t t = now_ns();
+    size_t off = 0;
+    OpFrameHeader h;
+    size_t frame_bytes = 0;
+    while (true) {
+        int r = op_peek_frame(c.in.data() + off, c.in_end - off, h, frame_bytes);
+        if (r == -1 || (r == 1 && (h.kind != OP_KIND_RESPONSE
+                                   || h.payload_bytes != (size_t)h.count * OP_RESPONSE_BYTES))) {
+            return false;
+        }
+        if (r == 0) {
+            break;
+        }
+        const unsigned char* p = (const unsigned char*)c.in.data() + off + OP_FRAME_HEADER_BYTES;
+        for (uint32_t i = 0; i < h.count; i++, p += OP_RESPONSE_BYTES) {
+            OpResult res;
+            memcpy(&res.id, p, 4);
+            res.status = p[4];
+            res.type = p[5];
+            memcpy(&res.value, p + 8, 8);
+            auto it = c.inflight.find(res.id);
+            if (it == c.inflight.end()) {
+                stats->unknown_ids++;
+                continue;
+            }
+            if (counting) {
+                stats->latency.record(t - it->second.start_ns);
+                stats->requests++;
+                stats->not_ok += res.status != OP_OK;
+                if (load_opt.verify) {
+                    const LoadRequest& req = pool[it->second.request];
+                    stats->mismatches += !result_matches(res, req.expected, req.count);
+                }
+            }
+            c.inflight.erase(it);
+        }
+        stats->frames += counting;
+        off += frame_bytes;
+    }
+    if (off > 0) {
+        memmove(c.in.data(), c.in.data() + off, c.in_end - off);
+        c.in_end -= off;
+    }
+    if (frame_bytes > c.in.size()) {
+        c.in.resize(frame_bytes); // 一个响应帧比缓冲区还大（frame 很大时）
+    }
+    return true;
+}
+
+/**
+ * @brief 发压线程：用一个 epoll 驱动分配给自己的全部连接
+ */
+void load_thread(const std::string& ip, int port, int conn_count, unsigned seed, LoadStats* stats) {
+    std::mt19937_64 rng(seed);
+    std::vector<LoadRequest> pool = make_request_pool(rng);
+    OpFrameBuilder builder;
+
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        error_handling("epoll_create1() error");
+    }
+
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_addr.s_addr = inet_addr(ip.c_str());
+    serv_addr.sin_port = htons(port);
+
+    // --- 1. 发起全部非阻塞 connect ---
+    std::vector<LoadConn> conns(conn_count);
+    for (auto& c : conns) {
+        c.fd = socket(PF_INET, SOCK_STREAM, 0);
+        if (c.fd == -1) {
+            error_handling("socket() error (raise ulimit -n?)");
+        }
+        c.in.resize(64 * 1024);
+        load_set_nonblocking(c.fd);
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(c.fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1 && errno != EINPROGRESS) {
+            stats->connect_errors++;
+            close(c.fd);
+            c.fd = -1;
+            continue;
+        }
+        // 连接建立完成时套接字变为可写
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.ptr = &c;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c.fd, &ev);
+        c.want_write = true;
+    }
+
+    auto drop = [&](LoadConn& c) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, NULL);
+        close(c.fd);
+        c.fd = -1;
+    };
+
+    // --- 2. 事件循环 ---
+    const int MAX_EVENTS = 1024;
+    std::vector<struct epoll_event> events(MAX_EVENTS);
+    while (!load_stop.load(std::memory_order_relaxed)) {
+        int nfds = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, 100);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling("epoll_wait() error");
+        }
+        for (int i = 0; i < nfds; i++) {
+            LoadConn& c = *(LoadConn*)events[i].data.ptr;
+            if (c.fd == -1) {
+                continue;
+            }
+            uint32_t revents = events[i].events;
+
+            if (!c.connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0 || (revents & (EPOLLERR | EPOLLHUP))) {
+                    stats->connect_errors++;
+                    drop(c);
+                    continue;
+                }
+                c.connected = true;
+            }
+
+            if ((revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !load_receive(c, pool, stats)) {
+                stats->io_errors++;
+                drop(c);
+                continue;
+            }
+            if (!load_pump_send(epoll_fd, c, pool, builder, rng)) {
+                stats->io_errors++;
+                drop(c);
+            }
+        }
+    }
+
+    for (auto& c : conns) {
+        if (c.fd != -1) {
+            close(c.fd);
+        }
+    }
+    close(epoll_fd);
+}
+
+/**
+ * @brief 压测模式：多个连接、每个连接保持 window 个在途请求，随机生成请求，
+ * 统计期结束后输出每秒请求数和延迟的各个百分位
+ */
+int run_load(const std::string& ip, int port) {
+    // 上千个连接很容易超过默认的 1024 个 fd 限制，尽量提高到硬上限
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if (load_opt.threads > load_opt.conns) {
+        load_opt.threads = load_opt.conns;
+    }
+    const char* type_name = load_opt.type == OP_INT32 ? "i32" : load_opt.type == OP_INT64 ? "i64" : "f64";
+    std::cout << "Loading " << ip << ":" << port << " with " << load_opt.conns << " connections on "
+              << load_opt.threads << " thread(s), window " << load_opt.window << ", " << load_opt.frame
+              << " request(s) per frame, " << load_opt.operands;
+    if (load_opt.operands_max != load_opt.operands) {
+        std::cout << "-" << load_opt.operands_max;
+    }
+    std::cout << " " << type_name << " operands, ops \"" << load_opt.ops << "\"" << std::endl;
+
+    std::vector<LoadStats> stats(load_opt.threads);
+    std::vector<std::thread> workers;
+    std::random_device rd;
+    for (int t = 0; t < load_opt.threads; t++) {
+        int count = load_opt.conns / load_opt.threads + (t < load_opt.conns % load_opt.threads ? 1 : 0);
+        workers.emplace_back(load_thread, ip, port, count, rd(), &stats[t]);
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(load_opt.warmup));
+    load_measuring = true;
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(load_opt.duration));
+    load_measuring = false;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    load_stop = true;
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    // --- 汇总结果 ---
+    LoadStats total;
+    for (auto& s : stats) {
+        total.latency.merge(s.latency);
+        total.requests += s.requests;
+        total.frames += s.frames;
+        total.not_ok += s.not_ok;
+        total.mismatches += s.mismatches;
+        total.unknown_ids += s.unknown_ids;
+        total.connect_errors += s.connect_errors;
+        total.io_errors += s.io_errors;
+    }
+
+    const HdrHistogram& lat = total.latency;
+    auto us = [](int64_t ns) { return ns / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Duration:    " << elapsed << " s" << std::endl;
+    std::cout << "Requests:    " << total.requests << " (" << total.requests / elapsed << " req/s, "
+              << total.frames / elapsed << " frames/s)" << std::endl;
+    std::cout << "Operands:    " << std::setprecision(2)
+              << total.requests * (load_opt.operands + load_opt.operands_max) / 2.0 / elapsed / 1e6
+              << " M/s" << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << "Latency (us): min " << us(lat.min())
+              << "  mean " << us((int64_t)lat.mean())
+              << "  p50 " << us(lat.value_at_percentile(50))
+              << "  p90 " << us(lat.value_at_percentile(90))
+              << "  p99 " << us(lat.value_at_percentile(99))
+              << "  p999 " << us(lat.value_at_percentile(99.9))
+              << "  max " << us(lat.max()) << std::endl;
+    std::cout << "Not ok:      " << total.not_ok << " (overflow, division by zero, ...)" << std::endl;
+    if (load_opt.verify) {
+        std::cout << "Mismatches:  " << total.mismatches << std::endl;
+    }
+    if (total.unknown_ids > 0 || total.connect_errors > 0 || total.io_errors > 0) {
+        std::cout << "Errors:      unknown id " << total.unknown_ids << ", connect " << total.connect_errors
+                  << ", io " << total.io_errors << std::endl;
+    }
+    return total.mismatches > 0 || total.unknown_ids > 0 ? 1 : 0;
+}
+
+void print_usage(const char* prog) {
+    std::cout << "Usage : " << prog << " <IP> <port> [--batch [--type i32|i64|f64] [--stats]]\n"
+              << "        " << prog << " <IP> <port> --load [options]\n"
+              << "  --conns N          total connections (default 16)\n"
+              << "  --threads N        load generator threads (default 1)\n"
+              << "  --window N         in-flight requests per connection (default 32)\n"
+              << "  --frame N          requests per frame (default 1)\n"
+              << "  --operands N       operands per request (default 16)\n"
+              << "  --operands-max N   random operand count in [operands, operands-max]\n"
+              << "  --ops S            operators to pick from (default \"+-*/<>\")\n"
+              << "  --type T           i32 | i64 | f64 (default i32)\n"
+              << "  --pool N           distinct random requests per thread (default 4096)\n"
+              << "  --verify           check every result against a local computation\n"
+              << "  --duration S       measured seconds (default 10)\n"
+              << "  --warmup S         warm-up seconds not counted (default 1)" << std::endl;
+    exit(1);
+}
+
 int main(int argc, char** argv) {
 
     int sock;
     struct sockaddr_in serv_addr;
 
-        
-   if(argc != 3) {
-        std::cout << "Usage : " << argv[0] << " <IP> <port>" << std::endl;
-        exit(1);
+    bool batch_mode = false;
+    bool load_mode = false;
+    bool stats = false;
+    uint8_t type = OP_INT32;
+    bool operands_max_set = false;
+    if (argc < 3) {
+        print_usage(argv[0]);
+    }
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--batch") {
+            batch_mode = true;
+            continue;
+        } else if (arg == "--stats") {
+            batch_mode = true;
+            stats = true;
+            continue;
+        } else if (arg == "--load") {
+            load_mode = true;
+            continue;
+        } else if (arg == "--verify") {
+            load_opt.verify = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+        }
+        std::string val = argv[++i];
+        if (arg == "--type") {
+            if (val == "i32") {
+                type = OP_INT32;
+            } else if (val == "i64") {
+                type = OP_INT64;
+            } else if (val == "f64") {
+                type = OP_FLOAT64;
+            } else {
+                print_usage(argv[0]);
+            }
+        } else if (arg == "--conns") {
+            load_opt.conns = std::stoi(val);
+        } else if (arg == "--threads") {
+            load_opt.threads = std::stoi(val);
+        } else if (arg == "--window") {
+            load_opt.window = std::stoi(val);
+        } else if (arg == "--frame") {
+            load_opt.frame = std::stoi(val);
+        } else if (arg == "--operands") {
+            load_opt.operands = std::stoi(val);
+        } else if (arg == "--operands-max") {
+            load_opt.operands_max = std::stoi(val);
+            operands_max_set = true;
+        } else if (arg == "--ops") {
+            load_opt.ops = val;
+        } else if (arg == "--pool") {
+            load_opt.pool = std::stoi(val);
+        } else if (arg == "--duration") {
+            load_opt.duration = std::stod(val);
+        } else if (arg == "--warmup") {
+            load_opt.warmup = std::stod(val);
+        } else {
+            print_usage(argv[0]);
+        }
+    }
+    if (!operands_max_set || load_opt.operands_max < load_opt.operands) {
+        load_opt.operands_max = load_opt.operands;
+    }
+    if (load_mode) {
+        load_opt.type = type;
+        if (batch_mode || load_opt.conns <= 0 || load_opt.threads <= 0 || load_opt.window <= 0
+            || load_opt.frame <= 0 || load_opt.operands <= 0 || load_opt.pool <= 0 || load_opt.ops.empty()) {
+            print_usage(argv[0]);
+        }
+        return run_load(argv[1], atoi(argv[2]));
     }
 
     sock = socket(PF_INET, SOCK_STREAM, 0);
@@ -33,42 +738,49 @@ int main(int argc, char** argv) {
 
     if(connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
         error_handling("connect() error");
-    } else {
+    } else if (!batch_mode) {
         std::cout << "Connected..........." << std::endl;
     }
 
+    if (batch_mode) {
+        int ret = run_batch(sock, type, stats);
+        close(sock);
+        return ret;
+    }
+
+    // 交互模式：每次一个请求，也用帧协议发送（一次 send 发出整个请求）
+    OpBatch batch;
+    std::vector<int32_t> operands;
+    std::vector<OpResult> results;
     while(1) {
         std::cout << "Operand count: ";
         int operand_count;
-        std::cin >> operand_count;
-        if(operand_count < 2 || operand_count > 100) {
-            std::cout << "Invalid operand count. Please enter a number between 2 and 100." << std::endl;
+        if (!(std::cin >> operand_count)) {
+            break;
+        }
+        if(operand_count < 1) {
+            std::cout << "Invalid operand count. Please enter a positive number." << std::endl;
             continue;
         }
-        write(sock, &operand_count, sizeof(int));
-
+        operands.resize(operand_count);
         for(int i = 0; i < operand_count; i++) {
-            int operand;
             std::cout << "Operand " << i + 1 << ": ";
-            std::cin >> operand;
-            write(sock, &operand, sizeof(int));
+            std::cin >> operands[i];
         }
 
         char op;
         std::cout << "Operator (+, -, *, /): ";
-        std::cin >> op;
-        write(sock, &op, sizeof(char));
-
-        int result;
-        read(sock, &result, sizeof(int));
-        std::cout << "Result from server: " << result << std::endl;
+        if (!(std::cin >> op)) {
+            break;
+        }
+        batch.add(op, operands.data(), (uint32_t)operand_count);
+        if (!batch.execute(sock, results) || results.size() != 1) {
+            error_handling("request failed");
+        }
+        print_result(results[0]);
     }
 
-
-
-    
-
     close(sock);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <cerrno>         // errno，整数常量越界检查
+#include <cstddef>        // size_t
+#include <cstdint>        // int64_t, uint32_t
+#include <cstdlib>        // strtod, strtoll
+#include <cstring>        // memcpy
+#include <climits>        // INT64_MIN
+#include <list>           // std::list，LRU 链表
+#include <string>         // std::string
+#include <type_traits>    // std::is_floating_point
+#include <unordered_map>  // 表达式文本 -> LRU 节点
+#include <vector>         // std::vector
+#include "op_protocol.h"  // OpResult、OP_BAD_EXPR
+
+/**
+ * op_server 的表达式请求：把 "(a+b)*c" 这样的表达式编译成寄存器式字节码，再按列批量求值。
+ *
+ * 编译：递归下降解析，按求值栈的深度分配寄存器（第 k 层的中间结果放在寄存器 k），
+ * 每条指令是 "dst = a <op> b"；变量 a~z 表示每行的第 0~25 列。
+ * 求值：每次取 OP_EXPR_BLOCK 行，逐条指令对整块数据执行一个紧凑的循环，
+ * 指令分派（switch）的开销由整块数据分摊，而不是每行每个节点一次；循环体是简单的数组运算，编译器可以向量化。
+ * 整数按 int64 计算并检查溢出和除数为 0，出错的行单独返回错误状态，不影响其他行。
+ */
+
+constexpr uint32_t OP_EXPR_BLOCK = 256;      // 每次求值的行数
+constexpr size_t OP_EXPR_MAX_REGS = 32;      // 求值栈的最大深度
+constexpr size_t OP_EXPR_MAX_CODE = 1024;    // 最多指令条数
+constexpr int OP_EXPR_MAX_NESTING = 64;      // 括号 / 负号的最大嵌套层数，防止解析时递归过深
+
+enum OpCode : uint8_t {
+    OPC_VAR,    // dst = 第 arg 列
+    OPC_CONST,  // dst = 第 arg 个常量
+    OPC_ADD,    // dst = a + b
+    OPC_SUB,
+    OPC_MUL,
+    OPC_DIV,
+    OPC_NEG,    // dst = -a
+};
+
+struct OpInstr {
+    uint8_t code;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+    uint32_t arg;
+};
+
+/**
+ * @brief 编译好的表达式
+ */
+struct OpProgram {
+    std::vector<OpInstr> code;
+    std::vector<int64_t> int_consts;   // 常量的整数值（非整数常量为 0）
+    std::vector<double> float_consts;  // 常量的浮点值
+    bool integer_consts = true;        // 所有常量都是整数，整数类型的请求才能使用
+    size_t regs = 0;                   // 用到的寄存器个数
+    uint32_t vars = 0;                 // 用到的列数（最大的变量下标 + 1）
+    std::string error;                 // 编译错误，空表示成功
+};
+
+/**
+ * @brief 表达式编译器：expr := term (('+'|'-') term)*；term := unary (('*'|'/') unary)*；
+ * unary := '-' unary | primary；primary := 数字 | 变量 a~z | '(' expr ')'
+ */
+class OpExprCompiler {
+public:
+    static OpProgram compile(const std::string& text) {
+        OpExprCompiler c(text);
+        c.skip_space();
+        c.parse_expr(0);
+        c.skip_space();
+        if (c.prog_.error.empty() && c.pos_ != text.size()) {
+            c.fail("unexpected character");
+        }
+        if (c.prog_.error.empty() && c.prog_.code.empty()) {
+            c.fail("empty expression");
+        }
+        return c.prog_;
+    }
+
+private:
+    explicit OpExprCompiler(const std::string& text) : text_(text) {}
+
+    void fail(const char* message) {
+        if (prog_.error.empty()) {
+            prog_.error = std::string(message) + " at " + std::to_string(pos_);
+        }
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t')) {
+            pos_++;
+        }
+    }
+
+    void emit(uint8_t code, uint8_t dst, uint8_t a, uint8_t b, uint32_t arg) {
+        if (prog_.code.size() >= OP_EXPR_MAX_CODE) {
+            fail("expression too long");
+            return;
+        }
+        prog_.code.push_back({code, dst, a, b, arg});
+    }
+
+    // 把一个值压到求值栈上，返回它的寄存器
+    uint8_t push() {
+        if (depth_ >= OP_EXPR_MAX_REGS) {
+            fail("expression too deep");
+            return 0;
+        }
+        uint8_t r = (uint8_t)depth_++;
+        if (depth_ > prog_.regs) {
+            prog_.regs = depth_;
+        }
+        return r;
+    }
+
+    void parse_expr(int nesting) {
+        parse_term(nesting);
+        while (prog_.error.empty() && pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) {
+            uint8_t code = text_[pos_++] == '+' ? OPC_ADD : OPC_SUB;
+            skip_space();
+            parse_term(nesting);
+            binary(code);
+        }
+    }
+
+    void parse_term(int nesting) {
+        parse_unary(nesting);
+        while (prog_.error.empty() && pos_ < text_.size() && (text_[pos_] == '*' || text_[pos_] == '/')) {
+            uint8_t code = text_[pos_++] == '*' ? OPC_MUL : OPC_DIV;
+            skip_space();
+            parse_unary(nesting);
+            binary(code);
+        }
+    }
+
+    void binary(uint8_t code) {
+        if (!prog_.error.empty()) {
+            return;
+        }
+        depth_--;
+        uint8_t a = (uint8_t)(depth_ - 1);
+        emit(code, a, a, (uint8_t)depth_, 0);
+    }
+
+    void parse_unary(int nesting) {
+        if (nesting > OP_EXPR_MAX_NESTING) {
+            fail("expression nested too deeply");
+            return;
+        }
+        if (pos_ < text_.size() && text_[pos_] == '-') {
+            pos_++;
+            skip_space();
+            parse_unary(nesting + 1);
+            if (prog_.error.empty()) {
+                uint8_t r = (uint8_t)(depth_ - 1);
+                emit(OPC_NEG, r, r, 0, 0);
+            }
+            return;
+        }
+        parse_primary(nesting);
+        skip_space();
+    }
+
+    void parse_primary(int nesting) {
+        if (pos_ >= text_.size()) {
+            fail("unexpected end");
+            return;
+        }
+        char ch = text_[pos_];
+        if (ch == '(') {
+            pos_++;
+            skip_space();
+            parse_expr(nesting + 1);
+            if (prog_.error.empty() && (pos_ >= text_.size() || text_[pos_] != ')')) {
+                fail("missing ')'");
+                return;
+            }
+            pos_++;
+        } else if (ch >= 'a' && ch <= 'z') {
+            uint32_t var = (uint32_t)(ch - 'a');
+            pos_++;
+            if (var + 1 > prog_.vars) {
+                prog_.vars = var + 1;
+            }
+            emit(OPC_VAR, push(), 0, 0, var);
+        } else if ((ch >= '0' && ch <= '9') || ch == '.') {
+            parse_number();
+        } else {
+            fail("unexpected character");
+        }
+    }
+
+    // 数字：digits [. digits] [(e|E) [+|-] digits]，带小数点或指数的是浮点常量
+    void parse_number() {
+        size_t start = pos_;
+        auto digits = [&] {
+            size_t from = pos_;
+            while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+                pos_++;
+            }
+            return pos_ > from;
+        };
+        bool integer = true;
+        bool any = digits();
+        if (pos_ < text_.size() && text_[pos_] == '.') {
+            pos_++;
+            any = digits() || any;
+            integer = false;
+        }
+        if (any && pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+            pos_++;
+            if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) {
+                pos_++;
+            }
+            any = digits();
+            integer = false;
+        }
+        if (!any) {
+            fail("bad number");
+            return;
+        }
+        std::string literal = text_.substr(start, pos_ - start);
+        int64_t i = 0;
+        if (integer) {
+            errno = 0;
+            i = strtoll(literal.c_str(), nullptr, 10);
+            if (errno == ERANGE) {
+                fail("integer constant out of range");
+                return;
+            }
+        } else {
+            prog_.integer_consts = false;
+        }
+        prog_.int_consts.push_back(i);
+        prog_.float_consts.push_back(strtod(literal.c_str(), nullptr));
+        emit(OPC_CONST, push(), 0, 0, (uint32_t)prog_.int_consts.size() - 1);
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+    size_t depth_ = 0;
+    OpProgram prog_;
+};
+
+/**
+ * @brief 编译结果的缓存（LRU，按表达式文本），同一个表达式只编译一次
+ */
+class OpProgramCache {
+public:
+    explicit OpProgramCache(size_t capacity = 256) : capacity_(capacity) {}
+
+    const OpProgram& get(const std::string& text) {
+        auto it = index_.find(text);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+        lru_.emplace_front(text, OpExprCompiler::compile(text));
+        index_[text] = lru_.begin();
+        if (lru_.size() > capacity_) {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        return lru_.front().second;
+    }
+
+private:
+    typedef std::list<std::pair<std::string, OpProgram>> LruList;
+    size_t capacity_;
+    LruList lru_;
+    std::unordered_map<std::string, LruList::iterator> index_;
+};
+
+/**
+ * @brief 对 rows 行数据执行 prog，每行一个结果追加到 out。T 是计算类型（int64 或 double），Src 是数据类型
+ */
+template <typename T, typename Src>
+inline void op_run_program(const OpProgram& prog, const unsigned char* data, uint32_t rows, uint32_t vars,
+                           uint32_t id, uint8_t type, std::vector<OpResult>& out) {
+    constexpr bool FLOAT = std::is_floating_point<T>::value;
+    std::vector<T> regs(prog.regs * OP_EXPR_BLOCK);
+    uint8_t status[OP_EXPR_BLOCK];
+    for (uint32_t base = 0; base < rows; base += OP_EXPR_BLOCK) {
+        uint32_t m = rows - base < OP_EXPR_BLOCK ? rows - base : OP_EXPR_BLOCK;
+        memset(status, OP_OK, m);
+        for (const OpInstr& in : prog.code) {
+            T* d = regs.data() + in.dst * OP_EXPR_BLOCK;
+            const T* x = regs.data() + in.a * OP_EXPR_BLOCK;
+            const T* y = regs.data() + in.b * OP_EXPR_BLOCK;
+            switch (in.code) {
+                case OPC_VAR:
+                    for (uint32_t r = 0; r < m; r++) {
+                        Src v;
+                        memcpy(&v, data + (((size_t)base + r) * vars + in.arg) * sizeof(Src), sizeof(Src));
+                        d[r] = (T)v;
+                    }
+                    break;
+                case OPC_CONST: {
+                    T c = FLOAT ? (T)prog.float_consts[in.arg] : (T)prog.int_consts[in.arg];
+                    for (uint32_t r = 0; r < m; r++) {
+                        d[r] = c;
+                    }
+                    break;
+                }
+                case OPC_ADD:
+                case OPC_SUB:
+                case OPC_MUL:
+                    for (uint32_t r = 0; r < m; r++) {
+                        if constexpr (FLOAT) {
+                            d[r] = in.code == OPC_ADD ? x[r] + y[r] : in.code == OPC_SUB ? x[r] - y[r] : x[r] * y[r];
+                        } else {
+                            T v;
+                            bool o = in.code == OPC_ADD ? __builtin_add_overflow(x[r], y[r], &v)
+                                   : in.code == OPC_SUB ? __builtin_sub_overflow(x[r], y[r], &v)
+                                   : __builtin_mul_overflow(x[r], y[r], &v);
+                            d[r] = v;
+                            if (o && status[r] == OP_OK) {
+                                status[r] = OP_OVERFLOW;
+                            }
+                        }
+                    }
+                    break;
+                case OPC_DIV:
+                    for (uint32_t r = 0; r < m; r++) {
+                        uint8_t s = OP_OK;
+                        if (y[r] == 0) {
+                            s = OP_DIV_BY_ZERO;
+                        } else if (!FLOAT && x[r] == (T)INT64_MIN && y[r] == (T)-1) {
+                            s = OP_OVERFLOW;
+                        }
+                        d[r] = s == OP_OK ? x[r] / y[r] : 0;
+                        if (s != OP_OK && status[r] == OP_OK) {
+                            status[r] = s;
+                        }
+                    }
+                    break;
+                case OPC_NEG:
+                    for (uint32_t r = 0; r < m; r++) {
+                        if (!FLOAT && x[r] == (T)INT64_MIN) {
+                            d[r] = x[r];
+                            if (status[r] == OP_OK) {
+                                status[r] = OP_OVERFLOW;
+                            }
+                        } else {
+                            d[r] = -x[r];
+                        }
+                    }
+                    break;
+            }
+        }
+        const T* result = regs.data(); // 整个表达式的值在寄存器 0
+        for (uint32_t r = 0; r < m; r++) {
+            OpResult res;
+            res.id = id;
+            res.type = type;
+            res.status = status[r];
+            if (status[r] == OP_OK) {
+                if constexpr (FLOAT) {
+                    res.set_double(result[r]);
+                } else {
+                    res.value = result[r];
+                }
+            }
+            out.push_back(res);
+        }
+    }
+}
+
+/**
+ * @brief 处理一个表达式请求（内容格式见 op_protocol.h），结果追加到 out：成功时每行一个，否则一个错误结果
+ * @param max_rows 最多允许多少行（响应帧里还能放下的结果数），超过时返回错误结果
+ */
+inline void op_evaluate_expr(OpProgramCache& programs, const unsigned char* payload, size_t bytes, uint32_t id,
+                             size_t max_rows, std::vector<OpResult>& out) {
+    OpResult bad;
+    bad.id = id;
+    bad.type = OP_BYTES;
+    bad.status = OP_BAD_EXPR;
+    if (bytes < OP_EXPR_HEADER_BYTES) {
+        out.push_back(bad);
+        return;
+    }
+    uint8_t type = payload[0];
+    uint32_t vars = payload[1];
+    uint16_t expr_len;
+    uint32_t rows;
+    memcpy(&expr_len, payload + 2, 2);
+    memcpy(&rows, payload + 4, 4);
+    size_t size = op_type_size(type);
+    // vars 为 0 时任何 rows 都能通过长度检查，必须拒绝：下面按 rows 预留内存，rows 只能来自实际收到的数据
+    if (type == OP_BYTES || size == 0 || rows == 0 || vars == 0 || rows > max_rows
+        || bytes != OP_EXPR_HEADER_BYTES + expr_len + (size_t)rows * vars * size) {
+        out.push_back(bad);
+        return;
+    }
+    const OpProgram& prog = programs.get(std::string((const char*)payload + OP_EXPR_HEADER_BYTES, expr_len));
+    if (!prog.error.empty() || prog.vars > vars || (type != OP_FLOAT64 && !prog.integer_consts)) {
+        out.push_back(bad);
+        return;
+    }
+    const unsigned char* data = payload + OP_EXPR_HEADER_BYTES + expr_len;
+    out.reserve(out.size() + rows);
+    if (type == OP_INT32) {
+        op_run_program<int64_t, int32_t>(prog, data, rows, vars, id, type, out);
+    } else if (type == OP_INT64) {
+        op_run_program<int64_t, int64_t>(prog, data, rows, vars, id, type, out);
+    } else {
+        op_run_program<double, double>(prog, data, rows, vars, id, type, out);
+    }
+}
@@ -0,0 +1,596 @@
+#pragma once
+
+#include <climits>      // INT64_MIN
+#include <cstddef>      // size_t
+#include <cstdint>      // int32_t, int64_t
+#include <cstring>      // memcpy
+#include <string>       // std::string
+#include "op_protocol.h" // OpResult、OpStatus、OpType
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // SSE4.2 / AVX2 intrinsics
+#define OP_KERNELS_X86 1
+#endif
+
+/**
+ * op_server 的归约内核：求和、乘积、最小值、最大值，int32 / int64 / double 三种操作数类型。
+ *
+ * 每种指令集一组实现（标量、SSE4.2、AVX2），SIMD 版本用 __attribute__((target)) 单独编译，
+ * 不需要给整个程序加 -mavx2；启动时用 __builtin_cpu_supports 选出 CPU 支持的最快一组，
+ * 通过函数指针表调用。操作数直接从接收缓冲区读取（loadu，不要求对齐）。
+ *
+ * 整数结果是精确的：int32 求和用 int64 累加（2^32 个操作数也不会溢出），int64 求和把每个数拆成
+ * 高低 32 位分别累加、最后合成 __int128；只有最终结果超出 int64 才报告 OP_OVERFLOW。
+ * double 求和 / 乘积按 SIMD 通道分组累加，和顺序累加相比最后几位可能不同；含 NaN 时最小值 / 最大值的结果未定义。
+ */
+
+/**
+ * @brief 一组归约内核。n 是元素个数，最小值 / 最大值要求 n >= 1
+ */
+struct OpKernels {
+    const char* name;
+    int64_t (*sum_i32)(const unsigned char* p, size_t n);
+    __int128 (*sum_i64)(const unsigned char* p, size_t n);
+    double (*sum_f64)(const unsigned char* p, size_t n);
+    double (*prod_f64)(const unsigned char* p, size_t n);
+    int32_t (*min_i32)(const unsigned char* p, size_t n);
+    int32_t (*max_i32)(const unsigned char* p, size_t n);
+    int64_t (*min_i64)(const unsigned char* p, size_t n);
+    int64_t (*max_i64)(const unsigned char* p, size_t n);
+    double (*min_f64)(const unsigned char* p, size_t n);
+    double (*max_f64)(const unsigned char* p, size_t n);
+    bool (*any_zero_i32)(const unsigned char* p, size_t n);
+    bool (*any_zero_i64)(const unsigned char* p, size_t n);
+};
+
+template <typename T>
+inline T op_load(const unsigned char* p, size_t i) {
+    T v;
+    memcpy(&v, p + i * sizeof(T), sizeof(T));
+    return v;
+}
+
+// ---------------------------------------------------------------- 标量
+
+inline int64_t op_sum_i32_scalar(const unsigned char* p, size_t n) {
+    int64_t s = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += op_load<int32_t>(p, i);
+    }
+    return s;
+}
+
+inline __int128 op_sum_i64_scalar(const unsigned char* p, size_t n) {
+    __int128 s = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += op_load<int64_t>(p, i);
+    }
+    return s;
+}
+
+inline double op_sum_f64_scalar(const unsigned char* p, size_t n) {
+    double s = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += op_load<double>(p, i);
+    }
+    return s;
+}
+
+inline double op_prod_f64_scalar(const unsigned char* p, size_t n) {
+    double s = 1;
+    for (size_t i = 0; i < n; i++) {
+        s *= op_load<double>(p, i);
+    }
+    return s;
+}
+
+template <typename T, bool MAX>
+inline T op_extreme_scalar(const unsigned char* p, size_t n) {
+    T m = op_load<T>(p, 0);
+    for (size_t i = 1; i < n; i++) {
+        T v = op_load<T>(p, i);
+        if (MAX ? v > m : v < m) {
+            m = v;
+        }
+    }
+    return m;
+}
+
+template <typename T>
+inline bool op_any_zero_scalar(const unsigned char* p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (op_load<T>(p, i) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef OP_KERNELS_X86
+
+// ---------------------------------------------------------------- SSE4.2（128 位）
+
+__attribute__((target("sse4.2")))
+inline int64_t op_sum_i32_sse42(const unsigned char* p, size_t n) {
+    __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 4));
+        acc0 = _mm_add_epi64(acc0, _mm_cvtepi32_epi64(v));                    // 低两个 int32 符号扩展
+        acc1 = _mm_add_epi64(acc1, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8))); // 高两个
+    }
+    acc0 = _mm_add_epi64(acc0, acc1);
+    int64_t s = _mm_extract_epi64(acc0, 0) + _mm_extract_epi64(acc0, 1);
+    return s + op_sum_i32_scalar(p + i * 4, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline __int128 op_sum_i64_sse42(const unsigned char* p, size_t n) {
+    // 每个 int64 拆成低 32 位和高 32 位（都按无符号）分别累加，再数出负数的个数：
+    // v = hi * 2^32 + lo - (v < 0 ? 2^64 : 0)。每条通道最多累加 2^32 个 32 位数，不会溢出，结果总是精确的
+    const __m128i low_mask = _mm_set1_epi64x(0xffffffff);
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128(), neg = _mm_setzero_si128(), zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 8));
+        lo = _mm_add_epi64(lo, _mm_and_si128(v, low_mask));
+        hi = _mm_add_epi64(hi, _mm_srli_epi64(v, 32));
+        neg = _mm_sub_epi64(neg, _mm_cmpgt_epi64(zero, v)); // 负数时比较结果为 -1
+    }
+    uint64_t l[2], h[2], c[2];
+    _mm_storeu_si128((__m128i*)l, lo);
+    _mm_storeu_si128((__m128i*)h, hi);
+    _mm_storeu_si128((__m128i*)c, neg);
+    __int128 s = ((__int128)(h[0] + h[1]) << 32) + (__int128)l[0] + l[1] - ((__int128)(c[0] + c[1]) << 64);
+    return s + op_sum_i64_scalar(p + i * 8, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline double op_sum_f64_sse42(const unsigned char* p, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd((const double*)(p + i * 8)));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd((const double*)(p + i * 8 + 16)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + op_sum_f64_scalar(p + i * 8, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline double op_prod_f64_sse42(const unsigned char* p, size_t n) {
+    __m128d acc0 = _mm_set1_pd(1.0), acc1 = _mm_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_mul_pd(acc0, _mm_loadu_pd((const double*)(p + i * 8)));
+        acc1 = _mm_mul_pd(acc1, _mm_loadu_pd((const double*)(p + i * 8 + 16)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_mul_pd(acc0, acc1));
+    return lanes[0] * lanes[1] * op_prod_f64_scalar(p + i * 8, n - i);
+}
+
+template <bool MAX>
+__attribute__((target("sse4.2")))
+inline int32_t op_extreme_i32_sse42(const unsigned char* p, size_t n) {
+    __m128i m = _mm_set1_epi32(op_load<int32_t>(p, 0));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 4));
+        m = MAX ? _mm_max_epi32(m, v) : _mm_min_epi32(m, v);
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, m);
+    int32_t r = lanes[0];
+    for (int j = 1; j < 4; j++) {
+        r = MAX ? (lanes[j] > r ? lanes[j] : r) : (lanes[j] < r ? lanes[j] : r);
+    }
+    for (; i < n; i++) {
+        int32_t v = op_load<int32_t>(p, i);
+        r = MAX ? (v > r ? v : r) : (v < r ? v : r);
+    }
+    return r;
+}
+
+template <bool MAX>
+__attribute__((target("sse4.2")))
+inline int64_t op_extreme_i64_sse42(const unsigned char* p, size_t n) {
+    __m128i m = _mm_set1_epi64x(op_load<int64_t>(p, 0));
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 8));
+        __m128i take = MAX ? _mm_cmpgt_epi64(v, m) : _mm_cmpgt_epi64(m, v); // SSE4.2 才有 64 位比较
+        m = _mm_blendv_epi8(m, v, take);
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, m);
+    int64_t r = MAX ? (lanes[1] > lanes[0] ? lanes[1] : lanes[0]) : (lanes[1] < lanes[0] ? lanes[1] : lanes[0]);
+    for (; i < n; i++) {
+        int64_t v = op_load<int64_t>(p, i);
+        r = MAX ? (v > r ? v : r) : (v < r ? v : r);
+    }
+    return r;
+}
+
+template <bool MAX>
+__attribute__((target("sse4.2")))
+inline double op_extreme_f64_sse42(const unsigned char* p, size_t n) {
+    __m128d m = _mm_set1_pd(op_load<double>(p, 0));
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd((const double*)(p + i * 8));
+        m = MAX ? _mm_max_pd(m, v) : _mm_min_pd(m, v);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, m);
+    double r = MAX ? (lanes[1] > lanes[0] ? lanes[1] : lanes[0]) : (lanes[1] < lanes[0] ? lanes[1] : lanes[0]);
+    for (; i < n; i++) {
+        double v = op_load<double>(p, i);
+        r = MAX ? (v > r ? v : r) : (v < r ? v : r);
+    }
+    return r;
+}
+
+__attribute__((target("sse4.2")))
+inline bool op_any_zero_i32_sse42(const unsigned char* p, size_t n) {
+    __m128i zero = _mm_setzero_si128(), hit = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p + i * 4)), zero));
+    }
+    return !_mm_testz_si128(hit, hit) || op_any_zero_scalar<int32_t>(p + i * 4, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline bool op_any_zero_i64_sse42(const unsigned char* p, size_t n) {
+    __m128i zero = _mm_setzero_si128(), hit = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(p + i * 8)), zero));
+    }
+    return !_mm_testz_si128(hit, hit) || op_any_zero_scalar<int64_t>(p + i * 8, n - i);
+}
+
+// ---------------------------------------------------------------- AVX2（256 位）
+
+__attribute__((target("avx2")))
+inline int64_t op_sum_i32_avx2(const unsigned char* p, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i * 4));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + op_sum_i32_scalar(p + i * 4, n - i);
+}
+
+__attribute__((target("avx2")))
+inline __int128 op_sum_i64_avx2(const unsigned char* p, size_t n) {
+    // 与 SSE4.2 版本相同的拆分累加（AVX2 没有 64 位算术右移，所以高 32 位按无符号处理再修正负数）
+    const __m256i low_mask = _mm256_set1_epi64x(0xffffffff);
+    __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256(), neg = _mm256_setzero_si256();
+    __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i * 8));
+        lo = _mm256_add_epi64(lo, _mm256_and_si256(v, low_mask));
+        hi = _mm256_add_epi64(hi, _mm256_srli_epi64(v, 32));
+        neg = _mm256_sub_epi64(neg, _mm256_cmpgt_epi64(zero, v));
+    }
+    uint64_t l[4], h[4], c[4];
+    _mm256_storeu_si256((__m256i*)l, lo);
+    _mm256_storeu_si256((__m256i*)h, hi);
+    _mm256_storeu_si256((__m256i*)c, neg);
+    __int128 s = 0;
+    for (int j = 0; j < 4; j++) {
+        s += ((__int128)h[j] << 32) + (__int128)l[j] - ((__int128)c[j] << 64);
+    }
+    return s + op_sum_i64_scalar(p + i * 8, n - i);
+}
+
+__attribute__((target("avx2")))
+inline double op_sum_f64_avx2(const unsigned char* p, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd((const double*)(p + i * 8)));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd((const double*)(p + i * 8 + 32)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + op_sum_f64_scalar(p + i * 8, n - i);
+}
+
+__attribute__((target("avx2")))
+inline double op_prod_f64_avx2(const unsigned char* p, size_t n) {
+    __m256d acc0 = _mm256_set1_pd(1.0), acc1 = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_mul_pd(acc0, _mm256_loadu_pd((const double*)(p + i * 8)));
+        acc1 = _mm256_mul_pd(acc1, _mm256_loadu_pd((const double*)(p + i * 8 + 32)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_mul_pd(acc0, acc1));
+    return lanes[0] * lanes[1] * lanes[2] * lanes[3] * op_prod_f64_scalar(p + i * 8, n - i);
+}
+
+template <bool MAX>
+__attribute__((target("avx2")))
+inline int32_t op_extreme_i32_avx2(const unsigned char* p, size_t n) {
+    __m256i m = _mm256_set1_epi32(op_load<int32_t>(p, 0));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i * 4));
+        m = MAX ? _mm256_max_epi32(m, v) : _mm256_min_epi32(m, v);
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, m);
+    int32_t r = lanes[0];
+    for (int j = 1; j < 8; j++) {
+        r = MAX ? (lanes[j] > r ? lanes[j] : r) : (lanes[j] < r ? lanes[j] : r);
+    }
+    for (; i < n; i++) {
+        int32_t v = op_load<int32_t>(p, i);
+        r = MAX ? (v > r ? v : r) : (v < r ? v : r);
+    }
+    return r;
+}
+
+template <bool MAX>
+__attribute__((target("avx2")))
+inline int64_t op_extreme_i64_avx2(const unsigned char* p, size_t n) {
+    __m256i m = _mm256_set1_epi64x(op_load<int64_t>(p, 0));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i * 8));
+        __m256i take = MAX ? _mm256_cmpgt_epi64(v, m) : _mm256_cmpgt_epi64(m, v); // AVX2 没有 64 位 min/max
+        m = _mm256_blendv_epi8(m, v, take);
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, m);
+    int64_t r = lanes[0];
+    for (int j = 1; j < 4; j++) {
+        r = MAX ? (lanes[j] > r ? lanes[j] : r) : (lanes[j] < r ? lanes[j] : r);
+    }
+    for (; i < n; i++) {
+        int64_t v = op_load<int64_t>(p, i);
+        r = MAX ? (v > r ? v : r) : (v < r ? v : r);
+    }
+    return r;
+}
+
+template <bool MAX>
+__attribute__((target("avx2")))
+inline double op_extreme_f64_avx2(const unsigned char* p, size_t n) {
+    __m256d m = _mm256_set1_pd(op_load<double>(p, 0));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd((const double*)(p + i * 8));
+        m = MAX ? _mm256_max_pd(m, v) : _mm256_min_pd(m, v);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, m);
+    double r = lanes[0];
+    for (int j = 1; j < 4; j++) {
+        r = MAX ? (lanes[j] > r ? lanes[j] : r) : (lanes[j] < r ? lanes[j] : r);
+    }
+    for (; i < n; i++) {
+        double v = op_load<double>(p, i);
+        r = MAX ? (v > r ? v : r) : (v < r ? v : r);
+    }
+    return r;
+}
+
+__attribute__((target("avx2")))
+inline bool op_any_zero_i32_avx2(const unsigned char* p, size_t n) {
+    __m256i zero = _mm256_setzero_si256(), hit = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(p + i * 4)), zero));
+    }
+    return !_mm256_testz_si256(hit, hit) || op_any_zero_scalar<int32_t>(p + i * 4, n - i);
+}
+
+__attribute__((target("avx2")))
+inline bool op_any_zero_i64_avx2(const unsigned char* p, size_t n) {
+    __m256i zero = _mm256_setzero_si256(), hit = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(p + i * 8)), zero));
+    }
+    return !_mm256_testz_si256(hit, hit) || op_any_zero_scalar<int64_t>(p + i * 8, n - i);
+}
+
+#endif // OP_KERNELS_X86
+
+// ---------------------------------------------------------------- 选择实现
+
+inline const OpKernels& op_kernels_scalar() {
+    static const OpKernels k = {
+        "scalar",
+        op_sum_i32_scalar, op_sum_i64_scalar, op_sum_f64_scalar, op_prod_f64_scalar,
+        op_extreme_scalar<int32_t, false>, op_extreme_scalar<int32_t, true>,
+        op_extreme_scalar<int64_t, false>, op_extreme_scalar<int64_t, true>,
+        op_extreme_scalar<double, false>, op_extreme_scalar<double, true>,
+        op_any_zero_scalar<int32_t>, op_any_zero_scalar<int64_t>,
+    };
+    return k;
+}
+
+/**
+ * @brief 按名字取一组内核（"scalar"、"sse4.2"、"avx2"）
+ * @return const OpKernels* 名字不认识或 CPU 不支持时返回 nullptr
+ */
+inline const OpKernels* op_kernels_for(const std::string& isa) {
+    if (isa == "scalar") {
+        return &op_kernels_scalar();
+    }
+#ifdef OP_KERNELS_X86
+    __builtin_cpu_init();
+    if (isa == "sse4.2" && __builtin_cpu_supports("sse4.2")) {
+        static const OpKernels k = {
+            "sse4.2",
+            op_sum_i32_sse42, op_sum_i64_sse42, op_sum_f64_sse42, op_prod_f64_sse42,
+            op_extreme_i32_sse42<false>, op_extreme_i32_sse42<true>,
+            op_extreme_i64_sse42<false>, op_extreme_i64_sse42<true>,
+            op_extreme_f64_sse42<false>, op_extreme_f64_sse42<true>,
+            op_any_zero_i32_sse42, op_any_zero_i64_sse42,
+        };
+        return &k;
+    }
+    if (isa == "avx2" && __builtin_cpu_supports("avx2")) {
+        static const OpKernels k = {
+            "avx2",
+            op_sum_i32_avx2, op_sum_i64_avx2, op_sum_f64_avx2, op_prod_f64_avx2,
+            op_extreme_i32_avx2<false>, op_extreme_i32_avx2<true>,
+            op_extreme_i64_avx2<false>, op_extreme_i64_avx2<true>,
+            op_extreme_f64_avx2<false>, op_extreme_f64_avx2<true>,
+            op_any_zero_i32_avx2, op_any_zero_i64_avx2,
+        };
+        return &k;
+    }
+#endif
+    return nullptr;
+}
+
+/**
+ * @brief 当前 CPU 支持的最快一组内核（第一次调用时检测，之后直接返回）
+ */
+inline const OpKernels& op_kernels() {
+    static const OpKernels& best = *[] {
+        for (const char* isa : {"avx2", "sse4.2"}) {
+            if (const OpKernels* k = op_kernels_for(isa)) {
+                return k;
+            }
+        }
+        return &op_kernels_scalar();
+    }();
+    return best;
+}
+
+// ---------------------------------------------------------------- 计算一个请求
+
+inline bool op_fits_i64(__int128 v) {
+    return v >= INT64_MIN && v <= INT64_MAX;
+}
+
+/**
+ * @brief 整数乘积：逐个做带溢出检查的乘法，遇到 0 提前结束；
+ * 中途溢出时如果后面还有 0，结果仍然是 0，否则报告溢出
+ */
+template <typename T>
+inline OpResult op_product_int(const OpKernels& k, const unsigned char* p, size_t n, OpResult r) {
+    int64_t acc = op_load<T>(p, 0);
+    for (size_t i = 1; i < n && acc != 0; i++) {
+        if (__builtin_mul_overflow(acc, (int64_t)op_load<T>(p, i), &acc)) {
+            bool zero = sizeof(T) == 4 ? k.any_zero_i32(p + i * 4, n - i) : k.any_zero_i64(p + i * 8, n - i);
+            r.value = 0;
+            r.status = zero ? OP_OK : OP_OVERFLOW;
+            return r;
+        }
+    }
+    r.value = acc;
+    return r;
+}
+
+/**
+ * @brief 整数除法：从左到右依次相除，除数为 0 或 INT64_MIN / -1 时报告错误
+ */
+template <typename T>
+inline OpResult op_divide_int(const unsigned char* p, size_t n, OpResult r) {
+    int64_t acc = op_load<T>(p, 0);
+    for (size_t i = 1; i < n; i++) {
+        int64_t d = op_load<T>(p, i);
+        if (d == 0) {
+            r.status = OP_DIV_BY_ZERO;
+            return r;
+        }
+        if (acc == INT64_MIN && d == -1) {
+            r.status = OP_OVERFLOW;
+            return r;
+        }
+        acc /= d;
+    }
+    r.value = acc;
+    return r;
+}
+
+/**
+ * @brief 计算一个请求：op 是 '+' '-' '*' '/' '<'（最小值）'>'（最大值），
+ * '-' 和 '/' 是第一个操作数依次减去 / 除以其余操作数。整数类型的结果是 int64，double 类型的结果是 double
+ * @param operands 操作数（不要求对齐），count 个 op_type_size(type) 字节的元素
+ */
+inline OpResult op_evaluate(const OpKernels& k, char op, uint8_t type, const unsigned char* operands, uint32_t count) {
+    OpResult r;
+    r.type = type;
+    if (type != OP_INT32 && type != OP_INT64 && type != OP_FLOAT64) {
+        r.status = OP_BAD_TYPE;
+        return r;
+    }
+    if (count == 0) {
+        r.status = OP_BAD_COUNT;
+        return r;
+    }
+    const unsigned char* p = operands;
+    size_t n = count;
+    if (type == OP_FLOAT64) {
+        double v = 0;
+        switch (op) {
+            case '+': v = k.sum_f64(p, n); break;
+            case '-': v = op_load<double>(p, 0) - k.sum_f64(p + 8, n - 1); break;
+            case '*': v = k.prod_f64(p, n); break;
+            case '<': v = k.min_f64(p, n); break;
+            case '>': v = k.max_f64(p, n); break;
+            case '/':
+                v = op_load<double>(p, 0);
+                for (size_t i = 1; i < n; i++) {
+                    double d = op_load<double>(p, i);
+                    if (d == 0) {
+                        r.status = OP_DIV_BY_ZERO;
+                        return r;
+                    }
+                    v /= d;
+                }
+                break;
+            default:
+                r.status = OP_BAD_OPERATOR;
+                return r;
+        }
+        r.set_double(v);
+        return r;
+    }
+    bool i32 = type == OP_INT32;
+    __int128 wide;
+    switch (op) {
+        case '+':
+            wide = i32 ? k.sum_i32(p, n) : k.sum_i64(p, n);
+            break;
+        case '-':
+            wide = i32 ? (__int128)op_load<int32_t>(p, 0) - k.sum_i32(p + 4, n - 1)
+                       : (__int128)op_load<int64_t>(p, 0) - k.sum_i64(p + 8, n - 1);
+            break;
+        case '*':
+            return i32 ? op_product_int<int32_t>(k, p, n, r) : op_product_int<int64_t>(k, p, n, r);
+        case '/':
+            return i32 ? op_divide_int<int32_t>(p, n, r) : op_divide_int<int64_t>(p, n, r);
+        case '<':
+            r.value = i32 ? k.min_i32(p, n) : k.min_i64(p, n);
+            return r;
+        case '>':
+            r.value = i32 ? k.max_i32(p, n) : k.max_i64(p, n);
+            return r;
+        default:
+            r.status = OP_BAD_OPERATOR;
+            return r;
+    }
+    if (!op_fits_i64(wide)) {
+        r.status = OP_OVERFLOW;
+        return r;
+    }
+    r.value = (int64_t)wide;
+    return r;
+}
@@ -0,0 +1,177 @@
+#include <algorithm>                   // 包含 std::min, std::any_of
+#include <chrono>                      // 包含计时工具
+#include <cstdint>                     // 包含 INT32_MAX
+#include <cstring>                     // 包含内存操作函数
+#include <iostream>                    // 包含标准输入输出流
+#include <iomanip>                     // 包含 std::setw，对齐输出表格
+#include <random>                      // 包含随机数，生成操作数
+#include <string>                      // 包含 std::string
+#include <vector>                      // 包含 std::vector
+#include "op_kernels.h"                // op_server 的归约内核
+
+/**
+ * @brief op_server.cpp 原来的 cal_num（已被 op_evaluate 取代）的副本，逐个元素的 int 运算，作为基准。
+ * 没有溢出检查，有符号溢出是未定义行为，所以喂给它的数据必须保证累加、累乘都不溢出。
+ */
+int cal_num(int num[], char op, int count) {
+    int result = num[0];
+    switch(op) {
+        case '+':
+            for(int i = 1; i < count; i++) {
+                result += num[i];
+            }
+            break;
+        case '-':
+            for(int i = 1; i < count; i++) {
+                result -= num[i];
+            }
+            break;
+        case '*':
+            for(int i = 1; i < count; i++) {
+                result *= num[i];
+            }
+            break;
+        case '/':
+            for(int i = 1; i < count; i++) {
+                result /= num[i];
+            }
+            break;
+        default:
+            std::cout << "Unknown operator" << std::endl;
+            break;
+    }
+    return result;
+}
+
+/**
+ * @brief 解析逗号分隔的整数列表
+ */
+std::vector<int> parse_list(const std::string& list) {
+    std::vector<int> out;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        if (comma > pos) {
+            out.push_back(std::stoi(list.substr(pos, comma - pos)));
+        }
+        pos = comma + 1;
+    }
+    return out;
+}
+
+volatile int64_t sink; // 防止编译器把结果没被使用的计算优化掉
+
+/**
+ * @brief 反复调用 fn，至少运行 min_secs 秒，返回每秒调用次数
+ */
+template <typename F>
+double measure(double min_secs, F&& fn) {
+    long iters = 1;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iters; i++) {
+            sink = fn();
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (secs >= min_secs) {
+            return iters / secs;
+        }
+        iters *= 2;
+    }
+}
+
+/**
+ * @brief 主函数：比较 op_server 处理一个请求的速度（每秒请求数）。
+ * 基准是原来的标量 cal_num（只支持 int32，没有溢出检查），其余列是 op_kernels.h 的各组实现
+ * （经过 op_evaluate，与服务端的路径相同，带溢出检查）；CPU 不支持的指令集显示为 "-"。
+ * int32 的加数按元素个数缩小范围，保证最坏情况下的和也不超出 int32；int32 / int64 的乘积用 ±1 和
+ * 不超过 30 个 2 组成的数据，既不会溢出，也不会让带溢出检查的实现提前结束。
+ */
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {100, 10000, 1000000};
+    double min_secs = 0.2;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parse_list(argv[++i]);
+            if (std::any_of(sizes.begin(), sizes.end(), [](int n) { return n <= 0; })) {
+                std::cout << "--sizes must be positive" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--secs" && i + 1 < argc) {
+            min_secs = atof(argv[++i]);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--sizes 100,10000,1000000] [--secs S]" << std::endl;
+            return 1;
+        }
+    }
+    const char* isas[] = {"scalar", "sse4.2", "avx2"};
+    std::cout << "best kernels on this CPU: " << op_kernels().name << std::endl;
+    std::cout << std::left << std::setw(6) << "type" << std::setw(4) << "op" << std::setw(10) << "n"
+              << std::right << std::setw(14) << "cal_num";
+    for (const char* isa : isas) {
+        std::cout << std::setw(14) << isa;
+    }
+    std::cout << std::setw(10) << "speedup" << "    (requests/s)" << std::endl;
+
+    std::mt19937_64 rng(12345);
+    for (int n : sizes) {
+        std::vector<int32_t> i32(n), i32_prod(n);
+        std::vector<int64_t> i64(n), i64_prod(n);
+        std::vector<double> f64(n), f64_prod(n);
+        int32_t bound = std::min<int32_t>(1000, INT32_MAX / n); // n 个元素的和最坏也不溢出
+        for (int i = 0; i < n; i++) {
+            i32[i] = (int32_t)(rng() % (2 * bound + 1)) - bound;
+            i64[i] = (int64_t)(rng() >> 2) - (int64_t)(1ULL << 61);
+            f64[i] = (double)(rng() % 2001) / 1000 - 1;
+            int32_t unit = (int32_t)(rng() % 4);
+            i32_prod[i] = unit == 0 ? -1 : unit == 3 && i < 30 ? 2 : 1;
+            i64_prod[i] = i32_prod[i];
+            f64_prod[i] = 1 + ((double)(rng() % 2001) / 1000 - 1) / 1000;
+        }
+        for (uint8_t type : {(uint8_t)OP_INT32, (uint8_t)OP_INT64, (uint8_t)OP_FLOAT64}) {
+            for (char op : {'+', '*', '<', '>'}) {
+                const void* data;
+                if (type == OP_INT32) {
+                    data = op == '*' ? i32_prod.data() : i32.data();
+                } else if (type == OP_INT64) {
+                    data = op == '*' ? i64_prod.data() : i64.data();
+                } else {
+                    data = op == '*' ? f64_prod.data() : f64.data();
+                }
+                const unsigned char* p = (const unsigned char*)data;
+                const char* type_name = type == OP_INT32 ? "i32" : type == OP_INT64 ? "i64" : "f64";
+                std::cout << std::left << std::setw(6) << type_name << std::setw(4) << op << std::setw(10) << n
+                          << std::right << std::fixed << std::setprecision(0);
+
+                double base = 0;
+                if (type == OP_INT32 && (op == '+' || op == '*')) {
+                    int* nums = (int*)data;
+                    base = measure(min_secs, [&] { return cal_num(nums, op, n); });
+                    std::cout << std::setw(14) << base;
+                } else {
+                    std::cout << std::setw(14) << "-"; // cal_num 只支持 int 的四则运算
+                }
+                double best = 0;
+                for (const char* isa : isas) {
+                    const OpKernels* k = op_kernels_for(isa);
+                    if (k == nullptr) {
+                        std::cout << std::setw(14) << "-";
+                        continue;
+                    }
+                    double rate = measure(min_secs, [&] { return op_evaluate(*k, op, type, p, n).value; });
+                    best = rate > best ? rate : best;
+                    std::cout << std::setw(14) << rate;
+                }
+                if (base > 0) {
+                    std::cout << std::setprecision(2) << std::setw(9) << best / base << "x";
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,472 @@
+#pragma once
+
+#include <cstddef>      // size_t
+#include <cstdint>      // uint8_t, uint32_t, int32_t, int64_t
+#include <cstring>      // memcpy, memmove
+#include <string>       // std::string
+#include <vector>       // std::vector
+#include <sys/types.h>  // ssize_t
+#include <sys/socket.h> // recv, send
+#include <errno.h>      // errno
+
+/**
+ * op_server / op_client 的二进制帧协议。
+ *
+ * 原来的协议每个 int 一次 read / write：100 个操作数的请求要 102 次系统调用，而且不处理短读。
+ * 新协议把一批请求打包成一个帧，整帧一次 send 发出、服务端一次 recv 读入、所有结果再打包成一个响应帧，
+ * 一批请求只需要一个往返。客户端可以不等响应连续发送多个帧（流水线），响应帧按请求帧的顺序返回。
+ * 所有整数都是小端序。
+ *
+ * 帧头（16 字节）：
+ *   magic u32 = "OPF1" | version u8 | kind u8（请求 / 响应）| reserved u16 | count u32 | payload_bytes u32
+ * 请求（12 字节 + 操作数）：
+ *   id u32 | op u8（'+' '-' '*' '/'，'<' 最小值，'>' 最大值）| type u8 | reserved u16 | count u32 | count 个操作数
+ * 响应（16 字节，顺序与请求相同）：
+ *   id u32 | status u8 | type u8 | reserved u16 | value 8 字节（整数类型为 int64，OP_FLOAT64 为 double）
+ *
+ * 两种特殊请求：
+ *   op = OP_EXPR（'e'）：表达式，type = OP_BYTES，count 是下面这段内容的字节数
+ *     value_type u8 | vars u8 | expr_len u16 | rows u32 | 表达式文本 | rows 行、每行 vars 个 value_type 类型的值
+ *     表达式由变量 a~z（第几列）、数字、+ - * / 和括号组成，例如 "(a+b)*c"；对每一行求值，
+ *     响应是 rows 个结果（id 都是这个请求的 id，按行的顺序），表达式或内容不合法时是一个 OP_BAD_EXPR 结果；
+ *     响应帧不能超过 OP_MAX_FRAME_BYTES，所以一个请求帧的结果总数不超过 OP_MAX_RESULTS，行数超出的表达式也是 OP_BAD_EXPR
+ *   op = OP_STATS（'#'）：查询服务端的结果缓存，type = OP_INT32，一个操作数选择计数器（OpStat）
+ *
+ * 旧协议的第一个字段是操作数个数（不超过 OP_MAX_FRAME_BYTES / 4），不可能等于 magic，服务端据此区分新旧客户端。
+ */
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "op_protocol.h assumes a little-endian host");
+
+constexpr uint32_t OP_MAGIC = 0x3146504f;        // "OPF1"
+constexpr uint8_t OP_VERSION = 1;
+constexpr uint8_t OP_KIND_REQUEST = 1;
+constexpr uint8_t OP_KIND_RESPONSE = 2;
+constexpr size_t OP_FRAME_HEADER_BYTES = 16;
+constexpr size_t OP_REQUEST_HEADER_BYTES = 12;
+constexpr size_t OP_RESPONSE_BYTES = 16;
+constexpr uint32_t OP_MAX_FRAME_BYTES = 64u << 20; // 单帧上限，超过视为协议错误
+constexpr uint32_t OP_MAX_RESULTS = OP_MAX_FRAME_BYTES / OP_RESPONSE_BYTES; // 一个响应帧最多装的结果数
+constexpr char OP_EXPR = 'e';
+constexpr char OP_STATS = '#';
+constexpr size_t OP_EXPR_HEADER_BYTES = 8;
+
+/**
+ * @brief 操作数类型
+ */
+enum OpType : uint8_t {
+    OP_INT32 = 0,    // 按 int64 精度计算，结果是 int64
+    OP_INT64 = 1,
+    OP_FLOAT64 = 2,
+    OP_BYTES = 3,    // 不透明的字节，表达式请求用
+};
+
+/**
+ * @brief OP_STATS 请求可以查询的计数器
+ */
+enum OpStat : int32_t {
+    OP_STAT_HITS = 0,
+    OP_STAT_MISSES = 1,
+    OP_STAT_EVICTIONS = 2,
+    OP_STAT_ENTRIES = 3,
+    OP_STAT_BYTES = 4,   // 缓存占用的字节数
+};
+
+/**
+ * @brief 每个请求的处理结果
+ */
+enum OpStatus : uint8_t {
+    OP_OK = 0,
+    OP_BAD_OPERATOR = 1,  // 不认识的运算符
+    OP_BAD_COUNT = 2,     // 没有操作数
+    OP_DIV_BY_ZERO = 3,
+    OP_OVERFLOW = 4,      // 结果超出类型的表示范围
+    OP_BAD_TYPE = 5,      // 不支持的操作数类型
+    OP_BAD_EXPR = 6,      // 表达式语法错误、变量超出列数或内容长度不对
+};
+
+inline const char* op_status_name(uint8_t status) {
+    switch (status) {
+        case OP_OK: return "ok";
+        case OP_BAD_OPERATOR: return "bad operator";
+        case OP_BAD_COUNT: return "bad operand count";
+        case OP_DIV_BY_ZERO: return "division by zero";
+        case OP_OVERFLOW: return "overflow";
+        case OP_BAD_TYPE: return "bad operand type";
+        case OP_BAD_EXPR: return "bad expression";
+        default: return "unknown status";
+    }
+}
+
+inline size_t op_type_size(uint8_t type) {
+    switch (type) {
+        case OP_INT32: return 4;
+        case OP_INT64: return 8;
+        case OP_FLOAT64: return 8;
+        case OP_BYTES: return 1;
+        default: return 0;
+    }
+}
+
+struct OpFrameHeader {
+    uint32_t magic = OP_MAGIC;
+    uint8_t version = OP_VERSION;
+    uint8_t kind = OP_KIND_REQUEST;
+    uint32_t count = 0;          // 帧里的请求 / 响应个数
+    uint32_t payload_bytes = 0;  // 帧头之后的字节数
+
+    void encode(unsigned char* out) const {
+        uint16_t reserved = 0;
+        memcpy(out, &magic, 4);
+        out[4] = version;
+        out[5] = kind;
+        memcpy(out + 6, &reserved, 2);
+        memcpy(out + 8, &count, 4);
+        memcpy(out + 12, &payload_bytes, 4);
+    }
+    void decode(const unsigned char* in) {
+        memcpy(&magic, in, 4);
+        version = in[4];
+        kind = in[5];
+        memcpy(&count, in + 8, 4);
+        memcpy(&payload_bytes, in + 12, 4);
+    }
+};
+
+/**
+ * @brief 解码出的一个请求。operands 直接指向接收缓冲区（不保证对齐），在缓冲区被消费之前有效。
+ */
+struct OpRequest {
+    uint32_t id = 0;
+    char op = 0;
+    uint8_t type = OP_INT32;
+    uint32_t count = 0;
+    const unsigned char* operands = nullptr;
+
+    int32_t operand_i32(size_t i) const {
+        int32_t v;
+        memcpy(&v, operands + i * 4, 4);
+        return v;
+    }
+};
+
+/**
+ * @brief 一个请求的结果。value 按 type 解释：整数类型存为 int64
+ */
+struct OpResult {
+    uint32_t id = 0;
+    uint8_t status = OP_OK;
+    uint8_t type = OP_INT32;
+    int64_t value = 0;
+
+    double as_double() const {
+        double d;
+        memcpy(&d, &value, 8);
+        return d;
+    }
+    void set_double(double d) { memcpy(&value, &d, 8); }
+};
+
+/**
+ * @brief 检查 data 开头是否是一个完整的帧
+ * @return int 1 完整（h 和 frame_bytes 有效）；0 数据不够；-1 不是合法的帧（magic / 版本 / 长度不对）
+ */
+inline int op_peek_frame(const char* data, size_t len, OpFrameHeader& h, size_t& frame_bytes) {
+    if (len < OP_FRAME_HEADER_BYTES) {
+        return 0;
+    }
+    h.decode((const unsigned char*)data);
+    if (h.magic != OP_MAGIC || h.version != OP_VERSION || h.payload_bytes > OP_MAX_FRAME_BYTES) {
+        return -1;
+    }
+    frame_bytes = OP_FRAME_HEADER_BYTES + h.payload_bytes;
+    return len >= frame_bytes ? 1 : 0;
+}
+
+/**
+ * @brief 依次取出一个请求帧里的请求，逐个检查长度，不信任对端给的任何数字
+ */
+class OpRequestReader {
+public:
+    OpRequestReader(const OpFrameHeader& h, const char* payload)
+        : p_((const unsigned char*)payload), end_(p_ + h.payload_bytes), left_(h.count) {}
+
+    /**
+     * @brief 取下一个请求
+     * @return bool 没有更多请求（或帧格式错误，见 error()）时返回 false
+     */
+    bool next(OpRequest& r) {
+        if (left_ == 0) {
+            error_ = p_ != end_; // 声明的请求都取完了，不应该还有剩余字节
+            return false;
+        }
+        if ((size_t)(end_ - p_) < OP_REQUEST_HEADER_BYTES) {
+            error_ = true;
+            return false;
+        }
+        memcpy(&r.id, p_, 4);
+        r.op = (char)p_[4];
+        r.type = p_[5];
+        memcpy(&r.count, p_ + 8, 4);
+        size_t size = op_type_size(r.type);
+        size_t bytes = (size_t)r.count * (size ? size : 4);
+        p_ += OP_REQUEST_HEADER_BYTES;
+        if (size == 0 || (size_t)(end_ - p_) < bytes) {
+            error_ = true;
+            return false;
+        }
+        r.operands = p_;
+        p_ += bytes;
+        left_--;
+        return true;
+    }
+
+    bool error() const { return error_; }
+    uint32_t remaining() const { return left_; }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+    uint32_t left_;
+    bool error_ = false;
+};
+
+/**
+ * @brief 组帧：先追加请求或响应，finish() 时补上帧头。帧头和内容一起放在一块连续内存里，
+ * 一次 send 即可发出；缓冲区在多次使用之间复用。
+ */
+class OpFrameBuilder {
+public:
+    void start(uint8_t kind) {
+        kind_ = kind;
+        count_ = 0;
+        buf_.resize(OP_FRAME_HEADER_BYTES);
+    }
+
+    void add_request(uint32_t id, char op, uint8_t type, const void* operands, uint32_t count) {
+        size_t bytes = (size_t)count * op_type_size(type);
+        size_t off = buf_.size();
+        buf_.resize(off + OP_REQUEST_HEADER_BYTES + bytes);
+        unsigned char* p = (unsigned char*)buf_.data() + off;
+        uint16_t reserved = 0;
+        memcpy(p, &id, 4);
+        p[4] = (unsigned char)op;
+        p[5] = type;
+        memcpy(p + 6, &reserved, 2);
+        memcpy(p + 8, &count, 4);
+        if (bytes > 0) {
+            memcpy(p + OP_REQUEST_HEADER_BYTES, operands, bytes);
+        }
+        count_++;
+    }
+
+    void add_result(const OpResult& r) {
+        size_t off = buf_.size();
+        buf_.resize(off + OP_RESPONSE_BYTES);
+        unsigned char* p = (unsigned char*)buf_.data() + off;
+        uint16_t reserved = 0;
+        memcpy(p, &r.id, 4);
+        p[4] = r.status;
+        p[5] = r.type;
+        memcpy(p + 6, &reserved, 2);
+        memcpy(p + 8, &r.value, 8);
+        count_++;
+    }
+
+    uint32_t count() const { return count_; }
+
+    /**
+     * @brief 补上帧头，返回整帧（帧头 + 内容）
+     */
+    const std::vector<char>& finish() {
+        OpFrameHeader h;
+        h.kind = kind_;
+        h.count = count_;
+        h.payload_bytes = (uint32_t)(buf_.size() - OP_FRAME_HEADER_BYTES);
+        h.encode((unsigned char*)buf_.data());
+        return buf_;
+    }
+
+private:
+    std::vector<char> buf_;
+    uint8_t kind_ = OP_KIND_REQUEST;
+    uint32_t count_ = 0;
+};
+
+/**
+ * @brief 把 len 个字节全部写出（阻塞套接字）
+ */
+inline bool op_send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief 从阻塞套接字读出一个完整的帧。缓冲区按需增长并复用；每次 recv 都尽量多读，
+ * 小帧通常一次 recv 就能读完，大帧也只需要 帧长 / 缓冲区大小 次。
+ */
+class OpFrameReceiver {
+public:
+    explicit OpFrameReceiver(size_t capacity = 64 * 1024) : buf_(capacity) {}
+
+    /**
+     * @brief 读下一个帧，payload 指向帧内容，在下一次 receive 之前有效
+     * @return bool 对端关闭、出错或帧不合法时返回 false
+     */
+    bool receive(int fd, OpFrameHeader& h, const char*& payload) {
+        // 丢掉上一个帧，剩下的（对端连续发来的下一个帧）挪到开头
+        if (consumed_ > 0) {
+            memmove(buf_.data(), buf_.data() + consumed_, end_ - consumed_);
+            end_ -= consumed_;
+            consumed_ = 0;
+        }
+        size_t frame_bytes = 0;
+        while (true) {
+            int r = op_peek_frame(buf_.data(), end_, h, frame_bytes);
+            if (r == -1) {
+                return false;
+            }
+            if (r == 1) {
+                break;
+            }
+            size_t want = frame_bytes > buf_.size() ? frame_bytes : end_ + 1;
+            if (want > buf_.size()) {
+                buf_.resize(want);
+            }
+            ssize_t n = recv(fd, buf_.data() + end_, buf_.size() - end_, 0);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            end_ += n;
+        }
+        payload = buf_.data() + OP_FRAME_HEADER_BYTES;
+        consumed_ = frame_bytes;
+        return true;
+    }
+
+private:
+    std::vector<char> buf_;
+    size_t end_ = 0;
+    size_t consumed_ = 0;
+};
+
+/**
+ * @brief 客户端的批处理接口：把多个请求攒成一个帧，一次 send 发出，一次往返取回全部结果。
+ *
+ *   OpBatch batch;
+ *   uint32_t a = batch.add('+', xs, n);
+ *   uint32_t b = batch.add('*', ys, m);
+ *   std::vector<OpResult> results;
+ *   batch.execute(sock, results);   // results[0] 对应 a，results[1] 对应 b
+ *
+ * 表达式请求（add_expr）每行一个结果，结果比请求多，按 OpResult::id 对应。
+ */
+class OpBatch {
+public:
+    OpBatch() { clear(); }
+
+    /**
+     * @brief 追加一个请求，返回它的 id（在连接内单调递增）
+     */
+    uint32_t add(char op, const int32_t* operands, uint32_t count) {
+        return add(op, OP_INT32, operands, count);
+    }
+    uint32_t add(char op, const int64_t* operands, uint32_t count) {
+        return add(op, OP_INT64, operands, count);
+    }
+    uint32_t add(char op, const double* operands, uint32_t count) {
+        return add(op, OP_FLOAT64, operands, count);
+    }
+    uint32_t add(char op, uint8_t type, const void* operands, uint32_t count) {
+        uint32_t id = next_id_++;
+        builder_.add_request(id, op, type, operands, count);
+        return id;
+    }
+
+    /**
+     * @brief 追加一个表达式请求：对 rows 行数据（行优先，每行 vars 个 value_type 类型的值）求 expr 的值
+     */
+    uint32_t add_expr(const std::string& expr, uint8_t value_type, uint8_t vars, const void* rows, uint32_t row_count) {
+        size_t data_bytes = (size_t)row_count * vars * op_type_size(value_type);
+        expr_.resize(OP_EXPR_HEADER_BYTES + expr.size() + data_bytes);
+        unsigned char* p = (unsigned char*)expr_.data();
+        uint16_t expr_len = (uint16_t)expr.size();
+        p[0] = value_type;
+        p[1] = vars;
+        memcpy(p + 2, &expr_len, 2);
+        memcpy(p + 4, &row_count, 4);
+        memcpy(p + OP_EXPR_HEADER_BYTES, expr.data(), expr.size());
+        if (data_bytes > 0) {
+            memcpy(p + OP_EXPR_HEADER_BYTES + expr.size(), rows, data_bytes);
+        }
+        return add(OP_EXPR, OP_BYTES, expr_.data(), (uint32_t)expr_.size());
+    }
+
+    /**
+     * @brief 追加一个缓存统计查询
+     */
+    uint32_t add_stat(OpStat stat) {
+        int32_t which = stat;
+        return add(OP_STATS, &which, 1);
+    }
+
+    uint32_t size() const { return builder_.count(); }
+
+    void clear() { builder_.start(OP_KIND_REQUEST); }
+
+    /**
+     * @brief 发出整批请求，不等待结果。帧头和内容在同一块内存里，通常一次 send 就写完
+     */
+    bool send(int fd) {
+        const std::vector<char>& frame = builder_.finish();
+        return op_send_all(fd, frame.data(), frame.size());
+    }
+
+    /**
+     * @brief 读取这一批的响应帧，结果按请求顺序放进 results
+     */
+    bool receive(int fd, std::vector<OpResult>& results) {
+        OpFrameHeader h;
+        const char* payload;
+        if (!receiver_.receive(fd, h, payload) || h.kind != OP_KIND_RESPONSE
+            || h.payload_bytes != (size_t)h.count * OP_RESPONSE_BYTES) {
+            return false;
+        }
+        results.resize(h.count);
+        const unsigned char* p = (const unsigned char*)payload;
+        for (uint32_t i = 0; i < h.count; i++, p += OP_RESPONSE_BYTES) {
+            memcpy(&results[i].id, p, 4);
+            results[i].status = p[4];
+            results[i].type = p[5];
+            memcpy(&results[i].value, p + 8, 8);
+        }
+        return true;
+    }
+
+    /**
+     * @brief send + receive：一个往返算完整批请求，之后清空以便复用
+     */
+    bool execute(int fd, std::vector<OpResult>& results) {
+        bool ok = send(fd) && receive(fd, results);
+        clear();
+        return ok;
+    }
+
+private:
+    OpFrameBuilder builder_;
+    OpFrameReceiver receiver_;
+    std::vector<char> expr_; // 拼表达式请求内容的临时缓冲区
+    uint32_t next_id_ = 1;
+};
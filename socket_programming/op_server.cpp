@@ -1,44 +1,327 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>      // open，预留一个空闲 fd 应对 EMFILE
+#include <sys/epoll.h>
+#include "op_protocol.h" // 批量二进制帧协议
+#include "op_kernels.h"  // SIMD 归约内核，运行时按 CPU 选择
+#include "op_cache.h"    // 结果缓存（LRU）
+#include "op_expr.h"     // 表达式编译与批量求值
+
+const int MAX_EVENTS = 1024;
+const int LEGACY_MAX_COUNT = OP_MAX_FRAME_BYTES / 4; // 旧协议单个请求的操作数上限（与一个帧能装下的 int32 个数相同）
+const int LEGACY_PRINT_COUNT = 100;                  // 操作数不超过这么多时才逐个打印
+const size_t OUT_HIGH_WATER = 1 << 20;               // 待发送的响应超过 1 MB 时暂停处理该连接的新请求
+const size_t IN_BUFFER_BYTES = 64 * 1024;            // 每个连接读缓冲区的常驻大小
+const size_t CACHE_MIN_BYTES = 256;                  // 操作数少于这么多字节的请求不查缓存，直接算比算哈希还快
+bool quiet = false;                                  // --quiet: 不打印每个请求
+const OpKernels* kernels = nullptr;                  // --isa 指定，默认取 CPU 支持的最快一组
+OpResultCache* cache = nullptr;                      // --cache-mb 为 0 时不缓存
+OpProgramCache programs;                             // 编译好的表达式
+
 void error_handling(std::string message) {
     std::cout << message << std::endl;
     exit(1);
 }
 
-int cal_num(int num[], char op, int count) {
-    int result = num[0];
-    switch(op) {
-        case '+':
-            for(int i = 1; i < count; i++) {
-                result += num[i];
+/**
+ * @brief OP_STATS 请求：返回结果缓存的一个计数器
+ */
+OpResult cache_stat(const OpRequest& req) {
+    OpResult r;
+    r.id = req.id;
+    r.type = OP_INT64;
+    if (req.type != OP_INT32 || req.count != 1) {
+        r.status = OP_BAD_COUNT;
+        return r;
+    }
+    switch (req.operand_i32(0)) {
+        case OP_STAT_HITS: r.value = cache ? cache->hits() : 0; break;
+        case OP_STAT_MISSES: r.value = cache ? cache->misses() : 0; break;
+        case OP_STAT_EVICTIONS: r.value = cache ? cache->evictions() : 0; break;
+        case OP_STAT_ENTRIES: r.value = cache ? cache->entries() : 0; break;
+        case OP_STAT_BYTES: r.value = cache ? cache->used_bytes() : 0; break;
+        default: r.status = OP_BAD_COUNT; break;
+    }
+    return r;
+}
+
+/**
+ * @brief 计算新协议的一个请求，结果追加到 out（表达式请求每行一个结果）。
+ * 操作数直接在接收缓冲区上由归约内核处理，不再复制；足够大的请求先查结果缓存，命中时不再计算
+ * @param max_results 这个请求最多能产生多少个结果（响应帧的剩余容量），行数更多的表达式返回 OP_BAD_EXPR
+ */
+void compute(const OpRequest& req, size_t max_results, std::vector<OpResult>& out) {
+    if (req.op == OP_STATS) {
+        out.push_back(cache_stat(req));
+        return;
+    }
+    size_t bytes = (size_t)req.count * op_type_size(req.type);
+    bool cacheable = cache != nullptr && bytes >= CACHE_MIN_BYTES;
+    uint64_t hash = 0;
+    if (cacheable) {
+        const std::vector<OpResult>* hit = cache->find(req.op, req.type, req.operands, bytes, hash);
+        if (hit != nullptr) {
+            if (hit->size() > max_results) {
+                OpResult bad;
+                bad.id = req.id;
+                bad.type = OP_BYTES;
+                bad.status = OP_BAD_EXPR;
+                out.push_back(bad);
+                return;
             }
-            break;
-        case '-':
-            for(int i = 1; i < count; i++) {
-                result -= num[i];
+            for (OpResult r : *hit) {
+                r.id = req.id;
+                out.push_back(r);
             }
-            break;
-        case '*':
-            for(int i = 1; i < count; i++) {
-                result *= num[i];
+            return;
+        }
+    }
+    size_t first = out.size();
+    if (req.op == OP_EXPR && req.type == OP_BYTES) {
+        op_evaluate_expr(programs, req.operands, bytes, req.id, max_results, out);
+    } else {
+        OpResult r = op_evaluate(*kernels, req.op, req.type, req.operands, req.count);
+        r.id = req.id;
+        if (req.op == OP_EXPR) {
+            r.status = OP_BAD_TYPE; // 表达式请求的 type 必须是 OP_BYTES
+        }
+        out.push_back(r);
+    }
+    // 表达式出错时不缓存：行数超限的错误取决于同一帧里的其他请求，同样的请求换一个帧可能成功
+    if (cacheable && !(out.size() - first == 1 && out[first].status == OP_BAD_EXPR)) {
+        cache->insert(hash, req.op, req.type, req.operands, bytes, out.data() + first, out.size() - first);
+    }
+}
+
+/**
+ * @brief 一个客户端连接的读缓冲区：每次 recv 尽量读满，请求可以跨越多次 recv（短读）。
+ * 为大请求扩大的缓冲区在数据处理完后缩回常驻大小。
+ */
+struct ClientBuffer {
+    std::vector<char> buf = std::vector<char>(IN_BUFFER_BYTES);
+    size_t start = 0;
+    size_t end = 0;
+
+    const char* data() const { return buf.data() + start; }
+    size_t size() const { return end - start; }
+    void consume(size_t n) {
+        start += n;
+        if (start == end) {
+            start = end = 0;
+            if (buf.size() > IN_BUFFER_BYTES) {
+                buf.resize(IN_BUFFER_BYTES);
+                buf.shrink_to_fit();
             }
-            break;
-        case '/':
-            for(int i = 1; i < count; i++) {
-                result /= num[i];
+        }
+    }
+
+    /**
+     * @brief 读一次；need 是当前这条消息需要的总字节数。
+     * 缓冲区只在被实际收到的数据写满时扩大，每次最多翻倍、不超过 need：need 来自对端的帧头，
+     * 只发一个声称 64 MB 的帧头而不发内容的连接只占常驻大小的内存
+     */
+    ssize_t fill(int fd, size_t need) {
+        if (start > 0 && (need > buf.size() - start || end == buf.size())) {
+            memmove(buf.data(), buf.data() + start, end - start);
+            end -= start;
+            start = 0;
+        }
+        if (end == buf.size()) {
+            size_t grow = buf.size();
+            if (need > buf.size() && need - buf.size() < grow) {
+                grow = need - buf.size();
             }
+            buf.resize(buf.size() + grow);
+        }
+        ssize_t n;
+        do {
+            n = recv(fd, buf.data() + end, buf.size() - end, 0);
+        } while (n == -1 && errno == EINTR);
+        if (n > 0) {
+            end += n;
+        }
+        return n;
+    }
+};
+
+/**
+ * @brief 每个客户端连接的状态。响应追加到 out，按请求顺序发出（流水线）；
+ * out 里还有没发完的数据时只关注 EPOLLOUT，不再读新请求（背压）。
+ */
+struct Connection {
+    enum Mode { UNKNOWN, FRAMED, LEGACY } mode = UNKNOWN; // 由连接的前 4 个字节决定
+    int id = 0;
+    ClientBuffer in;
+    size_t need = sizeof(uint32_t); // 处理下一条消息至少需要的字节数
+    std::vector<char> out;
+    size_t out_off = 0;
+    bool paused = false;            // 因为 out 超过高水位而暂停处理，in 里可能还有完整的请求
+    uint32_t interest = EPOLLIN;
+    uint64_t requests = 0;
+
+    size_t out_pending() const { return out.size() - out_off; }
+};
+
+/**
+ * @brief 处理一个旧协议的请求：count(int) + count 个 int + 运算符(char)，结果是一个 int
+ * @return int 1 处理了一个请求；0 数据不够；-1 请求不合法，应断开
+ */
+int handle_legacy(Connection& c) {
+    ClientBuffer& in = c.in;
+    int number_count;
+    if (in.size() < sizeof(int)) {
+        c.need = sizeof(int);
+        return 0;
+    }
+    memcpy(&number_count, in.data(), sizeof(int));
+    if(number_count <= 1 || number_count > LEGACY_MAX_COUNT) {
+        std::cout << "Invalid number count: " << (int)number_count << std::endl;
+        return -1;
+    }
+    size_t total = sizeof(int) * ((size_t)number_count + 1) + 1;
+    if (in.size() < total) {
+        c.need = total;
+        return 0;
+    }
+    const unsigned char* operands = (const unsigned char*)in.data() + sizeof(int);
+    char op = in.data()[total - 1];
+    if (!quiet) {
+        std::cout << "Number count: " << number_count << std::endl;
+        for (int j = 0; j < number_count && number_count <= LEGACY_PRINT_COUNT; j++) {
+            std::cout << "Number " << j << ": " << op_load<int32_t>(operands, j) << std::endl;
+        }
+        std::cout << "Operator: " << op << std::endl;
+    }
+    // 与新协议相同的内核，整数运算精确并检查溢出（不再有有符号整数溢出的未定义行为）；
+    // 结果必须放得进旧协议的 int
+    int result = 0;
+    OpResult r = op_evaluate(*kernels, op, OP_INT32, operands, (uint32_t)number_count);
+    if (r.status == OP_OK && (r.value < INT32_MIN || r.value > INT32_MAX)) {
+        r.status = OP_OVERFLOW;
+    }
+    if (r.status == OP_OK) {
+        result = (int)r.value;
+    } else {
+        std::cout << "Rejected: " << op_status_name(r.status) << std::endl; // 旧协议没法报告错误，只能返回 0
+    }
+    in.consume(total);
+    c.need = sizeof(int);
+    c.out.insert(c.out.end(), (const char*)&result, (const char*)&result + sizeof(int));
+    c.requests++;
+    if (!quiet) {
+        std::cout << "Result: " << result << std::endl;
+    }
+    return 1;
+}
+
+/**
+ * @brief 处理一个请求帧，结果打包成一个响应帧追加到 out
+ * @return int 1 处理了一帧；0 数据不够；-1 帧不合法，应断开
+ */
+int handle_frame(Connection& c, OpFrameBuilder& builder, std::vector<OpResult>& results) {
+    OpFrameHeader h;
+    size_t frame_bytes = 0;
+    int r = op_peek_frame(c.in.data(), c.in.size(), h, frame_bytes);
+    if (r == -1 || (r == 1 && h.kind != OP_KIND_REQUEST)) {
+        std::cout << "Invalid frame" << std::endl;
+        return -1;
+    }
+    if (r == 0) {
+        c.need = frame_bytes > 0 ? frame_bytes : OP_FRAME_HEADER_BYTES;
+        return 0;
+    }
+    if (h.count > OP_MAX_RESULTS) {
+        std::cout << "Too many requests in frame" << std::endl;
+        return -1;
+    }
+    OpRequestReader reader(h, c.in.data() + OP_FRAME_HEADER_BYTES);
+    OpRequest req;
+    results.clear();
+    while (reader.next(req)) {
+        // 响应帧不能超过 OP_MAX_RESULTS 个结果：给后面每个请求留一个，剩下的都可以给这个请求（表达式）
+        compute(req, OP_MAX_RESULTS - results.size() - reader.remaining(), results);
+    }
+    if (reader.error()) {
+        std::cout << "Malformed request in frame" << std::endl;
+        return -1;
+    }
+    builder.start(OP_KIND_RESPONSE);
+    for (const OpResult& r : results) {
+        builder.add_result(r);
+    }
+    if (!quiet) {
+        std::cout << "Client " << c.id << " frame: " << h.count << " request(s), " << frame_bytes << " bytes" << std::endl;
+    }
+    c.in.consume(frame_bytes);
+    c.need = OP_FRAME_HEADER_BYTES;
+    c.requests += h.count;
+    const std::vector<char>& frame = builder.finish();
+    c.out.insert(c.out.end(), frame.begin(), frame.end());
+    return 1;
+}
+
+/**
+ * @brief 处理读缓冲区里所有完整的请求（流水线），直到数据不够或待发送的响应超过高水位
+ * @return bool 请求不合法、应断开时返回 false
+ */
+bool process_requests(Connection& c, OpFrameBuilder& builder, std::vector<OpResult>& results) {
+    if (c.mode == Connection::UNKNOWN) {
+        if (c.in.size() < sizeof(uint32_t)) {
+            return true;
+        }
+        // 连接的前 4 个字节决定协议：等于 OP_MAGIC 是新的帧协议，否则是旧协议的操作数个数
+        uint32_t first;
+        memcpy(&first, c.in.data(), sizeof(first));
+        c.mode = first == OP_MAGIC ? Connection::FRAMED : Connection::LEGACY;
+        if (!quiet) {
+            std::cout << "Client " << c.id << ": " << (c.mode == Connection::FRAMED ? "framed" : "legacy") << " protocol" << std::endl;
+        }
+    }
+    c.paused = false;
+    while (true) {
+        if (c.out_pending() >= OUT_HIGH_WATER) {
+            c.paused = true;
+            return true;
+        }
+        int r = c.mode == Connection::FRAMED ? handle_frame(c, builder, results) : handle_legacy(c);
+        if (r != 1) {
+            return r == 0;
+        }
+    }
+}
+
+/**
+ * @brief 把 out 里的响应发出去，直到发完或发送缓冲区满
+ * @return bool 发送出错时返回 false
+ */
+bool flush_connection(int fd, Connection& c) {
+    while (c.out_pending() > 0) {
+        ssize_t n = send(fd, c.out.data() + c.out_off, c.out_pending(), MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out_off += n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
             break;
-        default:
-            std::cout << "Unknown operator" << std::endl;
-            break;
+        } else {
+            return false;
+        }
+    }
+    if (c.out_pending() == 0) {
+        c.out.clear();
+        c.out_off = 0;
     }
-    return result;
+    return true;
 }
+
 int main(int argc, char** argv) {
 
     int serv_sock;
@@ -47,85 +330,191 @@ int main(int argc, char** argv) {
     struct sockaddr_in serv_addr;
     struct sockaddr_in clnt_addr;
     socklen_t clnt_addr_size;
-    
 
-    if (argc != 2) {
-        error_handling("Usage: <port>");
+    int port = -1;
+    int cache_mb = 64;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            cache_mb = atoi(argv[++i]);
+        } else if (arg == "--isa" && i + 1 < argc) {
+            kernels = op_kernels_for(argv[++i]);
+            if (kernels == nullptr) {
+                error_handling(std::string("unsupported --isa: ") + argv[i]);
+            }
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0) {
+        error_handling("Usage: <port> [--isa scalar|sse4.2|avx2] [--cache-mb N] [--quiet]");
+    }
+    if (kernels == nullptr) {
+        kernels = &op_kernels();
+    }
+    OpResultCache result_cache((size_t)(cache_mb > 0 ? cache_mb : 0) << 20);
+    if (cache_mb > 0) {
+        cache = &result_cache;
     }
 
-    serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    serv_sock = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     if(serv_sock == -1) {
         error_handling("socket() error");
     }
+    int optval = 1;
+    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, (void*)&optval, sizeof(optval));
 
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serv_addr.sin_port = htons(atoi(argv[1]));
+    serv_addr.sin_port = htons(port);
 
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
         error_handling("bind() error");
     }
 
-    if(listen(serv_sock, 5) == -1) {
+    if(listen(serv_sock, SOMAXCONN) == -1) {
         error_handling("listen() error");
     }
-    
-    clnt_addr_size = sizeof(clnt_addr);
-    int i = 0;
-    int opmem[100];
-    char op;
-    int number_count = 0;
-    while(1) {
-        clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
-        if(clnt_sock == -1) {
-            error_handling("accept() error");
-        }
-        std::cout << "Connected client " << ++i << std::endl;
-        bool exit = false;
-        while(!exit) {
-            ssize_t read_len = read(clnt_sock, &number_count, sizeof(int));
-            if (read_len <= 0) {
-                std::cout << "Client disconnected" << std::endl;
-                exit = true;
-                break;
+
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        error_handling("epoll_create1() error");
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = serv_sock;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, serv_sock, &ev) == -1) {
+        error_handling("epoll_ctl() add serv_sock error");
+    }
+    std::cout << "Kernels: " << kernels->name << ", result cache: " << (cache_mb > 0 ? cache_mb : 0) << " MB" << std::endl;
+
+    std::unordered_map<int, Connection> conns; // fd -> 连接状态
+    OpFrameBuilder builder;                    // 响应帧，所有连接复用
+    std::vector<OpResult> results;             // 一个帧的结果，复用
+    struct epoll_event events[MAX_EVENTS];
+    int clients = 0;
+
+    // fd 用完（EMFILE / ENFILE）时，水平触发的监听套接字会一直可读；先释放这个预留的 fd，
+    // 接受后立刻关闭，把排队的连接取走，避免忙等（与 echo_epollserv 相同）
+    int spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    auto close_connection = [&](int fd) {
+        auto it = conns.find(fd);
+        if (it != conns.end()) {
+            if (!quiet) {
+                std::cout << "Client " << it->second.id << " disconnected, " << it->second.requests << " request(s)" << std::endl;
             }
-            std::cout << "Number count: " << (int)number_count << std::endl;
-            if(number_count <= 1 || number_count > 100) {
-                std::cout << "Invalid number count: " << (int)number_count << std::endl;
-                exit = true;
+            conns.erase(it);
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        close(fd);
+    };
+
+    // 处理请求、发出响应，再按是否还有待发送数据决定关注的事件
+    auto serve = [&](int fd, Connection& c) {
+        while (true) {
+            if (!process_requests(c, builder, results) || !flush_connection(fd, c)) {
+                close_connection(fd);
+                return;
+            }
+            // 因高水位暂停、而响应又已经全部发完时，继续处理缓冲区里剩下的请求
+            if (!c.paused || c.out_pending() > 0) {
                 break;
             }
-            bool read_error = false;
-            for(int j = 0; j < number_count; j++) {
-                read_len = read(clnt_sock, &opmem[j], sizeof(int));
-                if (read_len <= 0) {
-                    std::cout << "Client disconnected during number reading" << std::endl;
-                    read_error = true;
-                    break;
+        }
+        uint32_t interest = c.out_pending() > 0 ? EPOLLOUT : EPOLLIN;
+        if (interest != c.interest) {
+            struct epoll_event mod;
+            mod.events = interest;
+            mod.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &mod) == -1) {
+                error_handling("epoll_ctl() mod clnt_sock error");
+            }
+            c.interest = interest;
+        }
+    };
+
+    while(1) {
+        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling("epoll_wait() error");
+        }
+        for (int i = 0; i < nfds; i++) {
+            int fd = events[i].data.fd;
+            if (fd == serv_sock) {
+                // 一次把监听队列里的连接都取完
+                while (true) {
+                    clnt_addr_size = sizeof(clnt_addr);
+                    clnt_sock = accept4(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size, SOCK_NONBLOCK);
+                    if (clnt_sock == -1) {
+                        if ((errno == EMFILE || errno == ENFILE) && spare_fd != -1) {
+                            // fd 不够时 accept 在检查队列之前就失败，队列空了也一直是 EMFILE，所以取不到连接时要退出循环
+                            close(spare_fd);
+                            int rejected = accept(serv_sock, NULL, NULL);
+                            if (rejected != -1) {
+                                close(rejected);
+                            }
+                            spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                            if (rejected == -1) {
+                                break;
+                            }
+                            if (!quiet) {
+                                std::cerr << "Too many open files, connection rejected" << std::endl;
+                            }
+                            continue;
+                        }
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            std::cerr << "accept() error (errno: " << errno << ")" << std::endl;
+                        }
+                        break;
+                    }
+                    struct epoll_event add;
+                    add.events = EPOLLIN;
+                    add.data.fd = clnt_sock;
+                    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &add) == -1) {
+                        close(clnt_sock);
+                        continue;
+                    }
+                    conns[clnt_sock].id = ++clients;
+                    if (!quiet) {
+                        std::cout << "Connected client " << clients << std::endl;
+                    }
                 }
-                std::cout << "Number " << j << ": " << opmem[j] << std::endl;
+                continue;
             }
-            if (read_error) {
-                exit = true;
-                break;
+            auto it = conns.find(fd);
+            if (it == conns.end()) {
+                continue;
             }
-            
-            read_len = read(clnt_sock, &op, 1);
-            if (read_len <= 0) {
-                std::cout << "Client disconnected during operator reading" << std::endl;
-                exit = true;
-                break;
+            Connection& c = it->second;
+            if (c.interest == EPOLLIN) {
+                ssize_t read_len = c.in.fill(fd, c.need);
+                if (read_len == 0 || (read_len == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    close_connection(fd);
+                    continue;
+                }
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_connection(fd);
+                continue;
             }
-            std::cout << "Operator: " << op << std::endl;
-            int result = cal_num(opmem, op, number_count);
-            write(clnt_sock, &result, sizeof(int));
-            std::cout << "Result: " << result << std::endl;
+            serve(fd, c);
         }
-        close(clnt_sock);
     }
+    if (spare_fd != -1) {
+        close(spare_fd);
+    }
+    close(epoll_fd);
     close(serv_sock);
 
 
     return 0;
-}
\ No newline at end of file
+}
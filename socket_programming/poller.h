@@ -0,0 +1,309 @@
+#pragma once
+
+#include <cstdint>        // uint32_t
+#include <cstring>        // memcpy
+#include <memory>         // std::unique_ptr
+#include <string>         // std::string
+#include <vector>         // std::vector
+#include <errno.h>        // errno
+#include <poll.h>         // poll
+#include <unistd.h>       // close
+#include <sys/epoll.h>    // epoll
+#include <sys/select.h>   // select, fd_mask
+
+/**
+ * @brief 一个就绪事件
+ */
+struct PollEvent {
+    int fd;
+    uint32_t events; // Poller::READ / WRITE / ERROR 的组合
+};
+
+/**
+ * @brief 就绪通知的统一接口，select / poll / epoll 三种实现可以互换。
+ *
+ * 只提供水平触发语义（三者都支持的最大公约数）。fd 由调用者负责关闭，关闭前先 remove。
+ * 非线程安全：每个事件循环一个 Poller。
+ */
+class Poller {
+public:
+    static constexpr uint32_t READ = 1;
+    static constexpr uint32_t WRITE = 2;
+    static constexpr uint32_t ERROR = 4; // 出错或挂断，只会出现在结果里，不需要注册
+
+    virtual ~Poller() = default;
+
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief 开始监视 fd；events 是 READ / WRITE 的组合
+     * @return bool fd 超出该实现的能力（或系统调用失败）时返回 false
+     */
+    virtual bool add(int fd, uint32_t events) = 0;
+    virtual bool modify(int fd, uint32_t events) = 0;
+    virtual void remove(int fd) = 0;
+
+    /**
+     * @brief 等待事件，就绪的 fd 追加到 out（先清空）
+     * @param timeout_ms -1 表示一直等
+     * @return int 就绪 fd 的个数，出错返回 -1（errno 有效，EINTR 时调用者重试即可）
+     */
+    virtual int wait(std::vector<PollEvent>& out, int timeout_ms) = 0;
+
+    /**
+     * @brief 按名字创建实现："select"、"poll" 或 "epoll"，名字不认识时返回 nullptr
+     */
+    static std::unique_ptr<Poller> create(const std::string& backend);
+};
+
+/**
+ * @brief select 实现。
+ *
+ * 普通的 fd_set 是定长的（FD_SETSIZE = 1024），fd 超过 1023 时 FD_SET 会越界。这里用按需增长的
+ * fd_mask 数组代替 fd_set（内核按 nfds 读取位图，并不限制在 FD_SETSIZE 以内），所以能监视任意大的 fd。
+ *
+ * 另外维护一个稠密的活跃 fd 列表：每次 wait 只拷贝 [0, max_fd] 范围的位图，结果也只遍历活跃列表，
+ * 而不是从 0 扫到 max_fd；fd 被移除时 max_fd 会随之降低。
+ */
+class SelectPoller : public Poller {
+public:
+    const char* name() const override { return "select"; }
+
+    bool add(int fd, uint32_t events) override {
+        if (fd < 0) {
+            return false;
+        }
+        if ((size_t)fd >= pos_.size()) {
+            pos_.resize(fd + 1, -1);
+            size_t words = fd / NFDBITS + 1;
+            if (words > read_set_.size()) {
+                read_set_.resize(words, 0);
+                write_set_.resize(words, 0);
+                read_out_.resize(words, 0);
+                write_out_.resize(words, 0);
+            }
+        }
+        if (pos_[fd] != -1) {
+            return modify(fd, events);
+        }
+        pos_[fd] = (int)fds_.size();
+        fds_.push_back(fd);
+        if (fd > max_fd_) {
+            max_fd_ = fd;
+        }
+        set_bits(fd, events);
+        return true;
+    }
+
+    bool modify(int fd, uint32_t events) override {
+        if (fd < 0 || (size_t)fd >= pos_.size() || pos_[fd] == -1) {
+            return false;
+        }
+        set_bits(fd, events);
+        return true;
+    }
+
+    void remove(int fd) override {
+        if (fd < 0 || (size_t)fd >= pos_.size() || pos_[fd] == -1) {
+            return;
+        }
+        set_bits(fd, 0);
+        // 和最后一个交换后删除，保持列表稠密
+        int idx = pos_[fd];
+        int last = fds_.back();
+        fds_[idx] = last;
+        pos_[last] = idx;
+        fds_.pop_back();
+        pos_[fd] = -1;
+        if (fd == max_fd_) {
+            max_fd_ = -1;
+            for (int f : fds_) {
+                if (f > max_fd_) {
+                    max_fd_ = f;
+                }
+            }
+        }
+    }
+
+    int wait(std::vector<PollEvent>& out, int timeout_ms) override {
+        out.clear();
+        // 只拷贝实际用到的那几个字
+        size_t words = max_fd_ / NFDBITS + 1;
+        if (max_fd_ >= 0) {
+            memcpy(read_out_.data(), read_set_.data(), words * sizeof(fd_mask));
+            memcpy(write_out_.data(), write_set_.data(), words * sizeof(fd_mask));
+        }
+        struct timeval tv;
+        struct timeval* tvp = nullptr;
+        if (timeout_ms >= 0) {
+            tv.tv_sec = timeout_ms / 1000;
+            tv.tv_usec = (timeout_ms % 1000) * 1000;
+            tvp = &tv;
+        }
+        int n = select(max_fd_ + 1, max_fd_ >= 0 ? (fd_set*)read_out_.data() : nullptr,
+                       max_fd_ >= 0 ? (fd_set*)write_out_.data() : nullptr, nullptr, tvp);
+        if (n <= 0) {
+            return n;
+        }
+        // 只检查活跃的 fd，找够 n 个就停
+        int found = 0;
+        for (size_t i = 0; i < fds_.size() && found < n; i++) {
+            int fd = fds_[i];
+            uint32_t ev = (test(read_out_, fd) ? READ : 0) | (test(write_out_, fd) ? WRITE : 0);
+            if (ev != 0) {
+                out.push_back({fd, ev});
+                found += (ev & READ ? 1 : 0) + (ev & WRITE ? 1 : 0); // select 的返回值按位计数
+            }
+        }
+        return (int)out.size();
+    }
+
+private:
+    static bool test(const std::vector<fd_mask>& set, int fd) {
+        return (set[fd / NFDBITS] >> (fd % NFDBITS)) & 1;
+    }
+
+    static void assign(std::vector<fd_mask>& set, int fd, bool on) {
+        fd_mask bit = (fd_mask)1 << (fd % NFDBITS);
+        if (on) {
+            set[fd / NFDBITS] |= bit;
+        } else {
+            set[fd / NFDBITS] &= ~bit;
+        }
+    }
+
+    void set_bits(int fd, uint32_t events) {
+        assign(read_set_, fd, events & READ);
+        assign(write_set_, fd, events & WRITE);
+    }
+
+    std::vector<int> fds_;             // 活跃的 fd（稠密）
+    std::vector<int> pos_;             // fd -> 在 fds_ 中的下标，-1 表示未注册
+    std::vector<fd_mask> read_set_;    // 注册的位图
+    std::vector<fd_mask> write_set_;
+    std::vector<fd_mask> read_out_;    // 交给 select 修改的副本
+    std::vector<fd_mask> write_out_;
+    int max_fd_ = -1;
+};
+
+/**
+ * @brief poll 实现：稠密的 pollfd 数组，没有 fd 大小的限制，但每次 wait 内核和用户态都要遍历整个数组
+ */
+class PollPoller : public Poller {
+public:
+    const char* name() const override { return "poll"; }
+
+    bool add(int fd, uint32_t events) override {
+        if (fd < 0) {
+            return false;
+        }
+        if ((size_t)fd >= pos_.size()) {
+            pos_.resize(fd + 1, -1);
+        }
+        if (pos_[fd] != -1) {
+            return modify(fd, events);
+        }
+        pos_[fd] = (int)pfds_.size();
+        pfds_.push_back({fd, to_poll(events), 0});
+        return true;
+    }
+
+    bool modify(int fd, uint32_t events) override {
+        if (fd < 0 || (size_t)fd >= pos_.size() || pos_[fd] == -1) {
+            return false;
+        }
+        pfds_[pos_[fd]].events = to_poll(events);
+        return true;
+    }
+
+    void remove(int fd) override {
+        if (fd < 0 || (size_t)fd >= pos_.size() || pos_[fd] == -1) {
+            return;
+        }
+        int idx = pos_[fd];
+        pfds_[idx] = pfds_.back();
+        pos_[pfds_[idx].fd] = idx;
+        pfds_.pop_back();
+        pos_[fd] = -1;
+    }
+
+    int wait(std::vector<PollEvent>& out, int timeout_ms) override {
+        out.clear();
+        int n = poll(pfds_.data(), pfds_.size(), timeout_ms);
+        if (n <= 0) {
+            return n;
+        }
+        for (size_t i = 0; i < pfds_.size() && (int)out.size() < n; i++) {
+            short re = pfds_[i].revents;
+            if (re != 0) {
+                out.push_back({pfds_[i].fd, (uint32_t)((re & POLLIN ? READ : 0) | (re & POLLOUT ? WRITE : 0)
+                                                       | (re & (POLLERR | POLLHUP | POLLNVAL) ? ERROR : 0))});
+            }
+        }
+        return (int)out.size();
+    }
+
+private:
+    static short to_poll(uint32_t events) {
+        return (short)((events & READ ? POLLIN : 0) | (events & WRITE ? POLLOUT : 0));
+    }
+
+    std::vector<struct pollfd> pfds_;  // 注册的 fd（稠密）
+    std::vector<int> pos_;             // fd -> 在 pfds_ 中的下标，-1 表示未注册
+};
+
+/**
+ * @brief epoll 实现：注册信息保存在内核里，wait 的开销只和就绪的 fd 个数有关
+ */
+class EpollPoller : public Poller {
+public:
+    static constexpr int MAX_EVENTS = 1024; // 单次 wait 最多返回的事件数
+
+    EpollPoller() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), events_(MAX_EVENTS) {}
+    ~EpollPoller() override {
+        if (epoll_fd_ != -1) {
+            close(epoll_fd_);
+        }
+    }
+
+    const char* name() const override { return "epoll"; }
+
+    bool add(int fd, uint32_t events) override { return ctl(EPOLL_CTL_ADD, fd, events); }
+    bool modify(int fd, uint32_t events) override { return ctl(EPOLL_CTL_MOD, fd, events); }
+    void remove(int fd) override { epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr); }
+
+    int wait(std::vector<PollEvent>& out, int timeout_ms) override {
+        out.clear();
+        int n = epoll_wait(epoll_fd_, events_.data(), MAX_EVENTS, timeout_ms);
+        for (int i = 0; i < n; i++) {
+            uint32_t e = events_[i].events;
+            out.push_back({events_[i].data.fd, (e & EPOLLIN ? READ : 0) | (e & EPOLLOUT ? WRITE : 0)
+                                               | (e & (EPOLLERR | EPOLLHUP) ? ERROR : 0)});
+        }
+        return n;
+    }
+
+private:
+    bool ctl(int op, int fd, uint32_t events) {
+        struct epoll_event ev;
+        ev.events = (events & READ ? (uint32_t)EPOLLIN : 0) | (events & WRITE ? (uint32_t)EPOLLOUT : 0);
+        ev.data.fd = fd;
+        return epoll_ctl(epoll_fd_, op, fd, &ev) == 0;
+    }
+
+    int epoll_fd_;
+    std::vector<struct epoll_event> events_;
+};
+
+inline std::unique_ptr<Poller> Poller::create(const std::string& backend) {
+    if (backend == "select") {
+        return std::unique_ptr<Poller>(new SelectPoller());
+    }
+    if (backend == "poll") {
+        return std::unique_ptr<Poller>(new PollPoller());
+    }
+    if (backend == "epoll") {
+        return std::unique_ptr<Poller>(new EpollPoller());
+    }
+    return nullptr;
+}
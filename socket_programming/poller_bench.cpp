@@ -0,0 +1,155 @@
+#include <algorithm>                   // 包含 std::min
+#include <cstring>                     // 包含内存操作函数
+#include <iostream>                    // 包含标准输入输出流
+#include <iomanip>                     // 包含 std::setw，对齐输出表格
+#include <string>                      // 包含 std::string
+#include <vector>                      // 包含 std::vector
+#include <random>                      // 包含随机数，每轮随机挑选活跃连接
+#include <chrono>                      // 包含计时工具
+#include <sys/socket.h>                // 包含 socketpair
+#include <sys/resource.h>              // 包含 setrlimit，提高可打开的 fd 上限
+#include <unistd.h>                    // 包含 read, write, close
+#include <errno.h>                     // 包含错误码定义 (errno)
+#include "poller.h"                    // select / poll / epoll 三种就绪通知实现
+
+void error_handling(std::string message) {
+    std::cout << message << " (errno: " << errno << ")" << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief 把可打开的 fd 数量提高到硬上限
+ * @return 当前上限
+ */
+size_t raise_fd_limit() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    getrlimit(RLIMIT_NOFILE, &rl);
+    return rl.rlim_cur;
+}
+
+/**
+ * @brief 解析逗号分隔的整数列表
+ */
+std::vector<int> parse_list(const std::string& list) {
+    std::vector<int> out;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        if (comma > pos) {
+            out.push_back(std::stoi(list.substr(pos, comma - pos)));
+        }
+        pos = comma + 1;
+    }
+    return out;
+}
+
+/**
+ * @brief 主函数：比较 select / poll / epoll 在"连接很多、每次只有少数活跃"这种典型负载下的开销。
+ * 用 socketpair 模拟 N 个连接（服务端一侧注册到 poller），每轮向随机的 K 个连接各写 1 字节，
+ * 然后等待并读完这 K 个就绪事件，统计每轮的平均耗时以及其中花在 wait 上的时间。
+ */
+int main(int argc, char** argv) {
+    std::vector<int> conns = {100, 1000, 10000, 50000};
+    int active = 10;
+    int rounds = 2000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--conns" && i + 1 < argc) {
+            conns = parse_list(argv[++i]);
+        } else if (arg == "--active" && i + 1 < argc) {
+            active = atoi(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--conns 100,1000,10000,50000] [--active K] [--rounds N]" << std::endl;
+            return 1;
+        }
+    }
+    size_t fd_limit = raise_fd_limit();
+    std::cout << "fd limit: " << fd_limit << ", active per round: " << active << std::endl;
+    std::cout << std::left << std::setw(8) << "conns" << std::setw(10) << "backend"
+              << std::right << std::setw(14) << "us/round" << std::setw(14) << "wait us" << std::setw(14) << "rounds/s" << std::endl;
+
+    std::mt19937 rng(12345);
+    for (int n : conns) {
+        if ((size_t)n * 2 + 16 > fd_limit) {
+            std::cout << std::left << std::setw(8) << n << "skipped: needs " << n * 2 << " fds" << std::endl;
+            continue;
+        }
+        // --- 1. 建立 N 对套接字：server[i] 注册到 poller，client[i] 用来制造事件 ---
+        std::vector<int> server(n), client(n);
+        for (int i = 0; i < n; i++) {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == -1) {
+                error_handling("socketpair() error");
+            }
+            server[i] = sv[0];
+            client[i] = sv[1];
+        }
+        int k = std::min(active, n);
+
+        for (const char* backend : {"select", "poll", "epoll"}) {
+            std::unique_ptr<Poller> poller = Poller::create(backend);
+            for (int fd : server) {
+                poller->add(fd, Poller::READ);
+            }
+            std::vector<PollEvent> events;
+            char byte = 'x';
+            char buf[64];
+            double wait_secs = 0; // 只算 wait 本身的时间，读写套接字的开销三种后端都一样
+
+            auto run_round = [&]() {
+                for (int j = 0; j < k; j++) {
+                    if (write(client[rng() % n], &byte, 1) != 1) {
+                        error_handling("write() error");
+                    }
+                }
+                // 一个连接可能在同一轮被挑中两次，所以按读到的字节数而不是事件数判断这一轮是否结束
+                int got = 0;
+                while (got < k) {
+                    auto t0 = std::chrono::steady_clock::now();
+                    int ready = poller->wait(events, -1);
+                    wait_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                    if (ready == -1 && errno != EINTR) {
+                        error_handling("wait() error");
+                    }
+                    for (const PollEvent& ev : events) {
+                        ssize_t r = read(ev.fd, buf, sizeof(buf));
+                        if (r > 0) {
+                            got += (int)r;
+                        }
+                    }
+                }
+            };
+
+            for (int r = 0; r < rounds / 10 + 1; r++) {
+                run_round(); // 预热
+            }
+            wait_secs = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++) {
+                run_round();
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << std::left << std::setw(8) << n << std::setw(10) << poller->name()
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(14) << secs * 1e6 / rounds
+                      << std::setw(14) << wait_secs * 1e6 / rounds
+                      << std::setprecision(0) << std::setw(14) << rounds / secs << std::endl;
+            for (int fd : server) {
+                poller->remove(fd);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            close(server[i]);
+            close(client[i]);
+        }
+    }
+    return 0;
+}
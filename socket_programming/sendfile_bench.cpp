@@ -0,0 +1,270 @@
+#include <cstring>                     // 包含内存操作函数，如 memset
+#include <iostream>                    // 包含标准输入输出流
+#include <iomanip>                     // 包含 std::setw，对齐输出表格
+#include <fstream>                     // 包含 std::ifstream，对比原来的读文件方式
+#include <string>                      // 包含 std::string
+#include <vector>                      // 包含 std::vector
+#include <thread>                      // 包含 std::thread，接收端线程
+#include <atomic>                      // 包含 std::atomic，接收端统计字节数
+#include <chrono>                      // 包含计时工具
+#include <sys/socket.h>                // 包含套接字相关的函数和结构体定义
+#include <netinet/in.h>                // 包含互联网地址族结构体（sockaddr_in）
+#include <arpa/inet.h>                 // 包含网络地址转换函数
+#include <unistd.h>                    // 包含 POSIX 操作系统 API，如 close, read, write
+#include <errno.h>                     // 包含错误码定义 (errno)
+#include <fcntl.h>                     // 包含 open
+#include <sys/stat.h>                  // 包含 fstat
+#include <sys/mman.h>                  // 包含 mmap
+#include <sys/uio.h>                   // 包含 writev
+#include <sys/sendfile.h>              // 包含 sendfile
+
+const size_t RECV_BUF_SIZE = 256 * 1024;           // 接收端每次读取的大小
+const size_t STREAM_BUF_SIZE = 64 * 1024;          // ifstream 方式的用户缓冲区大小
+const int64_t MIN_BYTES_PER_RUN = 512LL << 20;     // 每种方式至少发送这么多字节，小文件就多发几遍
+
+void error_handling(std::string message) {
+    std::cout << message << " (errno: " << errno << ")" << std::endl;
+    exit(1);
+}
+
+// 模拟 webserv_get 的响应头（内容不重要，只需要大小相近）
+const std::string HEADER = "HTTP/1.0 200 OK\r\nServer: Linux Web Server\r\n"
+                           "Content-Length: 0000000000\r\nContent-Type: text/html\r\n\r\n";
+
+std::atomic<int64_t> received(0);
+
+/**
+ * @brief 接收端：不停地读，只统计字节数。
+ */
+void drain(int sock) {
+    std::vector<char> buf(RECV_BUF_SIZE);
+    while (true) {
+        ssize_t n = read(sock, buf.data(), buf.size());
+        if (n <= 0) {
+            break;
+        }
+        received.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+bool send_all(int sock, const char* buf, size_t len, int flags) {
+    while (len > 0) {
+        ssize_t n = send(sock, buf, len, flags | MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief 方式一：原来的做法，ifstream 读到用户缓冲区再 send。
+ */
+void serve_ifstream(int sock, const std::string& path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    file.seekg(0, std::ios::beg);
+    send_all(sock, HEADER.data(), HEADER.size(), 0);
+    static thread_local std::vector<char> buf(STREAM_BUF_SIZE);
+    while (file.read(buf.data(), buf.size()) || file.gcount() > 0) {
+        send_all(sock, buf.data(), file.gcount(), 0);
+    }
+}
+
+/**
+ * @brief 方式二：头部 send(MSG_MORE)，正文 sendfile，数据不经过用户态。
+ */
+void serve_sendfile(int sock, const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    send_all(sock, HEADER.data(), HEADER.size(), MSG_MORE);
+    off_t offset = 0;
+    while (offset < st.st_size) {
+        ssize_t n = sendfile(sock, fd, &offset, st.st_size - offset);
+        if (n <= 0 && errno != EINTR) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief 方式三：mmap 映射文件，writev 一次提交头部和正文。
+ */
+void serve_mmap(int sock, const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        error_handling("mmap() error");
+    }
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)HEADER.data();
+    iov[0].iov_len = HEADER.size();
+    iov[1].iov_base = addr;
+    iov[1].iov_len = st.st_size;
+    int iovcnt = 2;
+    struct iovec* cur = iov;
+    while (iovcnt > 0) {
+        ssize_t n = writev(sock, cur, iovcnt);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        // 跳过已经完整写出的 iovec，调整写了一半的那个
+        while (iovcnt > 0 && (size_t)n >= cur->iov_len) {
+            n -= cur->iov_len;
+            cur++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            cur->iov_base = (char*)cur->iov_base + n;
+            cur->iov_len -= n;
+        }
+    }
+    munmap(addr, st.st_size);
+}
+
+/**
+ * @brief 解析 "4K"、"1M"、"1G" 这样的大小。
+ */
+int64_t parse_size(const std::string& s) {
+    int64_t v = std::stoll(s);
+    char unit = s.empty() ? 0 : s.back();
+    if (unit == 'K' || unit == 'k') v <<= 10;
+    if (unit == 'M' || unit == 'm') v <<= 20;
+    if (unit == 'G' || unit == 'g') v <<= 30;
+    return v;
+}
+
+void create_file(const std::string& path, int64_t size) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        error_handling("open() error: " + path);
+    }
+    std::vector<char> block(1 << 20);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = 'a' + i % 26;
+    }
+    int64_t left = size;
+    while (left > 0) {
+        ssize_t n = write(fd, block.data(), std::min<int64_t>(left, block.size()));
+        if (n <= 0) {
+            error_handling("write() error: " + path);
+        }
+        left -= n;
+    }
+    close(fd);
+}
+
+/**
+ * @brief 主函数：比较 webserv_get 发送静态文件的三种方式的吞吐量（MB/s）。
+ * 发送端和接收端通过回环 TCP 连接，每次"请求"都完整地打开、发送、关闭一次文件，
+ * 小文件重复发送直到总量达到 512 MB；文件在第一轮之前已经进入页缓存，测的是拷贝开销而不是磁盘。
+ */
+int main(int argc, char** argv) {
+    std::string dir = "/tmp";
+    std::vector<std::string> sizes = {"4K", "1M", "1G"};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            std::string list = argv[++i];
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) {
+                    comma = list.size();
+                }
+                if (comma > pos) {
+                    sizes.push_back(list.substr(pos, comma - pos));
+                }
+                pos = comma + 1;
+            }
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--dir DIR] [--sizes 4K,1M,1G]" << std::endl;
+            return 1;
+        }
+    }
+
+    // --- 1. 建立回环连接 ---
+    int listen_sock = socket(PF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0; // 由系统分配端口
+    if (bind(listen_sock, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(listen_sock, 1) == -1) {
+        error_handling("bind()/listen() error");
+    }
+    socklen_t addr_len = sizeof(addr);
+    getsockname(listen_sock, (struct sockaddr*)&addr, &addr_len);
+    int send_sock = socket(PF_INET, SOCK_STREAM, 0);
+    if (connect(send_sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        error_handling("connect() error");
+    }
+    int recv_sock = accept(listen_sock, NULL, NULL);
+    close(listen_sock);
+    std::thread receiver(drain, recv_sock);
+
+    struct Method {
+        const char* name;
+        void (*serve)(int, const std::string&);
+    };
+    const Method methods[] = {
+        {"ifstream+send", serve_ifstream},
+        {"sendfile", serve_sendfile},
+        {"mmap+writev", serve_mmap},
+    };
+
+    std::cout << std::left << std::setw(8) << "size" << std::setw(16) << "method"
+              << std::right << std::setw(10) << "requests" << std::setw(12) << "MB/s" << std::endl;
+
+    for (const auto& size_str : sizes) {
+        int64_t size = parse_size(size_str);
+        std::string path = dir + "/sendfile_bench_" + size_str + ".dat";
+        create_file(path, size);
+        int64_t requests = std::max<int64_t>(1, MIN_BYTES_PER_RUN / (size + (int64_t)HEADER.size()));
+
+        for (const auto& m : methods) {
+            // 预热：把文件读进页缓存，并等接收端读完，之前的数据都已收完，所以 base 是准确的
+            int64_t base = received.load() + size + (int64_t)HEADER.size();
+            m.serve(send_sock, path);
+            while (received.load() < base) {
+                std::this_thread::yield();
+            }
+            int64_t target = base + requests * (size + (int64_t)HEADER.size());
+
+            auto start = std::chrono::steady_clock::now();
+            for (int64_t r = 0; r < requests; r++) {
+                m.serve(send_sock, path);
+            }
+            while (received.load() < target) {
+                std::this_thread::yield();
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double mbps = (double)requests * size / secs / (1 << 20);
+            std::cout << std::left << std::setw(8) << size_str << std::setw(16) << m.name
+                      << std::right << std::setw(10) << requests
+                      << std::setw(12) << std::fixed << std::setprecision(1) << mbps << std::endl;
+        }
+        unlink(path.c_str());
+    }
+
+    shutdown(send_sock, SHUT_WR);
+    receiver.join();
+    close(send_sock);
+    close(recv_sock);
+    return 0;
+}
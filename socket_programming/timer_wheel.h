@@ -0,0 +1,295 @@
+#pragma once
+
+#include <climits>   // INT_MAX
+#include <cstddef>   // size_t
+#include <cstdint>   // int64_t, uint32_t, uint64_t
+#include <vector>    // std::vector
+
+/**
+ * @brief 分层时间轮：添加、重置、取消定时器都是 O(1)，用来给每个连接挂空闲 / 读 / 写超时。
+ *
+ * 时间以 tick（默认 10 ms）为单位，分四层：第 0 层 256 个槽，每个槽对应一个 tick；
+ * 第 1~3 层各 64 个槽，每个槽分别对应 256、256*64、256*64*64 个 tick，总共能表示 2^26 个 tick
+ * （10 ms 的 tick 约 7.7 天，更远的到期时间先放在最高层，轮到时再重新放置）。
+ * 每当第 0 层转完一圈，就把上一层对应槽里的定时器"降级"重新分配到下层（cascade），
+ * 所以每个定时器在到期前最多被搬动 3 次。
+ *
+ * 定时器存放在按下标管理的节点数组里，每个槽是一个带哨兵的双向循环链表；TimerId 带有代数，
+ * 定时器触发或取消后旧的 TimerId 自动失效，重复取消是安全的。
+ * 非线程安全：每个事件循环一个 TimerWheel。
+ *
+ * 典型用法（配合 epoll_wait）：
+ *   int n = epoll_wait(epfd, events, MAX_EVENTS, wheel.timeout_ms(now, -1));
+ *   ... 处理事件，有进展的连接调用 wheel.reset(conn.timer, now + timeout) ...
+ *   wheel.advance(now_ms(), [&](uint64_t fd) { 关闭连接 fd; });
+ */
+class TimerWheel {
+public:
+    using TimerId = uint64_t;
+    static constexpr TimerId INVALID = 0;
+
+    /**
+     * @param now_ms 当前时间（毫秒，单调时钟），作为时间轮的起点
+     * @param tick_ms 时间精度，定时器最多晚一个 tick 触发，绝不会提前
+     */
+    explicit TimerWheel(int64_t now_ms, uint32_t tick_ms = 10)
+        : tick_ms_(tick_ms > 0 ? tick_ms : 1), nodes_(FIRST_NODE) {
+        cur_ = now_ms / tick_ms_;
+        for (uint32_t i = 0; i < FIRST_NODE; i++) {
+            nodes_[i].prev = nodes_[i].next = i; // 哨兵：空的循环链表
+        }
+    }
+
+    /**
+     * @brief 添加一个在 deadline_ms 到期的定时器
+     * @param data 到期时原样交给回调（通常是 fd）
+     */
+    TimerId add(int64_t deadline_ms, uint64_t data) {
+        uint32_t n = allocate();
+        nodes_[n].expire = to_tick(deadline_ms);
+        nodes_[n].data = data;
+        place(n);
+        count_++;
+        return ((TimerId)nodes_[n].gen << 32) | n;
+    }
+
+    /**
+     * @brief 把定时器的到期时间改为 deadline_ms（TimerId 不变）
+     * @return bool 定时器已经触发或被取消时返回 false
+     */
+    bool reset(TimerId id, int64_t deadline_ms) {
+        uint32_t n = lookup(id);
+        if (n == 0) {
+            return false;
+        }
+        unlink(n);
+        nodes_[n].expire = to_tick(deadline_ms);
+        place(n);
+        return true;
+    }
+
+    /**
+     * @brief 取消定时器
+     * @return bool 定时器已经触发或被取消时返回 false
+     */
+    bool cancel(TimerId id) {
+        uint32_t n = lookup(id);
+        if (n == 0) {
+            return false;
+        }
+        unlink(n);
+        release(n);
+        count_--;
+        return true;
+    }
+
+    /**
+     * @brief 推进到 now_ms，对每个到期的定时器调用 on_expire(data)
+     *
+     * 回调里可以随意 add / reset / cancel（包括取消同一批里还没触发的定时器）；
+     * 回调里新加的已到期定时器会在下一次 advance 时触发，不会在本次循环里反复触发。
+     * @return size_t 触发的定时器个数
+     */
+    template <typename F>
+    size_t advance(int64_t now_ms, F&& on_expire) {
+        int64_t target = now_ms / tick_ms_; // tick <= target 的定时器都已到期
+        size_t fired = 0;
+        while (cur_ <= target) {
+            if (count_ == 0) {
+                cur_ = target + 1; // 没有定时器，直接跳过中间的 tick
+                break;
+            }
+            uint32_t idx = (uint32_t)(cur_ & L0_MASK);
+            // 先把整槽摘到 DRAIN 链表上再推进 cur_，回调里新加的定时器就不会落回这个槽
+            splice(idx, DRAIN);
+            occupied_[idx / 64] &= ~(1ULL << (idx % 64));
+            cur_++;
+            if ((cur_ & L0_MASK) == 0) {
+                // 第 0 层转完一圈：立即把上层对应槽里的定时器降级（而不是等处理下一个 tick 时），
+                // 这样 timeout_ms 看到的第 0 层总是完整的；某层的槽下标也回到 0 时继续向上
+                for (int level = 1; level < LEVELS; level++) {
+                    uint32_t slot = (uint32_t)((cur_ >> (L0_BITS + (level - 1) * LN_BITS)) & LN_MASK);
+                    cascade(L0_SIZE + (level - 1) * LN_SIZE + slot);
+                    if (slot != 0) {
+                        break;
+                    }
+                }
+            }
+            while (nodes_[DRAIN].next != DRAIN) {
+                uint32_t n = nodes_[DRAIN].next;
+                uint64_t data = nodes_[n].data;
+                unlink(n);
+                release(n);
+                count_--;
+                fired++;
+                on_expire(data);
+            }
+        }
+        return fired;
+    }
+
+    /**
+     * @brief 距离下一次需要调用 advance 还有多少毫秒，直接作为 epoll_wait 的超时
+     *
+     * 第 0 层用位图找最近的非空槽；第 0 层在本圈内没有定时器时，返回到下一次降级（本圈结束）的时间，
+     * 所以只有远期定时器时最多每 256 个 tick 醒来一次。
+     * @param max_ms 上限，-1 表示没有定时器时一直等
+     */
+    int timeout_ms(int64_t now_ms, int max_ms) const {
+        if (count_ == 0) {
+            return max_ms;
+        }
+        uint32_t idx = (uint32_t)(cur_ & L0_MASK);
+        int64_t next = (cur_ | L0_MASK) + 1; // 下一次降级的 tick
+        for (uint32_t word = idx / 64; word < L0_SIZE / 64; word++) {
+            uint64_t bits = occupied_[word];
+            if (word == idx / 64) {
+                bits &= ~0ULL << (idx % 64); // 本圈已经走过的槽存放的是下一圈的定时器
+            }
+            if (bits != 0) {
+                next = cur_ - idx + word * 64 + __builtin_ctzll(bits);
+                break;
+            }
+        }
+        int64_t wait = next * tick_ms_ - now_ms;
+        if (wait < 0) {
+            wait = 0;
+        }
+        if (max_ms >= 0 && wait > max_ms) {
+            wait = max_ms;
+        }
+        return wait > INT_MAX ? INT_MAX : (int)wait;
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int L0_BITS = 8;
+    static constexpr int LN_BITS = 6;
+    static constexpr uint32_t L0_SIZE = 1u << L0_BITS;
+    static constexpr uint32_t LN_SIZE = 1u << LN_BITS;
+    static constexpr int64_t L0_MASK = L0_SIZE - 1;
+    static constexpr int64_t LN_MASK = LN_SIZE - 1;
+    static constexpr int64_t MAX_DELTA = 1LL << (L0_BITS + (LEVELS - 1) * LN_BITS); // 能表示的最远 tick 数
+    static constexpr uint32_t SLOTS = L0_SIZE + (LEVELS - 1) * LN_SIZE;
+    static constexpr uint32_t DRAIN = SLOTS;          // 正在触发的那一槽临时挂在这里
+    static constexpr uint32_t FIRST_NODE = SLOTS + 1; // 之前的下标都是哨兵
+    static constexpr uint32_t FREE = UINT32_MAX;      // Node::list 的取值：节点空闲
+
+    struct Node {
+        uint32_t prev = 0;
+        uint32_t next = 0;
+        uint32_t gen = 1;     // 代数：节点每次回收加一，使旧的 TimerId 失效
+        uint32_t list = FREE; // 所在链表的哨兵下标（哨兵自身不会用到这个字段）
+        int64_t expire = 0;   // 到期 tick
+        uint64_t data = 0;
+    };
+
+    int64_t to_tick(int64_t deadline_ms) const {
+        return (deadline_ms + tick_ms_ - 1) / tick_ms_; // 向上取整，保证不会提前触发
+    }
+
+    uint32_t lookup(TimerId id) const {
+        uint32_t n = (uint32_t)id;
+        if (n < FIRST_NODE || n >= nodes_.size() || nodes_[n].gen != (uint32_t)(id >> 32) || nodes_[n].list == FREE) {
+            return 0;
+        }
+        return n;
+    }
+
+    uint32_t allocate() {
+        if (free_head_ != 0) {
+            uint32_t n = free_head_;
+            free_head_ = nodes_[n].next;
+            return n;
+        }
+        nodes_.emplace_back();
+        return (uint32_t)nodes_.size() - 1;
+    }
+
+    void release(uint32_t n) {
+        nodes_[n].list = FREE;
+        nodes_[n].gen++;
+        if (nodes_[n].gen == 0) {
+            nodes_[n].gen = 1; // TimerId 永远不为 0
+        }
+        nodes_[n].next = free_head_;
+        free_head_ = n;
+    }
+
+    // 根据到期 tick 与当前 tick 的距离选择层和槽，挂到链表尾部
+    void place(uint32_t n) {
+        int64_t expire = nodes_[n].expire < cur_ ? cur_ : nodes_[n].expire;
+        int64_t delta = expire - cur_;
+        uint32_t list;
+        if (delta < (int64_t)L0_SIZE) {
+            list = (uint32_t)(expire & L0_MASK);
+            occupied_[list / 64] |= 1ULL << (list % 64);
+        } else {
+            if (delta >= MAX_DELTA) {
+                expire = cur_ + MAX_DELTA - 1; // 太远：先放在最高层最远的槽，真实的 expire 保持不变
+                delta = MAX_DELTA - 1;
+            }
+            int level = 1;
+            while (delta >= 1LL << (L0_BITS + level * LN_BITS)) {
+                level++;
+            }
+            list = L0_SIZE + (level - 1) * LN_SIZE
+                 + (uint32_t)((expire >> (L0_BITS + (level - 1) * LN_BITS)) & LN_MASK);
+        }
+        link(list, n);
+    }
+
+    void link(uint32_t list, uint32_t n) {
+        uint32_t tail = nodes_[list].prev;
+        nodes_[n].prev = tail;
+        nodes_[n].next = list;
+        nodes_[n].list = list;
+        nodes_[tail].next = n;
+        nodes_[list].prev = n;
+    }
+
+    void unlink(uint32_t n) {
+        uint32_t list = nodes_[n].list;
+        nodes_[nodes_[n].prev].next = nodes_[n].next;
+        nodes_[nodes_[n].next].prev = nodes_[n].prev;
+        if (list < L0_SIZE && nodes_[list].next == list) {
+            occupied_[list / 64] &= ~(1ULL << (list % 64));
+        }
+    }
+
+    // 把 from 链表整体移到空的 to 链表上
+    void splice(uint32_t from, uint32_t to) {
+        if (nodes_[from].next == from) {
+            return;
+        }
+        uint32_t first = nodes_[from].next;
+        uint32_t last = nodes_[from].prev;
+        nodes_[to].next = first;
+        nodes_[to].prev = last;
+        nodes_[first].prev = to;
+        nodes_[last].next = to;
+        nodes_[from].prev = nodes_[from].next = from;
+        for (uint32_t n = first; n != to; n = nodes_[n].next) {
+            nodes_[n].list = to;
+        }
+    }
+
+    // 把上层某个槽里的定时器按当前时间重新放置（它们会落到更低的层）
+    void cascade(uint32_t list) {
+        while (nodes_[list].next != list) {
+            uint32_t n = nodes_[list].next;
+            unlink(n);
+            place(n);
+        }
+    }
+
+    int64_t tick_ms_;
+    int64_t cur_;                       // 下一个要处理的 tick
+    size_t count_ = 0;
+    uint32_t free_head_ = 0;            // 空闲节点链表（用 next 串起来），0 表示空
+    std::vector<Node> nodes_;           // [0, FIRST_NODE) 是哨兵，之后是定时器节点
+    uint64_t occupied_[L0_SIZE / 64] = {}; // 第 0 层哪些槽非空
+};
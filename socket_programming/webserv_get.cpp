@@ -12,14 +12,52 @@
 #include <netinet/in.h> // 包含互联网协议地址结构，如 sockaddr_in
 #include <unistd.h>     // Unix 标准函数定义，如 read, write, close
 #include <arpa/inet.h>  // IP地址转换函数，如 inet_ntop, htons, htonl
-#include <thread>       // C++11 多线程库
-#include <fstream>
+#include <thread>       // C++11 多线程库，多 worker 时每个线程一个事件循环
+#include <mutex>        // 多个 worker 共享 cout，日志需要加锁
+#include <condition_variable> // 后台压缩线程等待任务
 #include <sstream>
+#include <errno.h>      // 错误码定义 (errno)
+#include <fcntl.h>      // open
+#include <sys/stat.h>   // fstat，获取文件大小
+#include <sys/sendfile.h> // sendfile，文件内容在内核中直接拷贝到套接字
+#include <sys/epoll.h>  // epoll 事件循环
+#include <string_view>  // std::string_view，请求解析结果直接引用读缓冲区
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <chrono>       // 超时计时
+#include <ctime>        // strptime, timegm，解析 If-Modified-Since
+#include <deque>        // 每个连接的待发送数据段队列
+#include <memory>       // std::unique_ptr
+#include <unordered_map> // fd -> 连接状态
+#include <unordered_set> // 正在后台压缩的文件
+#include <sys/eventfd.h> // 后台压缩完成后通知事件循环
+#include <vector>
+#include <algorithm>    // std::min
+#include <sys/uio.h>    // struct iovec，多个内存段一次 sendmsg 发出
+#include "http_parser.h" // 增量式请求解析器和每连接读缓冲区
+#include "file_cache.h"  // 热点文件缓存（内容 + 预先序列化的响应头）
+#include "mime_types.h"  // 扩展名 -> Content-Type 的编译期完美哈希表
+#include "access_log.h"  // 每线程无锁环形缓冲区 + 后台刷写的访问日志
+#include "timer_wheel.h" // 分层时间轮，每个连接一个 O(1) 的超时定时器
+#include <zlib.h>       // gzip 压缩
 // ===================================================================================
 // 全局变量定义
 // ===================================================================================
 
-const int BUF_SIZE = 1024; // 消息缓冲区的大小，用于存储从客户端读取的数据
+const int MAX_EVENTS = 1024;    // epoll 单次调用最多可返回的事件数量
+const size_t MAX_PIPELINE = 16; // 一个连接最多同时排队多少个尚未发完的响应，超过后暂停解析后续的流水线请求
+const int MAX_IOV = 16;         // 一次 sendmsg 最多合并多少个内存段
+const size_t MAX_GZIP_BYTES = 4 << 20; // 超过这个大小的文件不做实时压缩
+const size_t INLINE_GZIP_BYTES = 64 << 10; // 不超过这个大小的文件直接在事件循环里压缩（约 1ms），更大的交给后台线程，压缩完成前先发送原文件
+const size_t MAX_RANGES = 16;   // 一个 Range 请求最多包含多少个区间，更多时忽略 Range 返回整个文件
+const char* const BYTERANGES_BOUNDARY = "WEBSERV_GET_BYTERANGES_7f3a9c1e"; // multipart/byteranges 的分隔符
+
+int idle_timeout_sec = 5;     // 长连接两个请求之间最多空闲多少秒（--idle-timeout）
+int header_timeout_sec = 10;  // 一个请求从收到第一个字节起多少秒内必须收完请求头（--header-timeout），防止 slowloris
+int send_timeout_sec = 30;    // 发送响应时多少秒没有任何进展就关闭（--send-timeout），对端不收数据时不再占着 fd 和缓冲区
+bool quiet = false;       // --quiet: 关闭逐请求日志，压测时避免 cout 成为瓶颈
+size_t cache_bytes = 64 << 20; // 热点文件缓存的总预算（--cache-mb），平分给各个 worker，0 表示不缓存
+std::mutex log_mtx;       // 多个 worker 线程共享 cout，需要加锁避免输出交错
+std::unique_ptr<AccessLog> access_log; // --access-log FILE：结构化访问日志，为空表示不记录
 // ===================================================================================
 // 辅助函数定义
 // ===================================================================================
@@ -35,25 +73,156 @@ void error_handling(std::string message) {
     exit(1);
 }
 
-std::string socket_read_line(int socket_fd) { 
-    std::string line;
-    char c;
-    ssize_t len;
-    while((len  = recv(socket_fd, &c, 1, 0)) > 0) {
-       line += c;
-       if(c == '\n') {
-           break;
-       }
+/**
+ * @brief 线程安全的日志输出，--quiet 时直接忽略
+ */
+void log_line(const std::string& line) {
+    if (quiet) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(log_mtx);
+    std::cout << line << std::endl;
+}
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ===================================================================================
+// 连接状态
+// ===================================================================================
+
+/**
+ * @brief 一段待发送的响应数据：要么是内存中的字节（响应头、错误页、缓存的文件内容），要么是文件的一个区间（响应正文）。
+ * 文件段持有打开的 fd，段被发送完或连接关闭时自动关闭；
+ * 引用缓存的内存段持有缓存项的 shared_ptr，即使缓存项在发送途中被淘汰，内容也保持有效。
+ */
+struct OutSegment {
+    std::string data;  // 内存段的内容（自己持有）
+    std::shared_ptr<const FileCache::Entry> entry; // 内存段的内容（引用缓存项），此时内容为 [ptr, ptr + len)
+    const char* ptr = nullptr;
+    size_t len = 0;
+    int file_fd = -1;  // 文件段：要发送的文件
+    off_t offset = 0;  // 内存段：已发送的字节数；文件段：下一个要发送的文件位置
+    off_t end = 0;     // 文件段：发送到哪里为止
+    bool last = false; // 是否是一个响应的最后一段
+
+    OutSegment() = default;
+    OutSegment(const OutSegment&) = delete;
+    OutSegment& operator=(const OutSegment&) = delete;
+    OutSegment(OutSegment&& other) noexcept
+        : data(std::move(other.data)), entry(std::move(other.entry)), ptr(other.ptr), len(other.len),
+          file_fd(other.file_fd), offset(other.offset), end(other.end), last(other.last) {
+        other.file_fd = -1;
+    }
+    OutSegment& operator=(OutSegment&& other) noexcept {
+        if (this != &other) {
+            if (file_fd != -1) {
+                close(file_fd);
+            }
+            data = std::move(other.data);
+            entry = std::move(other.entry);
+            ptr = other.ptr;
+            len = other.len;
+            file_fd = other.file_fd;
+            offset = other.offset;
+            end = other.end;
+            last = other.last;
+            other.file_fd = -1;
+        }
+        return *this;
+    }
+    ~OutSegment() {
+        if (file_fd != -1) {
+            close(file_fd);
+        }
+    }
+
+    bool is_file() const { return file_fd != -1; }
+    const char* mem_data() const { return entry ? ptr : data.data(); }
+    size_t mem_size() const { return entry ? len : data.size(); }
+    bool done() const { return is_file() ? offset >= end : (size_t)offset >= mem_size(); }
+};
+
+class GzipCompressor;
+
+/**
+ * @brief 每个连接的状态机。
+ * 读请求：数据读入 rbuf，由 parser 增量解析；
+ * 发送响应头 / 发送正文：每个解析完的请求把它的响应头（内存段）和正文（文件段）追加到 out，
+ * 队首是当前正在发送的段。out 为空时连接处于读请求状态，套接字写不动时等待 EPOLLOUT。
+ */
+struct Connection {
+    int fd;
+    HttpReadBuffer rbuf;           // 读缓冲区（整个连接期间复用）
+    HttpRequestParser parser;      // 增量解析器
+    HttpRequest req;               // 当前解析出的请求
+    std::deque<OutSegment> out;    // 待发送的数据段，按请求顺序排列，保证流水线响应不乱序
+    size_t responses_queued = 0;   // out 中还没发完的响应个数
+    bool closing = false;          // 发完 out 之后关闭（Connection: close 或出错）
+    bool peer_closed = false;      // 对端已经关闭写方向，发完已排队的响应后关闭
+    uint32_t events = 0;           // 当前在 epoll 中关注的事件
+    TimerWheel::TimerId timer = TimerWheel::INVALID; // 当前状态（空闲 / 收请求头 / 发送）对应的超时定时器
+    int64_t header_deadline_ms = 0; // 正在接收的请求必须在此之前收完，0 表示当前没有收到一半的请求
+    FileCache* cache;              // 所属 worker 的文件缓存（可能为空）
+    GzipCompressor* gzip;          // 所属 worker 的后台压缩线程（没有缓存时为空）
+    std::string file_name;         // 请求的文件名，复用同一块内存，避免每个请求都分配
+    std::string cache_key;         // 压缩版本的缓存键，同样复用
+    AccessLog::Ring* log_ring = nullptr;   // 所属 worker 的访问日志缓冲区（为空表示不记录）
+    std::deque<AccessRecord> pending_log;  // 已排队、还没发完的响应的日志记录，和响应一一对应
+
+    Connection(int sock, FileCache* c, GzipCompressor* g) : fd(sock), cache(c), gzip(g) {}
+};
+
+// ===================================================================================
+// 响应构造
+// ===================================================================================
+
+/**
+ * @brief 连接响应头：告诉客户端这个连接在响应之后是否保持
+ */
+const char* connection_header(bool keep_alive) {
+    return keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+}
+
+/**
+ * @brief 追加一个缓存项中的内存段（响应头或正文），不拷贝内容
+ */
+void queue_cached(Connection& conn, const std::shared_ptr<const FileCache::Entry>& entry,
+                  const char* ptr, size_t len, bool last) {
+    OutSegment seg;
+    seg.entry = entry;
+    seg.ptr = ptr;
+    seg.len = len;
+    seg.last = last;
+    conn.out.push_back(std::move(seg));
+    if (last) {
+        conn.responses_queued++;
     }
-    return line;
 }
 
+void queue_memory(Connection& conn, std::string data, bool last) {
+    OutSegment seg;
+    seg.data = std::move(data);
+    seg.last = last;
+    conn.out.push_back(std::move(seg));
+    if (last) {
+        conn.responses_queued++;
+    }
+}
 
 /**
- * @brief 发送一个格式正确的 HTTP 400 错误响应
- * @param socket_fd 客户端的套接字文件描述符
+ * @brief 生成一个格式正确的 HTTP 400 错误响应
+ * @param conn 客户端连接
+ * @param keep_alive 响应后是否保持连接
  */
-void send_error(int socket_fd) {
+void send_error(Connection& conn, bool keep_alive) {
 
     std::stringstream body_ss;
     body_ss << "<!DOCTYPE html>\n"
@@ -68,224 +237,1316 @@ void send_error(int socket_fd) {
     std::string body = body_ss.str();
 
     std::stringstream header_ss;
-    header_ss << "HTTP/1.0 400 Bad Request\r\n"
+    header_ss << "HTTP/1.1 400 Bad Request\r\n"
               << "Server: Linux Web Server\r\n"
               << "Content-Length: " << body.size() << "\r\n"
               << "Content-Type: text/html; charset=utf-8\r\n"
+              << connection_header(keep_alive)
               << "\r\n";
 
-    std::string header = header_ss.str();
+    // 头和体放在同一个内存段里，一次 send 发出
+    queue_memory(conn, header_ss.str() + body, true);
+    if (!keep_alive) {
+        conn.closing = true;
+    }
+}
 
-    // 发送头和体
-    // data() 返回 char* 指针，size() 返回长度
-    send(socket_fd, header.c_str(), header.size(), 0);
-    send(socket_fd, body.c_str(), body.size(), 0);
+/**
+ * @brief 兜底路径：用 pread 把文件段 [offset, end) 读进内存
+ * 只在 sendfile 不可用（例如文件所在的文件系统不支持）时使用。
+ * @param offset 从文件的哪个位置开始读（sendfile 可能已经发出了一部分）
+ * @param end 文件段的结束位置（Range 请求的区间不一定到文件末尾）
+ * @param out 读到的内容
+ * @return bool 读到了完整的 end - offset 字节返回 true
+ */
+bool read_file_range(int fd, off_t offset, off_t end, std::string &out) {
+    out.resize(end - offset);
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = pread(fd, &out[done], out.size() - done, offset + done);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false; // 出错或文件被截断
+        }
+        done += n;
+    }
+    return true;
+}
 
+/**
+ * @brief 这种类型的内容是否值得压缩（文本类）；图片、视频等本身已经压缩过
+ */
+bool is_compressible(std::string_view ct) {
+    auto ends_with = [ct](std::string_view suffix) {
+        return ct.size() >= suffix.size() && ct.substr(ct.size() - suffix.size()) == suffix;
+    };
+    return ct.substr(0, 5) == "text/" || ct == "application/javascript" || ct == "application/json"
+           || ct == "application/xml" || ct == "application/wasm" || ends_with("+json") || ends_with("+xml");
 }
 
-void send_data(int clnt_sock, std::string &ct, const std::string &file_name) {
-   
+/**
+ * @brief 客户端的 Accept-Encoding 是否接受 gzip（"gzip;q=0" 表示明确拒绝）
+ */
+bool accepts_gzip(std::string_view ae) {
+    while (!ae.empty()) {
+        size_t comma = ae.find(',');
+        std::string_view token = ae.substr(0, comma);
+        ae = comma == std::string_view::npos ? std::string_view() : ae.substr(comma + 1);
 
-    // --- 1. 打开文件并检查 ---
-    std::ifstream send_file(file_name, std::ios::ate |  std::ios::binary);
-    if (!send_file) {
-        std::cout << "File not found" << std::endl;
-        send_error(clnt_sock);
-        return;
+        size_t semi = token.find(';');
+        std::string_view name = token.substr(0, semi);
+        while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+        if (!HttpRequest::iequals(name, "gzip") && !HttpRequest::iequals(name, "x-gzip") && name != "*") {
+            continue;
+        }
+        if (semi == std::string_view::npos) {
+            return true;
+        }
+        size_t q = token.find("q=", semi);
+        if (q == std::string_view::npos) {
+            return true;
+        }
+        // q 值只有 "0"、"0.0"、"0.00"... 表示拒绝
+        std::string_view qv = token.substr(q + 2);
+        for (char c : qv) {
+            if (c >= '1' && c <= '9') {
+                return true;
+            }
+            if (c != '0' && c != '.') {
+                break;
+            }
+        }
+        return false;
     }
-    // --- 2. 动态计算文件大小 ---
-   std::streamsize file_size = send_file.tellg();
-   send_file.seekg(0, std::ios::beg); // 将文件指针移到文件开头
+    return false;
+}
 
-    // --- 3. 构建并发送完整的、正确的HTTP头部 ---
-   std::stringstream header_ss;
-   header_ss << "HTTP/1.0 200 OK\r\n"
-             << "Server: Linux Web Server\r\n"
-             << "Content-Length: " << file_size << "\r\n"
-             << "Content-Type: " << ct << "\r\n"
-             << "\r\n";
-    
-    
-    // --- 4. 发送头部和正文之间的空行
-    std::string header = header_ss.str();
-    send(clnt_sock, header.c_str(), header.size(), 0);
-    
-    // --- 5. 发送文件内容 ---
-    // 确保所有内容都被发送出去
-    char buf[BUF_SIZE];
-    while (send_file.read(buf, BUF_SIZE) || send_file.gcount() > 0) {
-        send(clnt_sock, buf, send_file.gcount(), 0);
+/**
+ * @brief 用 zlib 把一段数据压缩成 gzip 格式
+ */
+bool gzip_compress(const char* data, size_t len, std::string& out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // windowBits = 15 + 16 表示输出 gzip 封装（而不是裸的 zlib/deflate 流）
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
     }
-  
+    out.resize(deflateBound(&zs, len));
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = len;
+    zs.next_out = (Bytef*)&out[0];
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
 
+/**
+ * @brief 每个 worker 一个后台压缩线程：较大的文件不在事件循环里压缩，避免卡住这个 worker 的所有连接。
+ * 事件循环提交任务后照常发送原文件；压缩结果放进完成队列，再通过 eventfd 通知事件循环，
+ * 由事件循环自己放进缓存（缓存不是线程安全的）。submit / take_done 只在事件循环线程调用。
+ */
+class GzipCompressor {
+public:
+    struct Job {
+        std::string key;        // 压缩版本的缓存键
+        std::string file_name;
+        std::shared_ptr<const FileCache::Entry> plain; // 原文件的缓存项，压缩期间保证内容不被释放
+        std::string data;       // 压缩结果
+        bool ok = false;
+    };
 
-  
+    GzipCompressor() {
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ != -1) {
+            thread_ = std::thread(&GzipCompressor::run, this);
+        }
+    }
+
+    ~GzipCompressor() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (event_fd_ != -1) {
+            close(event_fd_);
+        }
+    }
+
+    /// 加入事件循环的 fd，可读表示有压缩完成的任务；-1 表示后台线程不可用
+    int event_fd() const { return event_fd_; }
+
+    /**
+     * @brief 提交一个压缩任务；同一个缓存键已经在压缩时不重复提交
+     * @return 后台线程不可用时返回 false
+     */
+    bool submit(const std::string& key, const std::string& file_name,
+                const std::shared_ptr<const FileCache::Entry>& plain) {
+        if (event_fd_ == -1) {
+            return false;
+        }
+        if (!pending_.insert(key).second) {
+            return true;
+        }
+        Job job;
+        job.key = key;
+        job.file_name = file_name;
+        job.plain = plain;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 取出所有已经完成的任务（event_fd 可读时调用）
+     */
+    std::vector<Job> take_done() {
+        uint64_t n;
+        while (read(event_fd_, &n, sizeof(n)) == sizeof(n)) {
+        }
+        std::vector<Job> done;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            done.swap(done_);
+        }
+        for (const Job& job : done) {
+            pending_.erase(job.key);
+        }
+        return done;
+    }
+
+private:
+    /**
+     * @brief 重新打开缓存项的来源文件并读出全部内容；文件已经变化（大小或 mtime 不同）或被截断时返回 false
+     */
+    static bool read_source(const FileCache::Entry& plain, std::string& out) {
+        int fd = open(plain.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size == plain.source_size
+                  && st.st_mtim.tv_sec == plain.mtime.tv_sec && st.st_mtim.tv_nsec == plain.mtime.tv_nsec
+                  && read_file_range(fd, 0, st.st_size, out);
+        close(fd);
+        return ok;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (stop_) {
+                return;
+            }
+            Job job = std::move(jobs_.front());
+            jobs_.pop_front();
+            lock.unlock();
+            if (job.plain->map != nullptr) {
+                // mmap 的内容在用户态读取时，文件被截断会收到 SIGBUS；自己用 pread 读一份再压缩
+                std::string copy;
+                job.ok = read_source(*job.plain, copy) && gzip_compress(copy.data(), copy.size(), job.data);
+            } else {
+                job.ok = gzip_compress(job.plain->body, job.plain->size, job.data);
+            }
+            lock.lock();
+            done_.push_back(std::move(job));
+            uint64_t one = 1;
+            (void)!write(event_fd_, &one, sizeof(one));
+        }
+    }
+
+    int event_fd_ = -1;
+    std::thread thread_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;              // 等待压缩的任务
+    std::vector<Job> done_;             // 已经压缩完、等事件循环取走的任务
+    bool stop_ = false;
+    std::unordered_set<std::string> pending_; // 已提交还没取走的缓存键（只在事件循环线程访问）
+};
+
+// ===================================================================================
+// 条件请求
+// ===================================================================================
+
+/**
+ * @brief 把强 ETag 变成弱 ETag（"xxx" -> W/"xxx"），用于按内容编码转换过的表示
+ */
+std::string weak_etag(const std::string& etag) {
+    return etag.compare(0, 2, "W/") == 0 ? etag : "W/" + etag;
+}
+
+/**
+ * @brief 按弱比较判断 If-None-Match 的列表里是否有 etag（或者是 "*"）
+ */
+bool etag_matches(std::string_view list, std::string_view etag) {
+    auto strip_weak = [](std::string_view t) {
+        return t.size() >= 2 && t[0] == 'W' && t[1] == '/' ? t.substr(2) : t;
+    };
+    etag = strip_weak(etag);
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view tag = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) tag.remove_prefix(1);
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) tag.remove_suffix(1);
+        if (tag == "*" || strip_weak(tag) == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 判断客户端缓存的版本是否仍然有效。
+ * 有 If-None-Match 时只看它；否则看 If-Modified-Since（先直接和 Last-Modified 比较字符串，
+ * 浏览器通常原样发回，不同时才解析日期）。
+ */
+bool not_modified(const HttpRequest& req, const FileCache::Meta& meta) {
+    std::string_view inm = req.header("If-None-Match");
+    if (!inm.empty()) {
+        return etag_matches(inm, meta.etag);
+    }
+    std::string_view ims = req.header("If-Modified-Since");
+    if (ims.empty()) {
+        return false;
+    }
+    if (ims == meta.last_modified) {
+        return true;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    std::string date(ims);
+    const char* end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr || *end != '\0') {
+        return false; // 日期格式不对，按规范忽略这个头
+    }
+    return meta.mtime.tv_sec <= timegm(&tm);
+}
+
+/**
+ * @brief 生成 304 响应：没有正文，只带验证器
+ */
+void send_not_modified(Connection& conn, const std::string& etag, const std::string& last_modified,
+                       bool vary, bool keep_alive) {
+    std::stringstream header_ss;
+    header_ss << "HTTP/1.1 304 Not Modified\r\n"
+              << "Server: Linux Web Server\r\n"
+              << "ETag: " << etag << "\r\n"
+              << "Last-Modified: " << last_modified << "\r\n";
+    if (vary) {
+        header_ss << "Vary: Accept-Encoding\r\n";
+    }
+    header_ss << connection_header(keep_alive)
+              << "\r\n";
+    queue_memory(conn, header_ss.str(), true);
+    if (!keep_alive) {
+        conn.closing = true;
+    }
+}
+
+/**
+ * @brief 序列化一个文件的 200 响应头
+ * @param etag / last_modified 验证器，客户端之后用 If-None-Match / If-Modified-Since 重新验证
+ * @param encoding 非空时加上 Content-Encoding（例如 "gzip"）
+ * @param vary 内容会按 Accept-Encoding 协商时加上 Vary，避免中间缓存把压缩版本发给不支持的客户端
+ */
+std::string file_header(std::string_view ct, off_t file_size, bool keep_alive,
+                        const std::string& etag, const std::string& last_modified,
+                        const char* encoding = nullptr, bool vary = false) {
+    std::stringstream header_ss;
+    header_ss << "HTTP/1.1 200 OK\r\n"
+              << "Server: Linux Web Server\r\n"
+              << "Content-Length: " << file_size << "\r\n"
+              << "Content-Type: " << ct << "\r\n"
+              << "ETag: " << etag << "\r\n"
+              << "Last-Modified: " << last_modified << "\r\n";
+    if (encoding != nullptr) {
+        header_ss << "Content-Encoding: " << encoding << "\r\n";
+    } else {
+        header_ss << "Accept-Ranges: bytes\r\n"; // 原始内容支持 Range 请求
+    }
+    if (vary) {
+        header_ss << "Vary: Accept-Encoding\r\n";
+    }
+    header_ss << connection_header(keep_alive)
+              << "\r\n";
+    return header_ss.str();
 }
 
+/**
+ * @brief 把一个缓存项（响应头 + 正文）追加到发送队列
+ */
+void queue_entry(Connection& conn, const std::shared_ptr<const FileCache::Entry>& entry, bool keep_alive) {
+    const std::string& header = entry->header(keep_alive);
+    queue_cached(conn, entry, header.data(), header.size(), entry->size == 0);
+    if (entry->size > 0) {
+        queue_cached(conn, entry, entry->body, entry->size, true);
+    }
+    if (!keep_alive) {
+        conn.closing = true;
+    }
+}
 
+/**
+ * @brief 把实时压缩的结果放入缓存
+ * @param data 压缩后的内容
+ * @return 压缩版本；压缩后没有变小时返回 nullptr，并在原文件的缓存项上记下不值得压缩，以后直接发送原文件
+ */
+std::shared_ptr<const FileCache::Entry> insert_gzip(FileCache& cache, const std::string& key, const std::string& file_name,
+                                                    const std::shared_ptr<const FileCache::Entry>& plain,
+                                                    std::string&& data, int64_t now) {
+    if (data.size() >= plain->size) {
+        plain->incompressible = true;
+        return nullptr;
+    }
+    std::string_view ct = mime_type(file_name);
+    auto gz = std::make_shared<FileCache::Entry>();
+    gz->path = file_name;
+    gz->source_size = plain->source_size;
+    gz->mtime = plain->mtime;
+    gz->checked_ms = now;
+    gz->data = std::move(data);
+    gz->size = gz->data.size();
+    gz->etag = weak_etag(plain->etag);
+    gz->last_modified = plain->last_modified;
+    gz->header_keep_alive = file_header(ct, gz->size, true, gz->etag, gz->last_modified, "gzip", true);
+    gz->header_close = file_header(ct, gz->size, false, gz->etag, gz->last_modified, "gzip", true);
+    // 依赖 .gz 文件：之后有人放上预压缩版本时让实时压缩的结果失效
+    return cache.insert(key, {file_name, file_name + ".gz"}, gz);
+}
 
 /**
- * @brief 根据文件名确定 Content-Type
- * @param file 文件名
- * @return 对应的 MIME 类型字符串
- * 这个版本更健壮，能正确处理无扩展名或以点开头的文件。
+ * @brief 取得文件的 gzip 版本并放入缓存：优先使用预先压缩好的 "<文件>.gz"，没有时实时压缩
+ * @param plain 原文件的缓存项
+ * @return gzip 版本；文件太大或压缩后不会变小、或者正在后台压缩时返回 nullptr，由调用者发送原文件
+ * 压缩版本的验证器沿用原文件的（ETag 变为弱 ETag），这样两种表示可以用同一个 If-None-Match 重新验证。
  */
-std::string content_type(const std::string& file) {
-   size_t dot_pos = file.find_last_of(".");
-   if (dot_pos == std::string::npos || dot_pos == 0) {
-       return "text/plain";
-   }
+std::shared_ptr<const FileCache::Entry> load_gzip(Connection& conn, const std::string& file_name,
+                                                  const std::shared_ptr<const FileCache::Entry>& plain, int64_t now) {
+    std::string_view ct = mime_type(file_name);
+    std::string gz_name = file_name + ".gz";
+    auto init = [&ct, &plain](FileCache::Entry& e) {
+        e.etag = weak_etag(plain->etag);
+        e.last_modified = plain->last_modified;
+        e.header_keep_alive = file_header(ct, e.size, true, e.etag, e.last_modified, "gzip", true);
+        e.header_close = file_header(ct, e.size, false, e.etag, e.last_modified, "gzip", true);
+    };
 
+    // --- 1. 预先压缩好的同名 .gz 文件 ---
+    std::shared_ptr<const FileCache::Entry> entry =
+        conn.cache->load_as(conn.cache_key, gz_name, {gz_name, file_name}, now, init);
+    if (entry || plain->size > MAX_GZIP_BYTES || plain->incompressible) {
+        return entry;
+    }
 
-   std::string extension = file.substr(dot_pos);
-   if (extension == ".html" || extension == ".htm") {
-       return "text/html";
-   }
-   else if (extension == ".css") return "text/css";
-   else if (extension == ".js")  return "application/javascript";
-   else if (extension == ".jpg")  return "image/jpeg";
-   else if (extension == ".png")  return "image/png";
-   else {
-       return "text/plain";
-   }
+    // --- 2. 较大的文件交给后台线程压缩，这次先发送原文件 ---
+    if (plain->size > INLINE_GZIP_BYTES) {
+        if (conn.gzip != nullptr) {
+            conn.gzip->submit(conn.cache_key, file_name, plain);
+        }
+        return nullptr;
+    }
+
+    // --- 3. 小文件直接压缩，压缩结果进入缓存，之后的请求直接命中 ---
+    // 这些文件在缓存里是堆内存（不是 mmap），在用户态读取不会因为文件被截断收到 SIGBUS
+    static_assert(INLINE_GZIP_BYTES < FileCache::MMAP_THRESHOLD, "inline gzip must not read mmapped entries");
+    std::string data;
+    if (!gzip_compress(plain->body, plain->size, data)) {
+        return nullptr;
+    }
+    return insert_gzip(*conn.cache, conn.cache_key, file_name, plain, std::move(data), now);
 }
 
+// ===================================================================================
+// Range 请求
+// ===================================================================================
 
-void request_handle(int clnt_sock) {
-    std::cout << "Request Handle Start (Thread ID: " << std::this_thread::get_id() << ")" << std::endl;
+enum RangeResult {
+    RANGE_IGNORE,        // 没有 Range 头、格式不对或区间太多：忽略它，返回整个文件
+    RANGE_OK,            // 至少有一个可满足的区间
+    RANGE_UNSATISFIABLE  // 所有区间都超出文件范围：416
+};
 
-    std::string req_line = socket_read_line(clnt_sock);
+/**
+ * @brief 解析 "Range: bytes=0-99,200-,-50"，把可满足的区间（闭区间）按出现顺序放进 ranges
+ */
+RangeResult parse_ranges(std::string_view header, off_t size, std::vector<std::pair<off_t, off_t>>& ranges) {
+    ranges.clear();
+    if (header.size() < 6 || !HttpRequest::iequals(header.substr(0, 6), "bytes=")) {
+        return RANGE_IGNORE;
+    }
+    header.remove_prefix(6);
+    size_t specs = 0;
+    while (!header.empty()) {
+        size_t comma = header.find(',');
+        std::string_view spec = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+        while (!spec.empty() && (spec.front() == ' ' || spec.front() == '\t')) spec.remove_prefix(1);
+        while (!spec.empty() && (spec.back() == ' ' || spec.back() == '\t')) spec.remove_suffix(1);
+        if (spec.empty()) {
+            continue;
+        }
+        if (++specs > MAX_RANGES) {
+            return RANGE_IGNORE;
+        }
+
+        size_t dash = spec.find('-');
+        if (dash == std::string_view::npos) {
+            return RANGE_IGNORE;
+        }
+        // 解析十进制数；空串返回 -1，非数字或溢出返回 -2
+        auto parse_num = [](std::string_view v) -> off_t {
+            if (v.empty()) {
+                return -1;
+            }
+            off_t n = 0;
+            for (char c : v) {
+                if (c < '0' || c > '9' || n > (INT64_MAX - 9) / 10) {
+                    return -2;
+                }
+                n = n * 10 + (c - '0');
+            }
+            return n;
+        };
+        off_t first = parse_num(spec.substr(0, dash));
+        off_t last = parse_num(spec.substr(dash + 1));
+        if (first == -2 || last == -2 || (first == -1 && last == -1) || (first >= 0 && last >= 0 && last < first)) {
+            return RANGE_IGNORE; // 语法错误：按规范忽略整个 Range 头
+        }
+
+        if (first == -1) {
+            // "-n"：最后 n 个字节
+            if (last == 0 || size == 0) {
+                continue;
+            }
+            first = last >= size ? 0 : size - last;
+            last = size - 1;
+        } else {
+            if (first >= size) {
+                continue; // 这个区间不可满足，看其他区间
+            }
+            if (last == -1 || last >= size) {
+                last = size - 1;
+            }
+        }
+        ranges.emplace_back(first, last);
+    }
+    if (specs == 0) {
+        return RANGE_IGNORE;
+    }
+    return ranges.empty() ? RANGE_UNSATISFIABLE : RANGE_OK;
+}
 
-    if (req_line.empty()) {
-        close(clnt_sock);
+/**
+ * @brief 追加文件的一个区间作为正文段：来自缓存时直接引用缓存内容，否则 dup 一个 fd 用 sendfile 从偏移处发送
+ */
+void queue_body_range(Connection& conn, const std::shared_ptr<const FileCache::Entry>& entry, int file_fd,
+                      off_t first, off_t last, bool last_segment) {
+    if (entry) {
+        queue_cached(conn, entry, entry->body + first, last - first + 1, last_segment);
         return;
     }
-    std::cout << "Received: " << req_line; // req_line 包含 \n
-    
-    // ============================================================
-    // 【新增代码】读取并丢弃剩余的请求头
-    // ============================================================
-    while (true) {
-        std::string header = socket_read_line(clnt_sock);
-        // HTTP 协议中，请求头结束的标志是一个单独的 "\r\n"
-        if (header == "\r\n" || header == "\n" || header.empty()) {
-            break;
+    OutSegment body;
+    body.file_fd = dup(file_fd);
+    body.offset = first;
+    body.end = last + 1;
+    body.last = last_segment;
+    conn.out.push_back(std::move(body));
+    if (last_segment) {
+        conn.responses_queued++;
+    }
+}
+
+/**
+ * @brief 处理 Range 请求：单个区间返回 206 + Content-Range，多个区间返回 multipart/byteranges，
+ * 全部不可满足时返回 416。正文来自缓存项 entry，或者（不在缓存中时）文件 file_fd。
+ * @return bool 是否已经生成了响应；返回 false 表示应当忽略 Range，按普通请求返回整个文件
+ */
+bool send_range(Connection& conn, const std::string& file_name, std::string_view range_header,
+                const std::shared_ptr<const FileCache::Entry>& entry, int file_fd, off_t file_size,
+                const std::string& etag, const std::string& last_modified, bool keep_alive) {
+    std::vector<std::pair<off_t, off_t>> ranges;
+    RangeResult result = parse_ranges(range_header, file_size, ranges);
+    if (result == RANGE_IGNORE) {
+        return false;
+    }
+
+    std::stringstream header_ss;
+    if (result == RANGE_UNSATISFIABLE) {
+        header_ss << "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                  << "Server: Linux Web Server\r\n"
+                  << "Content-Range: bytes */" << file_size << "\r\n"
+                  << "Content-Length: 0\r\n"
+                  << connection_header(keep_alive)
+                  << "\r\n";
+        queue_memory(conn, header_ss.str(), true);
+        if (!keep_alive) {
+            conn.closing = true;
         }
-        // 也可以选择打印出来看看浏览器发了什么
-        std::cout << "[Header] " << header; 
+        return true;
+    }
+
+    std::string_view ct = mime_type(file_name);
+    header_ss << "HTTP/1.1 206 Partial Content\r\n"
+              << "Server: Linux Web Server\r\n"
+              << "Accept-Ranges: bytes\r\n"
+              << "ETag: " << etag << "\r\n"
+              << "Last-Modified: " << last_modified << "\r\n";
+
+    if (ranges.size() == 1) {
+        // --- 单个区间 ---
+        off_t first = ranges[0].first, last = ranges[0].second;
+        header_ss << "Content-Range: bytes " << first << "-" << last << "/" << file_size << "\r\n"
+                  << "Content-Length: " << last - first + 1 << "\r\n"
+                  << "Content-Type: " << ct << "\r\n"
+                  << connection_header(keep_alive)
+                  << "\r\n";
+        queue_memory(conn, header_ss.str(), false);
+        queue_body_range(conn, entry, file_fd, first, last, true);
+    } else {
+        // --- 多个区间：multipart/byteranges，每个区间前面是一段小的部分头 ---
+        std::vector<std::string> part_headers;
+        off_t total = 0;
+        for (const auto& r : ranges) {
+            std::stringstream part_ss;
+            part_ss << "\r\n--" << BYTERANGES_BOUNDARY << "\r\n"
+                    << "Content-Type: " << ct << "\r\n"
+                    << "Content-Range: bytes " << r.first << "-" << r.second << "/" << file_size << "\r\n"
+                    << "\r\n";
+            part_headers.push_back(part_ss.str());
+            total += part_headers.back().size() + (r.second - r.first + 1);
+        }
+        std::string trailer = std::string("\r\n--") + BYTERANGES_BOUNDARY + "--\r\n";
+        total += trailer.size();
+
+        header_ss << "Content-Length: " << total << "\r\n"
+                  << "Content-Type: multipart/byteranges; boundary=" << BYTERANGES_BOUNDARY << "\r\n"
+                  << connection_header(keep_alive)
+                  << "\r\n";
+        queue_memory(conn, header_ss.str(), false);
+        for (size_t i = 0; i < ranges.size(); i++) {
+            queue_memory(conn, std::move(part_headers[i]), false);
+            queue_body_range(conn, entry, file_fd, ranges[i].first, ranges[i].second, false);
+        }
+        queue_memory(conn, std::move(trailer), true);
+    }
+    if (!keep_alive) {
+        conn.closing = true;
+    }
+    return true;
+}
+
+/**
+ * @brief 从缓存取出原文件的缓存项，不在缓存中时加载进缓存
+ * @return 文件太大等原因不能缓存时返回 nullptr
+ */
+std::shared_ptr<const FileCache::Entry> cached_plain(Connection& conn, const std::string& file_name, int64_t now) {
+    std::shared_ptr<const FileCache::Entry> entry = conn.cache->lookup(file_name, now);
+    if (!entry) {
+        std::string_view ct = mime_type(file_name);
+        bool compressible = is_compressible(ct);
+        entry = conn.cache->load(file_name, now, [&ct, compressible](FileCache::Entry& e) {
+            e.compressible = compressible;
+            e.header_keep_alive = file_header(ct, e.size, true, e.etag, e.last_modified, nullptr, compressible);
+            e.header_close = file_header(ct, e.size, false, e.etag, e.last_modified, nullptr, compressible);
+        });
+    }
+    return entry;
+}
+
+/**
+ * @brief 客户端接受 gzip 时实际要发送的缓存项：有压缩版本时是压缩版本，否则是原文件
+ * 200 和 304 都用它决定表示，两者带的 ETag 因此总是一致（压缩版本为弱 ETag）。
+ */
+std::shared_ptr<const FileCache::Entry> cached_gzip(Connection& conn, const std::string& file_name,
+                                                    const std::shared_ptr<const FileCache::Entry>& plain, int64_t now) {
+    if (!plain->compressible) {
+        return plain;
+    }
+    conn.cache_key.assign("gzip:");
+    conn.cache_key.append(file_name);
+    std::shared_ptr<const FileCache::Entry> gz = conn.cache->lookup(conn.cache_key, now);
+    if (!gz) {
+        gz = load_gzip(conn, file_name, plain, now);
+    }
+    return gz ? gz : plain;
+}
+
+/**
+ * @brief 生成一个文件的 200 响应
+ * 热点文件直接从缓存取出预先序列化的响应头和文件内容（不打开文件、不拼接字符串）；
+ * 不在缓存中且能放进缓存的文件先加载进缓存；其余文件走 sendfile：响应头作为内存段，正文作为文件段。
+ * 客户端接受 gzip 且内容是文本类时，发送 .gz 预压缩文件或实时压缩（并缓存）的版本；
+ * 带 Range 头的请求只针对原始内容，返回 206 / 416。
+ * @param meta 文件的元数据（不经过缓存时用它的验证器）
+ * @param keep_alive 响应后是否保持连接
+ */
+void send_data(Connection& conn, const std::string &file_name, const FileCache::Meta& meta, bool keep_alive) {
+    std::string_view range = conn.req.header("Range");
+    bool gzip_ok = range.empty() && accepts_gzip(conn.req.header("Accept-Encoding"));
+
+    // --- 1. 查缓存 ---
+    if (conn.cache != nullptr) {
+        int64_t now = now_ms();
+        std::shared_ptr<const FileCache::Entry> entry = cached_plain(conn, file_name, now);
+        if (entry && !range.empty() && send_range(conn, file_name, range, entry, -1, entry->size,
+                                                      entry->etag, entry->last_modified, keep_alive)) {
+            return;
+        }
+        if (entry && gzip_ok) {
+            entry = cached_gzip(conn, file_name, entry, now);
+        }
+        if (entry) {
+            queue_entry(conn, entry, keep_alive);
+            return;
+        }
+    }
+
+    // --- 2. 打开文件并检查 ---
+    std::string_view ct = mime_type(file_name);
+    bool compressible = is_compressible(ct);
+    const char* encoding = nullptr;
+    int file_fd = -1;
+    if (gzip_ok && compressible) {
+        file_fd = open((file_name + ".gz").c_str(), O_RDONLY); // 不经过缓存时只发送预压缩好的版本
+        encoding = file_fd != -1 ? "gzip" : nullptr;
+    }
+    if (file_fd == -1) {
+        file_fd = open(file_name.c_str(), O_RDONLY);
+    }
+    struct stat st;
+    if (file_fd == -1 || fstat(file_fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        log_line("File not found");
+        if (file_fd != -1) {
+            close(file_fd);
+        }
+        send_error(conn, keep_alive);
+        return;
+    }
+    // --- 3. 文件大小直接来自 fstat ---
+    off_t file_size = st.st_size;
+    if (!range.empty() && send_range(conn, file_name, range, nullptr, file_fd, file_size,
+                                          meta.etag, meta.last_modified, keep_alive)) {
+        close(file_fd); // 各个区间的正文段持有自己 dup 出来的 fd
+        return;
+    }
+
+    // --- 4. 构建完整的、正确的HTTP头部 ---
+    std::string etag = encoding != nullptr ? weak_etag(meta.etag) : meta.etag;
+    queue_memory(conn, file_header(ct, file_size, keep_alive, etag, meta.last_modified, encoding, compressible),
+                 file_size == 0);
+
+    // --- 5. 正文 ---
+    if (file_size > 0) {
+        OutSegment body;
+        body.file_fd = file_fd;
+        body.offset = 0;
+        body.end = file_size;
+        body.last = true;
+        conn.out.push_back(std::move(body));
+        conn.responses_queued++;
+    } else {
+        close(file_fd);
     }
+    if (!keep_alive) {
+        conn.closing = true;
+    }
+}
 
-    // 2. 解析请求行 (使用 stringstream 进行分割)
 
-    std::stringstream ss(req_line);
-    std::string method, file_name, protocol;
-    ss >> method >> file_name >> protocol;
 
-    if (method != "GET") {
-        send_error(clnt_sock);
-        close(clnt_sock);
+/**
+ * @brief 判断响应之后是否保持连接
+ * HTTP/1.1 默认保持，除非客户端发送 "Connection: close"；HTTP/1.0 只有显式要求 keep-alive 才保持。
+ */
+bool want_keep_alive(const HttpRequest& req) {
+    std::string_view conn = req.header("Connection");
+    if (req.version == "HTTP/1.1") {
+        return !HttpRequest::iequals(conn, "close");
+    }
+    return HttpRequest::iequals(conn, "keep-alive");
+}
+
+/**
+ * @brief 处理一个解析完成的请求，把响应追加到连接的发送队列
+ */
+void request_handle(Connection& conn) {
+    const HttpRequest& req = conn.req;
+    if (!quiet && !access_log) { // 有访问日志时不再逐请求打印到 cout
+        std::string line = "Received: " + std::string(req.method) + " " + std::string(req.target)
+                           + " " + std::string(req.version);
+        for (int i = 0; i < req.header_count; i++) {
+            // 也可以选择打印出来看看浏览器发了什么
+            line += "\n[Header] " + std::string(req.headers[i].name) + ": " + std::string(req.headers[i].value);
+        }
+        log_line(line);
+    }
+
+    bool keep_alive = want_keep_alive(req);
+    if (req.method != "GET") {
+        send_error(conn, false); // 可能带有请求体，不再继续解析这个连接
         return;
     }
 
-    if(file_name.size() > 1 && file_name[0] == '/') {
-        file_name = file_name.substr(1); // 去掉开头的 '/'
-    } else if (file_name == "/") {
-        file_name = "index.html"; // 默认首页
+    std::string_view path = req.target.substr(0, req.target.find('?')); // 忽略查询字符串
+    std::string& file_name = conn.file_name;
+    if(path.size() > 1 && path[0] == '/') {
+        file_name.assign(path.substr(1)); // 去掉开头的 '/'
+    } else if (path == "/") {
+        file_name.assign("index.html"); // 默认首页
+    } else {
+        file_name.assign(path);
     }
 
-    std::string ct = content_type(file_name);
-    send_data(clnt_sock, ct, file_name);
+    // --- 条件请求：验证器来自元数据表，命中时不 stat 也不打开文件 ---
+    FileCache::Meta local_meta;
+    const FileCache::Meta* meta = nullptr;
+    if (conn.cache != nullptr) {
+        meta = conn.cache->metadata(file_name, now_ms());
+    } else if (FileCache::stat_meta(file_name, local_meta)) {
+        meta = &local_meta;
+    }
+    if (meta == nullptr) {
+        log_line("File not found");
+        send_error(conn, keep_alive);
+        return;
+    }
+    if (not_modified(req, *meta)) {
+        // ETag 必须和同一个请求的 200 响应一致：和 send_data 一样选出要发送的表示，用它的 ETag
+        std::string etag = meta->etag, last_modified = meta->last_modified; // 再次查询元数据表可能让 meta 失效
+        bool compressible = is_compressible(mime_type(file_name));
+        if (compressible && accepts_gzip(req.header("Accept-Encoding")) && req.header("Range").empty()) {
+            std::string gz_name = file_name + ".gz";
+            std::shared_ptr<const FileCache::Entry> entry;
+            if (conn.cache != nullptr) {
+                int64_t now = now_ms();
+                entry = cached_plain(conn, file_name, now);
+                if (entry) {
+                    etag = cached_gzip(conn, file_name, entry, now)->etag;
+                } else if (conn.cache->metadata(gz_name, now) != nullptr) {
+                    etag = weak_etag(etag); // 不能缓存的文件只发送预压缩好的版本
+                }
+            } else if (FileCache::stat_meta(gz_name, local_meta)) {
+                etag = weak_etag(etag);
+            }
+        }
+        send_not_modified(conn, etag, last_modified, compressible, keep_alive);
+        return;
+    }
 
-    close(clnt_sock);
-    std::cout << "Request Handle End" << std::endl;
+    send_data(conn, file_name, *meta, keep_alive);
 }
 
 // ===================================================================================
-// 主函数
+// 事件循环
 // ===================================================================================
 
-int main(int argc, char** argv) {
-    int serv_sock;          // 服务器的监听套接字
-    int clnt_sock;          // 为每个客户端创建的通信套接字
+/**
+ * @brief 为刚排进队列的响应（从 out[first_segment] 开始）准备一条访问日志记录，
+ * 等响应发送完时再补上延迟并交给日志缓冲区
+ */
+void queue_access_record(Connection& conn, size_t first_segment, std::string_view method, std::string_view path) {
+    if (conn.log_ring == nullptr || first_segment >= conn.out.size()) {
+        return;
+    }
+    conn.pending_log.emplace_back();
+    AccessRecord& rec = conn.pending_log.back();
+    rec.start_us = now_us();
+    rec.set_method(method);
+    rec.set_path(path);
+    // 每个响应的第一段都是以 "HTTP/1.1 NNN" 开头的响应头
+    const OutSegment& head = conn.out[first_segment];
+    const char* status = head.mem_data();
+    rec.status = head.mem_size() >= 12 ? (status[9] - '0') * 100 + (status[10] - '0') * 10 + (status[11] - '0') : 0;
+    for (size_t i = first_segment; i < conn.out.size(); i++) {
+        const OutSegment& seg = conn.out[i];
+        rec.bytes += seg.is_file() ? seg.end - seg.offset : seg.mem_size();
+    }
+}
 
-    struct sockaddr_in serv_addr; // 服务器地址结构
-    struct sockaddr_in clnt_addr; // 客户端地址结构
-    socklen_t clnt_addr_size;     // 客户端地址结构的大小
+/**
+ * @brief 解析读缓冲区里所有完整的请求并生成响应（流水线）
+ * 同一连接上的请求按顺序处理，响应按顺序进入发送队列；排队的响应太多时先停下，等发送出去再继续。
+ */
+void process_requests(Connection& conn) {
+    while (!conn.closing && conn.responses_queued < MAX_PIPELINE) {
+        HttpRequestParser::Result result = conn.parser.parse(conn.rbuf.data(), conn.rbuf.size(), conn.req);
+        size_t first_segment = conn.out.size();
+        if (result == HttpRequestParser::INCOMPLETE) {
+            if (conn.rbuf.full()) {
+                send_error(conn, false); // 请求头超过了缓冲区大小
+                queue_access_record(conn, first_segment, "-", "-");
+            }
+            return;
+        }
+        if (result == HttpRequestParser::BAD) {
+            send_error(conn, false); // 无法确定下一个请求从哪里开始，只能关闭
+            queue_access_record(conn, first_segment, "-", "-");
+            return;
+        }
+        request_handle(conn);
+        queue_access_record(conn, first_segment, conn.req.method, conn.req.target);
+        // 丢弃已处理的请求，继续处理下一个
+        conn.rbuf.consume(conn.req.header_bytes);
+        conn.parser.reset();
+    }
+}
 
-    // 检查命令行参数，程序需要一个端口号作为参数
-    if (argc != 2) {
-        error_handling("Usage: <port>");
+/**
+ * @brief 弹出已发送完的段，并统计发送完成的响应
+ */
+void pop_done_segments(Connection& conn) {
+    while (!conn.out.empty() && conn.out.front().done()) {
+        if (conn.out.front().last) {
+            conn.responses_queued--;
+            if (conn.log_ring != nullptr && !conn.pending_log.empty()) {
+                AccessRecord& rec = conn.pending_log.front();
+                rec.latency_us = (uint32_t)(now_us() - rec.start_us);
+                rec.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                conn.log_ring->push(rec);
+                conn.pending_log.pop_front();
+            }
+        }
+        conn.out.pop_front();
     }
+}
+
+/**
+ * @brief 尽量发送队列中的数据段：连续的内存段合并成一次 sendmsg，文件段用 sendfile
+ * @return int 1: 队列已清空；0: 套接字发送缓冲区已满；-1: 连接出错
+ */
+int flush_output(Connection& conn) {
+    while (!conn.out.empty()) {
+        OutSegment& seg = conn.out.front();
+        ssize_t n;
+        if (seg.is_file()) {
+            // 数据直接从页缓存拷贝到套接字缓冲区，不经过用户态
+            n = sendfile(conn.fd, seg.file_fd, &seg.offset, seg.end - seg.offset);
+            if (n == -1 && (errno == EINVAL || errno == ENOSYS)) {
+                // 该文件不支持 sendfile，从已发送的位置起退回到 pread，这一段剩余的内容改为内存段
+                OutSegment mem;
+                mem.last = seg.last;
+                if (!read_file_range(seg.file_fd, seg.offset, seg.end, mem.data)) {
+                    return -1;
+                }
+                seg = std::move(mem);
+                continue;
+            }
+            if (n == 0) {
+                return -1; // 文件被截断，正文长度已经对不上，只能断开
+            }
+        } else {
+            // 把队首连续的内存段（例如缓存命中时的响应头 + 正文，或流水线上的多个小响应）合并成一次系统调用；
+            // 后面还有文件段时带上 MSG_MORE，让响应头和正文开头合并在同一个 TCP 段里
+            struct iovec iov[MAX_IOV];
+            int iovcnt = 0;
+            bool more = false;
+            for (size_t k = 0; k < conn.out.size(); k++) {
+                const OutSegment& s = conn.out[k];
+                if (s.is_file() || iovcnt == MAX_IOV) {
+                    more = true;
+                    break;
+                }
+                iov[iovcnt].iov_base = (void*)(s.mem_data() + s.offset);
+                iov[iovcnt].iov_len = s.mem_size() - s.offset;
+                iovcnt++;
+            }
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovcnt;
+            n = sendmsg(conn.fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+            // 按顺序把写出的字节数分摊到各个段上
+            for (size_t k = 0, left = n > 0 ? n : 0; left > 0; k++) {
+                OutSegment& s = conn.out[k];
+                size_t take = std::min(left, s.mem_size() - (size_t)s.offset);
+                s.offset += take;
+                left -= take;
+            }
+        }
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+        pop_done_segments(conn);
+    }
+    return 1;
+}
+
+/**
+ * @brief 读取套接字中所有可读的数据（直到 EAGAIN 或缓冲区满）
+ * @return bool 连接出错返回 false
+ */
+bool read_input(Connection& conn) {
+    while (!conn.rbuf.full()) {
+        ssize_t n = conn.rbuf.read_from(conn.fd);
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            conn.peer_closed = true; // 对端不会再发请求，已经读到的请求仍然要回应
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true;
+}
+
+/**
+ * @brief 一个 worker 的事件循环：一个 epoll 实例 + 一个监听套接字 + 它接受的所有连接
+ */
+void reactor_loop(int worker_id, int serv_sock) {
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        error_handling("epoll_create1() error");
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = serv_sock;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, serv_sock, &ev);
+
+    std::unordered_map<int, std::unique_ptr<Connection>> conns;
+
+    // fd 用完（EMFILE / ENFILE）时，水平触发的监听套接字会一直可读；先释放这个预留的 fd，
+    // 接受后立刻关闭，把排队的连接取走，避免事件循环忙等（与 echo_epollserv 相同）
+    int spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    // 每个 worker 一个访问日志缓冲区，只有这个线程写入
+    AccessLog::Ring* log_ring = access_log ? access_log->register_producer() : nullptr;
+
+    // 每个 worker 一个文件缓存，不需要加锁；inotify 的 fd 也由这个事件循环监听
+    std::unique_ptr<FileCache> cache;
+    if (cache_bytes > 0) {
+        cache.reset(new FileCache(cache_bytes));
+        if (cache->inotify_fd() != -1) {
+            ev.events = EPOLLIN;
+            ev.data.fd = cache->inotify_fd();
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, cache->inotify_fd(), &ev);
+        }
+    }
+
+    // 较大文件的实时压缩放到后台线程，完成后通过 eventfd 回到这个事件循环
+    std::unique_ptr<GzipCompressor> gzip;
+    if (cache) {
+        gzip.reset(new GzipCompressor());
+        if (gzip->event_fd() != -1) {
+            ev.events = EPOLLIN;
+            ev.data.fd = gzip->event_fd();
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, gzip->event_fd(), &ev);
+        }
+    }
+
+    // 每个 worker 一个时间轮；loop_now 是本轮 epoll_wait 返回时的时间，同一轮的事件共用，避免反复读时钟
+    int64_t loop_now = now_ms();
+    TimerWheel timers(loop_now);
+
+    auto close_connection = [&](Connection& conn) {
+        timers.cancel(conn.timer);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, NULL);
+        close(conn.fd);
+        conns.erase(conn.fd); // conn 在这之后失效
+    };
+
+    // 根据连接当前状态决定关注哪些事件：
+    // 有数据要发就关注可写；还能接收新请求（没在关闭、对端没关、缓冲区没满）就关注可读
+    auto update_interest = [&](Connection& conn) {
+        uint32_t events = 0;
+        if (!conn.closing && !conn.peer_closed && !conn.rbuf.full()) {
+            events |= EPOLLIN;
+        }
+        if (!conn.out.empty()) {
+            events |= EPOLLOUT;
+        }
+        if (events != conn.events) {
+            struct epoll_event cev;
+            cev.events = events | EPOLLRDHUP;
+            cev.data.fd = conn.fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &cev);
+            conn.events = events;
+        }
+    };
+
+    // 根据连接当前所处的阶段重新设置它的超时（O(1)，每次处理完事件都调用）：
+    //   有响应在发送：send_timeout，每次有事件就顺延；
+    //   收到了半个请求：header_timeout，从这个请求的第一个字节算起，之后慢慢滴数据也不会顺延；
+    //   什么都没有：idle_timeout。
+    auto arm_timer = [&](Connection& conn) {
+        int64_t deadline;
+        if (!conn.out.empty()) {
+            conn.header_deadline_ms = 0;
+            deadline = loop_now + send_timeout_sec * 1000LL;
+        } else if (conn.rbuf.size() > 0) {
+            if (conn.header_deadline_ms == 0) {
+                conn.header_deadline_ms = loop_now + header_timeout_sec * 1000LL;
+            }
+            deadline = conn.header_deadline_ms;
+        } else {
+            conn.header_deadline_ms = 0;
+            deadline = loop_now + idle_timeout_sec * 1000LL;
+        }
+        timers.reset(conn.timer, deadline);
+    };
+
+    std::vector<struct epoll_event> events(MAX_EVENTS);
+    while (true) {
+        // 没有连接时一直等；否则最多等到最近的定时器到期
+        int nfds = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, timers.timeout_ms(now_ms(), -1));
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_handling("epoll_wait() error");
+        }
+        loop_now = now_ms();
+
+        for (int i = 0; i < nfds; i++) {
+            int fd = events[i].data.fd;
+
+            if (cache && fd == cache->inotify_fd()) {
+                cache->handle_inotify();
+                continue;
+            }
+
+            if (gzip && fd == gzip->event_fd()) {
+                for (GzipCompressor::Job& job : gzip->take_done()) {
+                    // 压缩期间文件可能被修改：只有原文件的缓存项还是压缩时那一个，结果才有效
+                    if (job.ok && cache->lookup(job.file_name, loop_now) == job.plain) {
+                        insert_gzip(*cache, job.key, job.file_name, job.plain, std::move(job.data), loop_now);
+                    }
+                }
+                continue;
+            }
+
+            if (fd == serv_sock) {
+                // --- 接受所有排队的新连接 ---
+                while (true) {
+                    struct sockaddr_in clnt_addr;
+                    socklen_t clnt_addr_size = sizeof(clnt_addr);
+                    int clnt_sock = accept4(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size, SOCK_NONBLOCK);
+                    if (clnt_sock == -1) {
+                        if ((errno == EMFILE || errno == ENFILE) && spare_fd != -1) {
+                            // fd 不够时 accept 在检查队列之前就失败，队列空了也一直是 EMFILE，所以取不到连接时要退出循环
+                            close(spare_fd);
+                            int rejected = accept(serv_sock, NULL, NULL);
+                            if (rejected != -1) {
+                                close(rejected);
+                            }
+                            spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                            if (rejected == -1) {
+                                break;
+                            }
+                            if (!quiet) {
+                                log_line("[Worker " + std::to_string(worker_id) + "] Too many open files, connection rejected");
+                            }
+                            continue;
+                        }
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            log_line("accept() error (errno: " + std::to_string(errno) + ")");
+                        }
+                        break;
+                    }
+                    // 长连接上连续的小响应不能被 Nagle 算法拖住（否则会和客户端的延迟 ACK 互相等待 40ms）
+                    int nodelay = 1;
+                    setsockopt(clnt_sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+                    auto conn = std::make_unique<Connection>(clnt_sock, cache.get(), gzip.get());
+                    conn->log_ring = log_ring;
+                    conn->events = EPOLLIN;
+                    conn->timer = timers.add(loop_now + idle_timeout_sec * 1000LL, clnt_sock);
+                    struct epoll_event cev;
+                    cev.events = EPOLLIN | EPOLLRDHUP;
+                    cev.data.fd = clnt_sock;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clnt_sock, &cev);
+                    conns[clnt_sock] = std::move(conn);
+
+                    if (!quiet) {
+                        char clnt_ip[INET_ADDRSTRLEN]; // INET_ADDRSTRLEN 是IPv4地址字符串的最大长度
+                        inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
+                        log_line("[Worker " + std::to_string(worker_id) + "] New client connected: IP=" + clnt_ip
+                                 + ", Port=" + std::to_string(ntohs(clnt_addr.sin_port))
+                                 + ", Socket FD=" + std::to_string(clnt_sock));
+                    }
+                }
+                continue;
+            }
+
+            auto it = conns.find(fd);
+            if (it == conns.end()) {
+                continue;
+            }
+            Connection& conn = *it->second;
+            uint32_t revents = events[i].events;
+
+            // --- 读请求 ---
+            if ((revents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !conn.closing) {
+                if (!read_input(conn)) {
+                    close_connection(conn);
+                    continue;
+                }
+            }
+
+            // --- 解析请求、发送响应，直到写不动或者没有更多请求 ---
+            int ret;
+            while (true) {
+                process_requests(conn);
+                ret = flush_output(conn);
+                // 发送队列清空后，之前因为流水线上限暂停的请求可以继续处理
+                if (ret != 1 || conn.closing || conn.responses_queued > 0
+                    || conn.parser.parse(conn.rbuf.data(), conn.rbuf.size(), conn.req) == HttpRequestParser::INCOMPLETE) {
+                    break;
+                }
+            }
+            if (ret == -1 || (ret == 1 && (conn.closing || conn.peer_closed))) {
+                close_connection(conn);
+                continue;
+            }
+            update_interest(conn);
+            arm_timer(conn);
+        }
+
+        // --- 超时：只处理到期的定时器，不再每秒扫描全部连接 ---
+        timers.advance(now_ms(), [&](uint64_t fd) {
+            auto it = conns.find((int)fd);
+            if (it != conns.end()) {
+                close_connection(*it->second);
+            }
+        });
+    }
+}
+
+/**
+ * @brief 创建、绑定并监听一个非阻塞的 TCP 服务器套接字
+ * @param reuse_port 多 worker 时每个 worker 各自持有一个监听套接字（SO_REUSEPORT），由内核分配新连接
+ * @param backlog listen 队列长度，连接风暴时需要足够大，否则 SYN/ACK 队列溢出导致客户端重传
+ */
+int create_listen_socket(int port, bool reuse_port, int backlog) {
+    struct sockaddr_in serv_addr; // 服务器地址结构
 
-    // --- 1. 创建监听套接字 ---
     // socket() 函数创建一个套接字
     // PF_INET: 使用 IPv4 协议族
     // SOCK_STREAM: 使用 TCP 协议（面向连接的、可靠的）
-    // 0: 协议类型，由系统自动选择
-    serv_sock = socket(PF_INET, SOCK_STREAM, 0);
+    // SOCK_NONBLOCK: 监听套接字交给 epoll，accept 到 EAGAIN 为止
+    int serv_sock = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     if(serv_sock == -1) {
         error_handling("socket() error");
     }
-    
-    int optval = 1;
-    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
 
     // SO_REUSEADDR: 允许重用本地地址和端口，即使它们正在使用中
+    int optval = 1;
+    setsockopt(serv_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    if (reuse_port && setsockopt(serv_sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) == -1) {
+        error_handling("setsockopt(SO_REUSEPORT) error");
+    }
 
-    // --- 2. 绑定地址和端口 ---
     // 初始化服务器地址结构
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;                     // 地址族
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);      // IP地址，INADDR_ANY表示监听服务器上所有网络接口
-    serv_addr.sin_port = htons(atoi(argv[1]));          // 端口号，htons()将主机字节序转换为网络字节序
+    serv_addr.sin_port = htons(port);                   // 端口号，htons()将主机字节序转换为网络字节序
 
     // bind() 函数将套接字与指定的IP和端口绑定
     if(bind(serv_sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1) {
         error_handling("bind() error");
     }
 
-    // --- 3. 开始监听 ---
     // listen() 函数将套接字设置为被动监听模式，等待客户端的连接请求
-    // 5 是请求队列的最大长度（backlog），表示最多可以有5个连接请求在队列中等待
-    if(listen(serv_sock, 5) == -1) {
+    if(listen(serv_sock, backlog) == -1) {
         error_handling("listen() error");
     }
-    
-    std::cout << "Server started. Waiting for client connections..." << std::endl;
-    
-    clnt_addr_size = sizeof(clnt_addr);
-    int i = 0; // 用于给连接的客户端编号
-
-    // --- 4. 主循环：接受连接并创建线程 ---
-    while(1) {
-        // accept() 函数会阻塞，直到有新的客户端连接请求到来
-        // 成功时，它会返回一个新的套接字（clnt_sock），专门用于与这个新客户端通信
-        // 原始的 serv_sock 继续用于监听新的连接
-        clnt_sock = accept(serv_sock, (struct sockaddr*)&clnt_addr, &clnt_addr_size);
-        if(clnt_sock == -1) {
-            error_handling("accept() error");
-        }
-        std::cout << "Connected client " << ++i << std::endl;
-        
-        // --- 5. 创建线程处理新客户端 ---
-        std::thread t(request_handle, clnt_sock);
-        t.detach(); // 分离线程，使其在完成后自动释放资源
-
-
-
-        // --- 7. 打印新客户端的详细信息 ---
-        char clnt_ip[INET_ADDRSTRLEN]; // INET_ADDRSTRLEN 是IPv4地址字符串的最大长度
-        // inet_ntop 将网络字节序的IP地址转换为可读的字符串形式
-        inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, INET_ADDRSTRLEN);
-        // ntohs 将网络字节序的端口号转换为主机字节序
-        std::cout << "New client connected: IP=" << clnt_ip 
-                    << ", Port=" << ntohs(clnt_addr.sin_port) 
-                    << ", Socket FD=" << clnt_sock << std::endl;
-    }
-    
-    // 这行代码实际上永远不会被执行，因为上面的 while(1) 是一个无限循环
-    // 在真实的服务器程序中，需要有信号处理机制（如处理Ctrl+C）来优雅地关闭服务器
-    close(serv_sock);
+    return serv_sock;
+}
 
+// ===================================================================================
+// 主函数
+// ===================================================================================
+
+int main(int argc, char** argv) {
+    // 检查命令行参数，程序需要一个端口号作为参数
+    int port = -1;
+    int backlog = SOMAXCONN; // listen 队列长度（--backlog），实际上限由 /proc/sys/net/core/somaxconn 决定
+    int workers = 1;         // 事件循环线程数（--workers）
+    std::string access_log_path; // --access-log
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--idle-timeout" && i + 1 < argc) {
+            idle_timeout_sec = atoi(argv[++i]);
+        } else if (arg == "--header-timeout" && i + 1 < argc) {
+            header_timeout_sec = atoi(argv[++i]);
+        } else if (arg == "--send-timeout" && i + 1 < argc) {
+            send_timeout_sec = atoi(argv[++i]);
+        } else if (arg == "--backlog" && i + 1 < argc) {
+            backlog = atoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            cache_bytes = (size_t)atoi(argv[++i]) << 20;
+        } else if (arg == "--access-log" && i + 1 < argc) {
+            access_log_path = argv[++i];
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (port == -1) {
+            port = atoi(argv[i]);
+        } else {
+            port = -1;
+            break;
+        }
+    }
+    if (port <= 0 || idle_timeout_sec <= 0 || header_timeout_sec <= 0 || send_timeout_sec <= 0 || backlog <= 0
+        || workers <= 0) {
+        error_handling("Usage: <port> [--workers N] [--backlog N] [--idle-timeout SEC] [--header-timeout SEC] "
+                       "[--send-timeout SEC] [--cache-mb N] [--access-log FILE] [--quiet]");
+    }
+    cache_bytes /= workers;
+    if (!access_log_path.empty()) {
+        access_log.reset(new AccessLog(access_log_path));
+        if (!access_log->ok()) {
+            error_handling("open() error: " + access_log_path);
+        }
+    }
+
+    // --- 1. 创建监听套接字 ---
+    // 在启动线程前全部创建完毕，这样端口被占用等错误能在启动阶段直接暴露
+    std::vector<int> listen_socks;
+    for (int i = 0; i < workers; i++) {
+        listen_socks.push_back(create_listen_socket(port, workers > 1, backlog));
+    }
+
+    std::cout << "Server started with " << workers << " worker(s). Waiting for client connections..." << std::endl;
+
+    // --- 2. 运行事件循环 ---
+    // 每个 worker 一个非阻塞的 epoll 事件循环，连接数再多也不会创建新线程
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; i++) {
+        threads.emplace_back(reactor_loop, i, listen_socks[i]);
+    }
+    reactor_loop(0, listen_socks[0]);
+
+    // 这行代码实际上永远不会被执行，因为事件循环是一个无限循环
+    // 在真实的服务器程序中，需要有信号处理机制（如处理Ctrl+C）来优雅地关闭服务器
+    for (auto& t : threads) {
+        t.join();
+    }
     return 0;
 }